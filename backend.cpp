@@ -8,7 +8,9 @@
 #include <QRandomGenerator>
 #include <QNetworkDatagram>
 #include <QDateTime>
-#include <QThread>
+#include "sliceheader.h"
+#include "httpconnection.h"
+#include "filedigest.h"
 
 /**
  * @brief Constructs a SaturnBackend object and initializes its network components.
@@ -18,13 +20,34 @@ SaturnBackend::SaturnBackend(QObject *parent) : QObject(parent)
 {
     // Initialize network sockets and servers
     udpSocket = new QUdpSocket(this);
-    mqttServer = new QTcpServer(this);
-    httpServer = new QTcpServer(this);
+    mqttServer = new ShardedTcpServer(this);
+    httpServer = new ShardedTcpServer(this);
+    shards = new BrokerShards(0, this);
+    inviteSocket = new QUdpSocket(this);
+    inviteTimer = new QTimer(this);
+    inviteTimer->setInterval(100);
+    watchdogTimer = new QTimer(this);
+    watchdogTimer->setInterval(1000);
+    fleetTimer = new QTimer(this);
+    fleetTimer->setInterval(50);
+    monotonic.start();
 
     // Connect signals from network objects to their corresponding slots
     connect(udpSocket, &QUdpSocket::readyRead, this, &SaturnBackend::onUdpReadyRead);
-    connect(mqttServer, &QTcpServer::newConnection, this, &SaturnBackend::onMqttConnection);
-    connect(httpServer, &QTcpServer::newConnection, this, &SaturnBackend::onHttpConnection);
+    connect(mqttServer, &ShardedTcpServer::socketAccepted, this, &SaturnBackend::onMqttConnection);
+    connect(httpServer, &ShardedTcpServer::socketAccepted, this, &SaturnBackend::onHttpConnection);
+    connect(inviteTimer, &QTimer::timeout, this, &SaturnBackend::onInviteTimer);
+    connect(watchdogTimer, &QTimer::timeout, this, &SaturnBackend::onWatchdogTimer);
+    connect(fleetTimer, &QTimer::timeout, this, &SaturnBackend::onFleetTimer);
+}
+
+/**
+ * @brief Stops the broker workers first: their connections read the upload table and
+ * write to the traffic recorder.
+ */
+SaturnBackend::~SaturnBackend()
+{
+    shards->stop();
 }
 
 /**
@@ -37,6 +60,7 @@ void SaturnBackend::startDiscovery()
     udpSocket->bind(QHostAddress::Any, 0); // Bind to a random local port to listen for replies
     QByteArray data = "M99999";
     udpSocket->writeDatagram(data, QHostAddress::Broadcast, 3000);
+    recorder.record(TrafficRecord::UdpOut, QHostAddress(QHostAddress::Broadcast).toString(), data);
     emit logMessage(tr("Sending broadcast message M99999..."));
 }
 
@@ -49,16 +73,16 @@ void SaturnBackend::onUdpReadyRead()
     while (udpSocket->hasPendingDatagrams())
     {
         QNetworkDatagram datagram = udpSocket->receiveDatagram();
-        QJsonDocument doc = QJsonDocument::fromJson(datagram.data());
+        QString ip = datagram.senderAddress().toString();
+        if (ip.startsWith("::ffff:")) // Handle IPv6-mapped IPv4 addresses
+            ip = ip.mid(7);
+        recorder.record(TrafficRecord::UdpIn, ip, datagram.data());
 
+        QJsonDocument doc = QJsonDocument::fromJson(datagram.data());
         if (!doc.isNull())
         {
             QJsonObject root = doc.object();
 
-            QString ip = datagram.senderAddress().toString();
-            if (ip.startsWith("::ffff:")) // Handle IPv6-mapped IPv4 addresses
-                ip = ip.mid(7);
-
             QJsonObject attrs = root["Data"].toObject()["Attributes"].toObject();
             QString name = attrs["Name"].toString();
             QString model = attrs["MachineName"].toString();
@@ -68,6 +92,7 @@ void SaturnBackend::onUdpReadyRead()
             {
                 discoveredIds.insert(ip, uuid); // Store the IP -> UUID mapping
             }
+            knownPrinters.recordDiscovery(ip, uuid, name, model, findMyIpForTarget(ip).toString());
 
             emit printerFound(ip, name, model);
         }
@@ -75,49 +100,175 @@ void SaturnBackend::onUdpReadyRead()
 }
 
 /**
- * @brief Prepares to connect to a specific printer.
- * This method sets up local MQTT and HTTP servers and then sends a "M66666" command
- * to the printer, telling it which port to connect back to for MQTT communication.
+ * @brief Adds up a printer's recorded history.
+ */
+TelemetrySummary SaturnBackend::telemetrySummary(const QString &ip, qint64 fromMs, qint64 toMs)
+{
+    auto it = sessions.find(ip);
+    if (it == sessions.end())
+        return TelemetrySummary();
+    return telemetry.summarize(it->mainboardId, fromMs, toMs);
+}
+
+/**
+ * @brief Invites the printers remembered from previous runs, then broadcasts a discovery
+ * to revalidate them. Printers last seen on a network we are no longer on are listed
+ * but not invited.
+ */
+void SaturnBackend::warmStart()
+{
+    knownPrinters.load();
+    const QList<QHostAddress> localAddresses = QNetworkInterface::allAddresses();
+
+    QStringList ips;
+    const QList<KnownPrinter> printers = knownPrinters.printers();
+    for (const KnownPrinter &printer : printers)
+    {
+        if (!printer.uuid.isEmpty() && !discoveredIds.contains(printer.ip))
+            discoveredIds.insert(printer.ip, printer.uuid);
+        PrinterSession &session = sessionFor(printer.ip);
+        if (session.model.isEmpty())
+            session.model = printer.model;
+        emit printerFound(printer.ip, printer.name, printer.model);
+
+        QHostAddress localAddress(printer.localAddress);
+        if (localAddress.isNull() || localAddress == QHostAddress(QHostAddress::Any) || localAddresses.contains(localAddress))
+            ips.append(printer.ip); // Unknown interface, or one we still have
+    }
+
+    emit logMessage(QString(tr("Known printers: %1, %2 on this network.")).arg(printers.size()).arg(ips.size()));
+    if (!ips.isEmpty())
+        connectToPrinters(ips);
+    startDiscovery();
+}
+
+/**
+ * @brief Prepares to connect to a specific printer and makes it the active one.
+ * This method makes sure our MQTT and HTTP servers are running and then sends a "M66666"
+ * command to the printer, telling it which port to connect back to for MQTT communication.
+ * If the printer is already connected (e.g. after a bulk connect), it is activated at once.
  * @param ip The IP address of the target printer.
  */
 void SaturnBackend::connectToPrinter(const QString &ip)
 {
     this->printerIp = ip;
+    PrinterSession &session = sessionFor(ip);
 
-    // Retrieve the stored UUID for the given IP, if it exists
-    if (discoveredIds.contains(ip))
-    {
-        this->currentPrinterId = discoveredIds[ip];
-        emit logMessage(tr("Retrieved UUID: ") + this->currentPrinterId);
-    }
+    if (session.printerId.isEmpty())
+        emit logMessage(tr("WARNING: Connecting without a known UUID."));
     else
+        emit logMessage(tr("Retrieved UUID: ") + session.printerId);
+
+    if (session.connection && !session.mainboardId.isEmpty())
     {
-        this->currentPrinterId = "";
-        emit logMessage(tr("WARNING: Connecting without a known UUID."));
+        emit logMessage(tr("Printer %1 is already connected.").arg(ip));
+        if (!session.model.isEmpty())
+            emit modelDetected(session.model);
+        emit connectionReady();
+        if (session.status.state != PrinterStatus::State::Unknown)
+            emit statusChanged(session.status, PrinterStatus::AllFields); // The view was showing another printer
+        return;
     }
 
     // Find the correct local IP address on the same subnet as the printer
-    QHostAddress myAddress = findMyIpForTarget(ip);
-    emit logMessage(tr("Binding to interface: ") + myAddress.toString());
+    ensureServersListening(findMyIpForTarget(ip));
+    invitePrinter(ip);
+}
 
-    // Ensure servers are stopped before starting them again
-    if (mqttServer->isListening())
+/**
+ * @brief Invites several printers at once, sharing a single broker and HTTP server.
+ * The active printer is left untouched; use connectToPrinter() to select one for the UI.
+ * @param ips The IP addresses of the printers.
+ */
+void SaturnBackend::connectToPrinters(const QStringList &ips)
+{
+    if (ips.isEmpty())
+        return;
+
+    // Bind to the common interface if every printer shares one, otherwise to all of them
+    QHostAddress address = findMyIpForTarget(ips.first());
+    for (const QString &ip : ips)
+    {
+        if (findMyIpForTarget(ip) != address)
+        {
+            address = QHostAddress::Any;
+            break;
+        }
+    }
+    ensureServersListening(address);
+
+    emit logMessage(QString(tr("Inviting %1 printers...")).arg(ips.size()));
+    for (const QString &ip : ips)
+    {
+        PrinterSession &session = sessionFor(ip);
+        if (session.connection)
+            continue; // Already talking to us
+        invitePrinter(ip);
+    }
+}
+
+/**
+ * @brief Invites every printer that answered the last discovery broadcast.
+ */
+void SaturnBackend::connectToAllDiscovered()
+{
+    connectToPrinters(discoveredIds.keys());
+}
+
+/**
+ * @brief Starts the MQTT and HTTP servers, reusing them if they already serve the address.
+ * @param address The local address the printers will connect back to.
+ */
+void SaturnBackend::ensureServersListening(const QHostAddress &address)
+{
+    QHostAddress bindAddress = address;
+    quint16 mqttPort = PORT_MQTT_FIXED;
+    quint16 httpPort = PORT_HTTP_FIXED;
+    bool widening = false;
+
+    if (mqttServer->isListening() && httpServer->isListening())
+    {
+        QHostAddress current = mqttServer->serverAddress();
+        if (current == address || current == QHostAddress(QHostAddress::Any))
+            return; // Keep serving every printer that is already connected
+
+        // Another printer lives on a different interface: widen to all of them.
+        // Closing the listeners does not drop the sockets already accepted. Keep the
+        // ports too: invites and magic URLs already sent point at them.
+        bindAddress = QHostAddress::Any;
+        mqttPort = mqttServer->serverPort();
+        httpPort = httpServer->serverPort();
+        widening = true;
         mqttServer->close();
-    if (httpServer->isListening())
         httpServer->close();
+    }
+    else
+    {
+        // Ensure servers are stopped before starting them again
+        if (mqttServer->isListening())
+            mqttServer->close();
+        if (httpServer->isListening())
+            httpServer->close();
+    }
+
+    emit logMessage(tr("Binding to interface: ") + bindAddress.toString());
 
-    // 1. Start MQTT server (try fixed port, fallback to random)
-    if (!mqttServer->listen(myAddress, PORT_MQTT_FIXED))
+    // 1. Start MQTT server (try the fixed or current port, fallback to random)
+    if (!mqttServer->listen(bindAddress, mqttPort))
     {
-        emit logMessage(QString(tr("MQTT port %1 is busy. Using a random port.")).arg(PORT_MQTT_FIXED));
-        mqttServer->listen(myAddress, 0);
+        emit logMessage(QString(tr("MQTT port %1 is busy. Using a random port.")).arg(mqttPort));
+        if (widening)
+            emit logMessage(tr("WARNING: Invites already sent point to the old MQTT port."));
+        mqttServer->listen(bindAddress, 0);
     }
 
-    // 2. Start HTTP server (try fixed port, fallback to random)
-    if (!httpServer->listen(myAddress, PORT_HTTP_FIXED))
+    // 2. Start HTTP server (try the fixed or current port, fallback to random)
+    if (!httpServer->listen(bindAddress, httpPort))
     {
-        emit logMessage(QString(tr("HTTP port %1 is busy. Using a random port.")).arg(PORT_HTTP_FIXED));
-        httpServer->listen(myAddress, 0);
+        emit logMessage(QString(tr("HTTP port %1 is busy. Using a random port.")).arg(httpPort));
+        if (widening)
+            emit logMessage(tr("WARNING: Uploads already offered to printers point to the old HTTP port."));
+        httpServer->listen(bindAddress, 0);
     }
 
     // Confirmation logs (vital for debugging)
@@ -130,132 +281,384 @@ void SaturnBackend::connectToPrinter(const QString &ip)
         emit logMessage(QString(tr("HTTP listening on port: %1")).arg(httpServer->serverPort()));
     else
         emit logMessage(tr("CRITICAL ERROR: HTTP server failed to start."));
+}
 
-    // Send UDP invitation with the actual MQTT port
-    QUdpSocket sender;
+/**
+ * @brief Registers a printer for invitation and sends the first "M66666" datagram at once.
+ * Subsequent attempts are scheduled by onInviteTimer() with exponential backoff.
+ * @param ip The IP address of the printer.
+ * @param persistent If true, keep retrying at the maximum delay instead of giving up.
+ */
+void SaturnBackend::invitePrinter(const QString &ip, bool persistent)
+{
+    PendingInvite invite;
+    invite.attempts = 1;
+    invite.persistent = persistent;
+    invite.startedMs = monotonic.elapsed();
+    invite.nextAttemptMs = invite.startedMs + INVITE_INITIAL_DELAY_MS;
+    pendingInvites.insert(ip, invite);
+
+    sendInvite(ip);
+
+    if (!inviteTimer->isActive())
+        inviteTimer->start();
+}
+
+/**
+ * @brief Sends a UDP invitation with the actual MQTT port to a printer.
+ * @param ip The IP address of the printer.
+ */
+void SaturnBackend::sendInvite(const QString &ip)
+{
     QByteArray cmd = "M66666 " + QByteArray::number(mqttServer->serverPort());
-    sender.writeDatagram(cmd, QHostAddress(ip), 3000);
+    inviteSocket->writeDatagram(cmd, QHostAddress(ip), 3000);
+    recorder.record(TrafficRecord::UdpOut, ip, cmd);
 }
 
 /**
- * @brief Handles a new incoming connection on the MQTT server.
- * This is triggered when the printer connects back to our application.
+ * @brief Re-sends every invitation whose backoff delay has expired.
+ * Printers that exhausted their attempts are dropped and reported with printerInviteFailed().
  */
-void SaturnBackend::onMqttConnection()
+void SaturnBackend::onInviteTimer()
 {
-    clientSocket = mqttServer->nextPendingConnection();
-    connect(clientSocket, &QTcpSocket::readyRead, this, &SaturnBackend::onMqttData);
-    emit logMessage(tr("Printer connected to the TCP socket (MQTT)."));
+    qint64 now = monotonic.elapsed();
+
+    for (auto it = pendingInvites.begin(); it != pendingInvites.end();)
+    {
+        PendingInvite &invite = it.value();
+        if (now < invite.nextAttemptMs)
+        {
+            ++it;
+            continue;
+        }
+
+        if (invite.attempts >= INVITE_MAX_ATTEMPTS && !invite.persistent)
+        {
+            QString ip = it.key();
+            it = pendingInvites.erase(it);
+            emit logMessage(QString(tr("Printer %1 did not answer %2 invitations.")).arg(ip).arg(INVITE_MAX_ATTEMPTS));
+            emit printerInviteFailed(ip);
+            continue;
+        }
+
+        // Exponential backoff: 0.5s, 1s, 2s, 4s... capped at INVITE_MAX_DELAY_MS
+        qint64 delay = qMin(INVITE_INITIAL_DELAY_MS << invite.attempts, INVITE_MAX_DELAY_MS);
+        invite.attempts++;
+        invite.nextAttemptMs = now + delay;
+        sendInvite(it.key());
+        ++it;
+    }
+
+    if (pendingInvites.isEmpty())
+        inviteTimer->stop();
 }
 
 /**
- * @brief Processes incoming data from the printer on the MQTT socket.
- * This function decodes the MQTT packet structure (header, length, payload) and
- * dispatches the packet to the appropriate handler based on its type.
+ * @brief Handles the printer's MQTT socket closing (Wi-Fi drop, printer reboot, etc.).
  */
-void SaturnBackend::onMqttData()
+void SaturnBackend::onMqttDisconnected()
 {
-    QTcpSocket *sock = qobject_cast<QTcpSocket *>(sender());
-    if (!sock) return;
+    MqttConnection *connection = static_cast<MqttConnection *>(sender());
+    if (!mqttConnections.contains(connection)) return; // Already released
 
-    QByteArray data = sock->readAll();
-    // Note: A cumulative buffer is omitted for simplicity, assuming complete packets.
+    PrinterSession *session = sessionForConnection(connection);
+    if (session)
+        dropSession(*session, tr("socket closed"));
+    else
+        releaseConnection(connection); // Never attached to a printer
+}
 
-    if (data.size() < 2) return;
+/**
+ * @brief Checks every connected printer for missed status reports.
+ * A printer that stayed silent for STATUS_TIMEOUT_MS is considered dead even if the
+ * TCP connection still looks open (half-open sockets after a Wi-Fi drop).
+ */
+void SaturnBackend::onWatchdogTimer()
+{
+    qint64 now = monotonic.elapsed();
+    QStringList stale;
+    bool anyAlive = false;
 
-    int ptr = 0;
-    while (ptr < data.size())
+    for (const PrinterSession &session : std::as_const(sessions))
     {
-        uint8_t header = (uint8_t)data[ptr];
-        int msgType = header >> 4;
-        int flags = header & 0x0F;
-        int qos = (flags >> 1) & 0x03; // Extract QoS level
+        if (!session.connection || session.lastStatusMs < 0)
+            continue;
+        if (now - session.lastStatusMs > STATUS_TIMEOUT_MS)
+            stale.append(session.ip);
+        else
+            anyAlive = true;
+    }
 
-        ptr++;
-        // Decode MQTT's variable-length integer for message length
-        int multiplier = 1;
-        int value = 0;
-        uint8_t digit;
-        do
-        {
-            if (ptr >= data.size()) return;
-            digit = (uint8_t)data[ptr++];
-            value += (digit & 127) * multiplier;
-            multiplier *= 128;
-        } while ((digit & 128) != 0);
+    for (const QString &ip : stale)
+        dropSession(sessionFor(ip), tr("no status received"));
 
-        int msgLength = value;
-        if (ptr + msgLength > data.size()) return; // Incomplete packet
+    if (!anyAlive)
+        watchdogTimer->stop();
+}
 
-        QByteArray payload = data.mid(ptr, msgLength);
-        ptr += msgLength;
+/**
+ * @brief Tears down a dead session and starts persistent re-invitations.
+ * Upload and auto-print state stay in the session, so an interrupted job resumes
+ * (e.g. the auto-start fires) as soon as the printer reports again.
+ * @param session The printer whose connection was lost.
+ * @param reason A short description for the log.
+ */
+void SaturnBackend::dropSession(PrinterSession &session, const QString &reason)
+{
+    MqttConnection *connection = session.connection;
+    session.connection = nullptr;
+    session.lastStatusMs = -1;
+    if (connection)
+        releaseConnection(connection);
 
-        if (msgType == MQTT_CONNECT)
-        {
-            // Respond to a connection request with a connection acknowledgment
-            sendMqttMessage(sock, MQTT_CONNACK, 0, QByteArray::fromHex("0000"));
-        }
-        else if (msgType == MQTT_SUBSCRIBE)
-        {
-            // Respond to a subscription request with a subscription acknowledgment
-            int packetId = (uint8_t)payload[0] << 8 | (uint8_t)payload[1];
-            QByteArray response;
-            response.append((char)0x00); // Success code
-            sendMqttMessage(sock, MQTT_SUBACK, 0, response, packetId);
-
-            emit logMessage(tr("Printer subscribed. Sending Handshake..."));
-            sendHandshake(); // Now that the printer is listening, send initial commands
-            emit connectionReady();
-        }
-        else if (msgType == MQTT_PUBLISH)
-        {
-            // Parse the topic and payload from the publish message
-            int topicLen = (uint8_t)payload[0] << 8 | (uint8_t)payload[1];
-            QString topic = QString::fromUtf8(payload.mid(2, topicLen));
-            int payloadOffset = 2 + topicLen;
-            int packetId = 0;
-
-            // Critical Fix: Handle QoS 1 messages, which include a Packet ID
-            if (qos > 0)
-            {
-                if (payload.size() >= payloadOffset + 2)
-                {
-                    packetId = (uint8_t)payload[payloadOffset] << 8 | (uint8_t)payload[payloadOffset + 1];
-                    payloadOffset += 2; // Move pointer past the packet ID
+    emit logMessage(QString(tr("Connection to %1 lost (%2). Reconnecting...")).arg(session.ip, reason));
+    emit connectionLost(session.ip);
 
-                    // IMPORTANT: Acknowledge receipt so the printer doesn't get stuck waiting
-                    sendMqttMessage(sock, MQTT_PUBACK, 0, QByteArray(), packetId);
-                }
-            }
+    PrinterStatus lost;
+    lost.state = PrinterStatus::State::Disconnected;
+    publishStatus(session, lost, QDateTime::currentMSecsSinceEpoch());
 
-            QByteArray content = payload.mid(payloadOffset);
-            processPublish(topic, content);
-        }
+    if (session.supervised && !pendingInvites.contains(session.ip))
+        invitePrinter(session.ip, true);
+}
+
+/**
+ * @brief Stores a printer's new status snapshot and publishes it if any field changed.
+ * @param session The printer the snapshot belongs to.
+ * @param status The new snapshot.
+ * @param wallMs Wall-clock time of the change, for the telemetry history.
+ */
+void SaturnBackend::publishStatus(PrinterSession &session, const PrinterStatus &status, qint64 wallMs)
+{
+    if (status.state != session.status.state)
+        telemetry.recordStatus(session.mainboardId, wallMs, static_cast<int>(status.state), status.isPrinting());
+
+    PrinterStatus::Fields changed = status.changedFields(session.status);
+    session.status = status;
+    if (!changed)
+        return;
+
+    emit printerStatusChanged(session.ip, status, changed);
+    if (isActive(session))
+        emit statusChanged(status, changed);
+}
+
+/**
+ * @brief Returns the session for the given IP, creating it if needed.
+ * @param ip The IP address of the printer.
+ * @return A reference to the session, valid until the session map is modified by erasure.
+ */
+PrinterSession &SaturnBackend::sessionFor(const QString &ip)
+{
+    auto it = sessions.find(ip);
+    if (it == sessions.end())
+    {
+        PrinterSession session;
+        session.ip = ip;
+        session.printerId = discoveredIds.value(ip);
+        it = sessions.insert(ip, session);
+    }
+    else if (it->printerId.isEmpty())
+    {
+        it->printerId = discoveredIds.value(ip);
     }
+    return it.value();
+}
+
+/**
+ * @brief Deletes an MQTT connection on its worker, which closes its socket.
+ * Signals it queued before that are ignored: the slots only act on connections in
+ * mqttConnections, and only compare the sender's address, never dereference it.
+ * @param connection The connection to release.
+ */
+void SaturnBackend::releaseConnection(MqttConnection *connection)
+{
+    mqttConnections.remove(connection);
+    connection->disconnect(this);
+    connection->deleteLater();
+}
+
+/**
+ * @brief Finds the session that owns an MQTT connection.
+ * @param connection The printer's MQTT connection.
+ * @return The session, or nullptr if the connection is unknown.
+ */
+PrinterSession *SaturnBackend::sessionForConnection(MqttConnection *connection)
+{
+    if (!connection)
+        return nullptr;
+    for (auto it = sessions.begin(); it != sessions.end(); ++it)
+    {
+        if (it->connection == connection)
+            return &it.value();
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Hands a new MQTT connection to a broker worker.
+ * This is triggered when the printer connects back to our application. The socket is
+ * created on the worker, which answers the MQTT handshake and decodes the messages.
+ * @param descriptor The accepted socket descriptor.
+ */
+void SaturnBackend::onMqttConnection(qintptr descriptor)
+{
+    MqttConnection *connection = new MqttConnection(descriptor, &recorder);
+    shards->adopt(connection);
+    mqttConnections.insert(connection);
+
+    connect(connection, &MqttConnection::opened, this, &SaturnBackend::onMqttOpened);
+    connect(connection, &MqttConnection::subscribed, this, &SaturnBackend::onMqttSubscribed);
+    connect(connection, &MqttConnection::published, this, &SaturnBackend::onMqttPublished);
+    connect(connection, &MqttConnection::closed, this, &SaturnBackend::onMqttDisconnected);
+    QMetaObject::invokeMethod(connection, &MqttConnection::start);
+}
+
+/**
+ * @brief Attaches a new MQTT connection to the session of the printer it comes from.
+ * @param ip The printer's IP address.
+ */
+void SaturnBackend::onMqttOpened(QString ip)
+{
+    MqttConnection *connection = static_cast<MqttConnection *>(sender());
+    if (!mqttConnections.contains(connection)) return;
+
+    PrinterSession &session = sessionFor(ip);
+    if (session.connection && session.connection != connection)
+        releaseConnection(session.connection); // The printer reconnected; drop the stale connection
+    session.connection = connection;
+    emit logMessage(QString(tr("Printer %1 connected to the TCP socket (MQTT).")).arg(ip));
+}
+
+/**
+ * @brief The printer subscribed (already acknowledged by its worker): start talking to it.
+ */
+void SaturnBackend::onMqttSubscribed()
+{
+    PrinterSession *session = sessionForConnection(static_cast<MqttConnection *>(sender()));
+    if (!session) return;
+
+    emit logMessage(tr("Printer subscribed. Sending Handshake..."));
+    sendHandshake(*session); // Now that the printer is listening, send initial commands
+    knownPrinters.recordConnection(session->ip, session->mainboardId, session->model, findMyIpForTarget(session->ip).toString());
+
+    qint64 elapsedMs = -1;
+    if (pendingInvites.contains(session->ip))
+        elapsedMs = monotonic.elapsed() - pendingInvites.take(session->ip).startedMs;
+    emit printerConnected(session->ip, elapsedMs);
+
+    // From now on the watchdog expects regular status reports
+    session->supervised = true;
+    session->lastStatusMs = monotonic.elapsed();
+    if (!watchdogTimer->isActive())
+        watchdogTimer->start();
+
+    // Replay whatever the user asked for while the printer was away
+    const QList<QPair<int, QByteArray>> queued = session->pendingCommands;
+    session->pendingCommands.clear();
+    for (const auto &command : queued)
+        sendCommandData(*session, command.first, command.second);
+
+    if (isActive(*session))
+        emit connectionReady();
+}
+
+/**
+ * @brief Applies a message the printer published, decoded by its worker.
+ * @param topic The MQTT topic the message was published on.
+ * @param root The decoded JSON payload.
+ */
+void SaturnBackend::onMqttPublished(QString topic, QJsonObject root)
+{
+    PrinterSession *session = sessionForConnection(static_cast<MqttConnection *>(sender()));
+    if (session)
+        processPublish(*session, topic, root, monotonic.elapsed(), QDateTime::currentMSecsSinceEpoch());
+}
+
+/**
+ * @brief Starts capturing printer traffic to a file.
+ */
+bool SaturnBackend::startCapture(const QString &path)
+{
+    if (!recorder.open(path))
+    {
+        emit logMessage(QString(tr("ERROR: Cannot create capture file %1.")).arg(path));
+        return false;
+    }
+    emit logMessage(QString(tr("Capturing printer traffic to %1.")).arg(path));
+    return true;
+}
+
+/**
+ * @brief Enables upload-to-first-layer tracing.
+ */
+void SaturnBackend::setTraceFile(const QString &path)
+{
+    tracer.setOutputFile(path);
+    if (!path.isEmpty())
+        emit logMessage(QString(tr("Tracing print jobs to %1.")).arg(path));
+}
+
+/**
+ * @brief Changes the upload rate limits; running downloads follow from their next write.
+ */
+void SaturnBackend::setBandwidthLimits(const BandwidthLimits &limits)
+{
+    shaper.setLimits(limits);
+    emit logMessage(QString(tr("Upload limits: %1 KB/s in total, %2 KB/s per printer%3 (0 = unlimited)."))
+                        .arg(limits.globalRate / 1024)
+                        .arg(limits.perConnectionRate / 1024)
+                        .arg(limits.adaptive ? tr(", adapting to the link") : QString()));
+}
+
+/**
+ * @brief Stops capturing printer traffic.
+ */
+void SaturnBackend::stopCapture()
+{
+    recorder.close();
+}
+
+/**
+ * @brief Applies a recorded message at the time it was captured.
+ */
+void SaturnBackend::replayPublish(const QString &ip, const QString &topic, const QJsonObject &root, quint64 timestampNs)
+{
+    const qint64 capturedMs = static_cast<qint64>(timestampNs / 1000000);
+    processPublish(sessionFor(ip), topic, root, capturedMs, capturedMs);
+}
+
+/**
+ * @brief Keeps the telemetry history in another folder.
+ */
+void SaturnBackend::setTelemetryDirectory(const QString &path)
+{
+    telemetry.setDirectory(path);
 }
 
 /**
  * @brief Processes the content of a received MQTT PUBLISH message.
  * This function parses the JSON payload from the printer, which contains status updates,
- * file transfer information, and device attributes.
+ * file transfer information, and device attributes. UI signals are only emitted for
+ * the active printer.
+ * @param session The printer that published the message.
  * @param topic The MQTT topic the message was published on.
- * @param payload The raw JSON payload of the message.
+ * @param root The decoded JSON payload of the message.
+ * @param nowMs Monotonic time of the message, for the layer timings.
+ * @param wallMs Wall-clock time of the message, for the telemetry history.
  */
-void SaturnBackend::processPublish(const QString &topic, const QByteArray &payload)
+void SaturnBackend::processPublish(PrinterSession &session, const QString &topic, const QJsonObject &root, qint64 nowMs, qint64 wallMs)
 {
-    QJsonDocument doc = QJsonDocument::fromJson(payload);
-    QJsonObject root = doc.object();
-
     // Auto-detect and store the printer's UUID if we receive it
     if (root.contains("Id"))
     {
         QString incomingUuid = root["Id"].toString();
-        if (!incomingUuid.isEmpty() && incomingUuid != printerMainboardID && incomingUuid.length() > 16)
+        if (!incomingUuid.isEmpty() && incomingUuid != session.mainboardId && incomingUuid.length() > 16)
         {
-            if (this->currentPrinterId != incomingUuid)
+            if (session.printerId != incomingUuid)
             {
-                this->currentPrinterId = incomingUuid;
-                emit logMessage(tr("AUTO-DETECTED! UUID retrieved via MQTT: ") + this->currentPrinterId);
+                session.printerId = incomingUuid;
+                emit logMessage(tr("AUTO-DETECTED! UUID retrieved via MQTT: ") + session.printerId);
             }
         }
     }
@@ -269,19 +672,52 @@ void SaturnBackend::processPublish(const QString &topic, const QByteArray &paylo
             QString model = attrs["MachineName"].toString();
             if (!model.isEmpty())
             {
+                session.model = model;
                 emit logMessage(tr("Model detected via MQTT: ") + model);
-                emit modelDetected(model);
+                if (isActive(session))
+                    emit modelDetected(model);
             }
         }
     }
 
+    // Handle command responses
+    if (topic.contains("/sdcp/response/"))
+    {
+        QJsonObject response = root["Data"].toObject();
+        QJsonObject result = response["Data"].toObject();
+        int cmd = response["Cmd"].toInt();
+        int ack = result["Ack"].toInt();
+
+        QString requestId = response["RequestID"].toString();
+        if (fleetRequests.contains(requestId))
+            onFleetAck(session.ip, requestId, ack);
+
+        if (cmd == 258 && ack == 0)
+        {
+            session.inventory.load(session.mainboardId);
+            session.inventory.applyFileList(result["FileList"].toArray());
+            emit logMessage(QString(tr("File list of %1: %2 files.")).arg(session.ip).arg(session.inventory.files().size()));
+        }
+        else if (cmd == 128 && ack >= 2 && ack <= 4) // File not found, MD5 mismatch or unreadable
+        {
+            emit logMessage(QString(tr("Printer could not open %1 (Ack %2). It will be uploaded again next time.")).arg(session.lastPrintFilename).arg(ack));
+            session.inventory.remove(session.lastPrintFilename);
+            tracer.endJob(session.ip, "printer could not open the file");
+        }
+    }
+
     // Handle status updates
     if (topic.contains("/sdcp/status/"))
     {
-        if (printerMainboardID.isEmpty())
+        if (session.mainboardId.isEmpty())
         {
-            printerMainboardID = topic.split("/").last();
+            session.mainboardId = topic.split("/").last();
+            knownPrinters.recordConnection(session.ip, session.mainboardId, session.model, findMyIpForTarget(session.ip).toString());
         }
+        session.lastStatusMs = monotonic.elapsed();
+
+        // Background printers only drive the auto-start logic below
+        const bool active = isActive(session);
 
         QJsonObject status = root["Data"].toObject()["Status"].toObject();
         QJsonObject printInfo = status["PrintInfo"].toObject();
@@ -291,67 +727,73 @@ void SaturnBackend::processPublish(const QString &topic, const QByteArray &paylo
         int printStatus = printInfo["Status"].toInt();
         int transferStatus = fileInfo["Status"].toInt();
 
-        QString statusText = tr("Unknown");
+        // Reports that match none of the cases below leave the snapshot as it was
+        PrinterStatus next = session.status;
 
         // --- State Priority Logic ---
 
         // CASE 1: PRINTING (Only if the printer reports being busy AND in a printing state)
         if (currentStatus == 1 && printStatus > 0)
         {
+            int currentLayer = printInfo["CurrentLayer"].toInt();
+            int totalLayers = printInfo["TotalLayer"].toInt();
+
+            next = PrinterStatus();
+            next.remainingSeconds = session.status.isPrinting() ? session.status.remainingSeconds : -1;
             switch (static_cast<PrintStatus>(printStatus))
             {
-            case PrintStatus::EXPOSURE: statusText = tr("Exposing Layer"); break;
-            case PrintStatus::RETRACTING: statusText = tr("Retracting"); break;
-            case PrintStatus::LOWERING: statusText = tr("Lowering"); break;
+            case PrintStatus::EXPOSURE:
+                next.state = PrinterStatus::State::Exposing;
+                if (tracer.isOpen(session.ip, "print start"))
+                    tracer.endJob(session.ip, "printing"); // First exposure: the job is on its way
+                break;
+            case PrintStatus::RETRACTING: next.state = PrinterStatus::State::Retracting; break;
+            case PrintStatus::LOWERING: next.state = PrinterStatus::State::Lowering; break;
             case PrintStatus::COMPLETE:
-                statusText = tr("Complete / Paused");
-                layerTimes.clear();
-                lastLayer = -1;
-                emit remainingTimeUpdate(""); // Clear time when paused or complete
+                next.state = PrinterStatus::State::Paused;
+                next.remainingSeconds = -1; // No time left to show when paused or complete
+                session.eta.reset();
+                break;
+            default:
+                next.state = PrinterStatus::State::Printing;
+                next.printCode = printStatus;
                 break;
-            default: statusText = QString(tr("Printing (Code %1)")).arg(printStatus); break;
             }
+            next.layer = currentLayer;
+            next.totalLayers = totalLayers;
+            next.filename = printInfo["Filename"].toString();
 
-            int currentLayer = printInfo["CurrentLayer"].toInt();
-            int totalLayers = printInfo["TotalLayer"].toInt();
-
-            if (lastLayer == -1 && currentLayer > 0) { // Print just started
-                layerStartTime = QDateTime::currentDateTime();
-                lastLayer = currentLayer;
-                layerTimes.clear();
-                emit remainingTimeUpdate(tr("Calculating..."));
-            } else if (currentLayer > lastLayer) {
-                qint64 elapsed = layerStartTime.msecsTo(QDateTime::currentDateTime());
-                layerStartTime = QDateTime::currentDateTime();
-                
-                // Add time per layer (for multiple layers if status update was skipped)
-                for(int i = 0; i < (currentLayer - lastLayer); ++i) {
-                    layerTimes.append(elapsed / 1000.0);
-                }
-                
-                // Keep the list of layer times to a reasonable size for a rolling average
-                while(layerTimes.size() > 20) {
-                    layerTimes.removeFirst();
+            // A new print: seed the estimator from the header of the file it prints
+            QString printFile = QFileInfo(printInfo["Filename"].toString()).fileName();
+            if (session.eta.lastLayer() < 0 && printFile != session.etaPriorFile)
+            {
+                session.eta.clearPrior();
+                auto prior = session.etaPriors.constFind(printFile);
+                if (prior != session.etaPriors.constEnd())
+                {
+                    session.eta.setPrior(prior->bottomLayers, prior->bottomLayerSeconds, prior->normalLayerSeconds);
                 }
-
-                double averageLayerTime = 0;
-                for(double t : layerTimes) {
-                    averageLayerTime += t;
+                else
+                {
+                    // Without a header, start from this printer's recent layer times
+                    double typical = telemetry.summarize(session.mainboardId, wallMs - ETA_HISTORY_MS, wallMs).meanLayerSeconds();
+                    if (typical > 0)
+                        session.eta.setPrior(0, 0, typical);
                 }
-                averageLayerTime /= layerTimes.size();
-
-                int remainingLayers = totalLayers - currentLayer;
-                qint64 remainingSeconds = remainingLayers * averageLayerTime;
-
-                QDateTime finishTime = QDateTime::currentDateTime().addSecs(remainingSeconds);
+                session.etaPriorFile = printFile;
+            }
 
-                QString remainingStr = QString("%1h %2m").arg(remainingSeconds / 3600).arg((remainingSeconds % 3600) / 60);
-                emit remainingTimeUpdate(tr("~%1 remaining (finishes at %2)").arg(remainingStr).arg(finishTime.toString("h:mm ap")));
-                
-                lastLayer = currentLayer;
+            // Skipped status updates and bottom/normal layers are handled by the estimator
+            // The estimate only moves when a new layer is reported
+            if (printStatus != static_cast<int>(PrintStatus::COMPLETE) && session.eta.addLayerReport(currentLayer, nowMs))
+            {
+                telemetry.recordLayer(session.mainboardId, wallMs, currentLayer, totalLayers);
+                double estimate = session.eta.remainingSeconds(currentLayer, totalLayers);
+                next.remainingSeconds = estimate < 0 ? -1 : static_cast<int>(estimate);
             }
 
-            emit statusUpdate(statusText, currentLayer, totalLayers, printInfo["Filename"].toString());
+            if (printStatus != static_cast<int>(PrintStatus::COMPLETE))
+                emit printerProgress(session.ip, currentLayer, totalLayers, static_cast<int>(session.eta.remainingSeconds(currentLayer, totalLayers)));
         }
         // CASE 2: DOWNLOADING FILE (Only if busy and there is network activity)
         else if (currentStatus == 1 && (transferStatus == 1 || (fileInfo.contains("DownloadOffset") && fileInfo["DownloadOffset"].toDouble() > 0)))
@@ -359,32 +801,30 @@ void SaturnBackend::processPublish(const QString &topic, const QByteArray &paylo
             double current = fileInfo["DownloadOffset"].toDouble();
             double total = fileInfo["FileTotalSize"].toDouble();
 
+            next = PrinterStatus();
+            next.filename = fileInfo["Filename"].toString();
             if (total > 0 && current < total)
             {
-                int pct = (int)((current / total) * 100.0);
-                emit uploadProgress(pct);
-                emit statusUpdate(QString(tr("RECEIVING FILE (%1%)...")).arg(pct), 0, 0, fileInfo["Filename"].toString());
+                next.state = PrinterStatus::State::Receiving;
+                next.transferPercent = (int)((current / total) * 100.0);
             }
             else
             {
-                emit statusUpdate(tr("Processing file..."), 0, 0, fileInfo["Filename"].toString());
+                next.state = PrinterStatus::State::Processing;
             }
         }
         // CASE 3: IDLE / READY
         else if (currentStatus == 0)
         {
-            emit statusUpdate(tr("Ready"), 0, 0, "");
-            emit uploadProgress(0);
-            layerTimes.clear(); // Reset time calculation
-            lastLayer = -1;
-            emit remainingTimeUpdate("");
-
+            session.eta.reset(); // Reset time calculation
+            next = PrinterStatus();
+            next.state = transferStatus == 3 ? PrinterStatus::State::TransferError : PrinterStatus::State::Ready;
 
             // If a previous transfer finished successfully, notify the UI
             if (transferStatus == 2)
             {
                 QString lastFile = fileInfo["Filename"].toString();
-                if (!lastFile.isEmpty())
+                if (!lastFile.isEmpty() && active)
                 {
                     emit fileReadyToPrint(lastFile);
                 }
@@ -393,272 +833,445 @@ void SaturnBackend::processPublish(const QString &topic, const QByteArray &paylo
 
         // --- Event Trigger Detection ---
 
+        if (transferStatus == 1 && !session.currentFileId.isEmpty())
+            session.transferActive = true;
+
         // End of transfer trigger (for auto-start)
         if (transferStatus == 2)
         {
-            if (this->shouldAutoPrint)
+            if (tracer.isOpen(session.ip, "transfer"))
+            {
+                tracer.end(session.ip, "transfer");
+                tracer.begin(session.ip, "await start");
+            }
+
+            if (session.shouldAutoPrint)
             {
                 emit logMessage(tr("Transfer finished. Executing Auto-Start..."));
-                emit logMessage(tr("Starting print of: ") + this->uploadedFilename);
-                this->shouldAutoPrint = false;
+                emit logMessage(tr("Starting print of: ") + session.uploadedFilename);
+                session.shouldAutoPrint = false;
+
+                Sdcp::StartPrint print;
+                print.filename = session.uploadedFilename;
+                session.lastPrintFilename = session.uploadedFilename;
+                tracer.end(session.ip, "await start");
+                tracer.begin(session.ip, "print start");
+                sendCommand(session, print);
+            }
 
-                QJsonObject printData;
-                printData["Filename"] = this->uploadedFilename;
-                printData["StartLayer"] = 0;
-                sendSaturnCommand(128, printData); // 128 = PRINT_FILE command
+            if (session.transferActive)
+            {
+                // The printer now holds exactly what we sent
+                session.transferActive = false;
+                if (session.compressionSuspect && !session.compressedTransfer)
+                {
+                    // Plain worked where gzip did not: the printer cannot take compressed files
+                    session.compressionSuspect = false;
+                    session.compressionRejected = true;
+                    emit logMessage(tr("Uncompressed transfer succeeded after a compressed one failed. Future uploads to this printer will be uncompressed."));
+                }
+                telemetry.recordTransfer(session.mainboardId, wallMs, session.uploadFileSize,
+                                         nowMs - session.transferStartedMs, session.compressedTransfer);
+                session.inventory.load(session.mainboardId);
+                session.inventory.recordUpload(session.uploadedFilename, session.uploadFileSize, session.currentFileMd5);
             }
         }
         else if (transferStatus == 3) // Transfer error
         {
-            if (currentStatus == 0)
-                emit statusUpdate(tr("Error in last transfer"), 0, 0, "");
-            this->shouldAutoPrint = false;
+            if (session.transferActive)
+            {
+                session.transferActive = false;
+                session.inventory.remove(session.uploadedFilename); // Whatever was there may be gone or partial
+                if (session.compressedTransfer && !session.compressionRejected)
+                {
+                    // Gzip or the network? Send the next upload plain and see
+                    session.compressionSuspect = true;
+                    emit logMessage(tr("Compressed transfer failed. The next upload to this printer will be uncompressed."));
+                }
+                else if (session.compressionSuspect)
+                {
+                    session.compressionSuspect = false; // Plain failed too: gzip was not the problem
+                }
+            }
+            session.shouldAutoPrint = false;
+            if (tracer.isOpen(session.ip, "transfer"))
+                tracer.endJob(session.ip, "transfer failed");
         }
+
+        publishStatus(session, next, wallMs);
+        emit printerStatus(session.ip, currentStatus, printStatus, transferStatus);
     }
 }
 
 /**
- * @brief Constructs and sends a low-level MQTT message to a socket.
- * @param socket The target socket to write to.
- * @param type The MQTT message type (e.g., MQTT_PUBLISH).
- * @param flags The MQTT message flags.
- * @param payload The message payload.
- * @param packetId The packet identifier, used for QoS > 0 messages.
+ * @brief Wraps a command's serialized data in the SDCP envelope and sends it to a printer.
+ * While the printer is reconnecting, control commands are queued and sent once it
+ * resubscribes; starting a print or an upload is refused instead, since by then the
+ * printer may be doing something else and the caller will have given up on it.
+ * @param session The target printer.
+ * @param cmdId The command ID.
+ * @param data The command's data, from Sdcp::serializeData().
+ * @return The RequestID the command was sent with, or an empty string if it was queued or dropped.
  */
-void SaturnBackend::sendMqttMessage(QTcpSocket *socket, int type, int flags, const QByteArray &payload, int packetId)
+QString SaturnBackend::sendCommandData(PrinterSession &session, int cmdId, const QByteArray &data)
 {
-    QByteArray header;
-    header.append((char)((type << 4) | flags));
-
-    int len = payload.size();
-    if (packetId > 0 || type == MQTT_PUBACK || type == MQTT_SUBACK)
-        len += 2; // Add 2 bytes for the packet ID
-
-    header.append(encodeLength(len));
+    if (!session.connection && session.supervised)
+    {
+        // The supervisor is bringing the printer back; send the command once it resubscribes
+        if (cmdId == Sdcp::StartPrint::Id || cmdId == Sdcp::UploadFile::Id)
+        {
+            emit logMessage(QString(tr("Printer is reconnecting. Command %1 not sent.")).arg(cmdId));
+        }
+        else if (session.pendingCommands.size() < MAX_PENDING_COMMANDS)
+        {
+            session.pendingCommands.append(qMakePair(cmdId, data));
+            emit logMessage(QString(tr("Printer is reconnecting. Command %1 queued.")).arg(cmdId));
+        }
+        else
+        {
+            emit logMessage(QString(tr("ERROR: Too many commands queued. Dropping command %1.")).arg(cmdId));
+        }
+        return QString();
+    }
 
-    if (packetId > 0 || type == MQTT_PUBACK || type == MQTT_SUBACK)
+    if (!session.connection)
     {
-        header.append((char)(packetId >> 8));   // MSB
-        header.append((char)(packetId & 0xFF)); // LSB
+        emit logMessage(tr("CRITICAL ERROR: Attempting to send command while disconnected."));
+        return QString();
     }
 
-    socket->write(header);
-    socket->write(payload);
-    socket->flush();
+    QString requestId = randomHexStr(32);
+    QByteArray payload = Sdcp::envelope(cmdId, data, session.mainboardId, requestId, QDateTime::currentMSecsSinceEpoch(),
+                                        session.printerId.isEmpty() ? session.mainboardId : session.printerId); // Mainboard ID as a fallback
+
+    emit logMessage("DEBUG C++ JSON: " + QString(payload));
+
+    emit logMessage(QString(tr("Writing command %1 to MQTT socket...")).arg(cmdId));
+
+    // The printer's worker frames and writes the PUBLISH packet
+    QString topic = "/sdcp/request/" + session.mainboardId;
+    MqttConnection *connection = session.connection;
+    QMetaObject::invokeMethod(connection, [connection, topic, payload]()
+                              { connection->publish(topic, payload); });
+    return requestId;
 }
 
 /**
- * @brief Encodes an integer into the MQTT variable-length integer format.
- * @param length The integer to encode.
- * @return A QByteArray containing the encoded length.
+ * @brief Sends a command to every connected printer and starts tracking the answers.
  */
-QByteArray SaturnBackend::encodeLength(int length)
+int SaturnBackend::fleetCommand(FleetAction action)
 {
-    QByteArray encoded;
-    do
+    FleetOperation operation;
+    switch (action)
     {
-        int digit = length % 128;
-        length /= 128;
-        if (length > 0)
-            digit |= 0x80; // Set the continuation bit
-        encoded.append((char)digit);
-    } while (length > 0);
-    return encoded;
+    case FleetAction::Pause:
+        operation.cmdId = Sdcp::PausePrint::Id;
+        operation.data = Sdcp::serializeData(Sdcp::PausePrint());
+        break;
+    case FleetAction::Stop:
+        operation.cmdId = Sdcp::StopPrint::Id;
+        operation.data = Sdcp::serializeData(Sdcp::StopPrint());
+        break;
+    case FleetAction::Resume:
+        operation.cmdId = Sdcp::ResumePrint::Id;
+        operation.data = Sdcp::serializeData(Sdcp::ResumePrint());
+        break;
+    }
+
+    for (auto it = sessions.cbegin(); it != sessions.cend(); ++it)
+    {
+        if (it->connection)
+            operation.targets.insert(it.key(), FleetTarget());
+        else if (it->supervised)
+            operation.unreachable.append(it.key()); // Known, but reconnecting right now
+    }
+
+    const int id = nextFleetId++;
+    emit logMessage(QString(tr("Fleet command %1: sending %2 to %3 printers (%4 unreachable).")).arg(id).arg(Sdcp::Registry::nameOf(operation.cmdId)).arg(operation.targets.size()).arg(operation.unreachable.size()));
+
+    // Fan out in one pass: each send is only a hand-off to the printer's worker
+    FleetOperation &stored = fleetOperations[id];
+    stored = operation;
+    stored.startedMs = monotonic.elapsed();
+    for (auto it = stored.targets.begin(); it != stored.targets.end(); ++it)
+        sendFleetAttempt(id, stored, it.value(), it.key());
+
+    if (stored.targets.isEmpty())
+        finishFleetOperation(id);
+    else if (!fleetTimer->isActive())
+        fleetTimer->start();
+    return id;
 }
 
 /**
- * @brief Constructs and sends a command to the Saturn printer in the required JSON format.
- * @param cmdId The integer ID of the command to send.
- * @param data The data for the command, encapsulated in a QJsonValue.
+ * @brief Sends one attempt of a fleet command to a printer.
+ * @param operationId The fleet command.
+ * @param operation Its state.
+ * @param target The printer's part in it.
+ * @param ip The printer.
  */
-void SaturnBackend::sendSaturnCommand(int cmdId, const QJsonValue &data)
+void SaturnBackend::sendFleetAttempt(int operationId, FleetOperation &operation, FleetTarget &target, const QString &ip)
 {
-    if (!clientSocket || clientSocket->state() != QAbstractSocket::ConnectedState)
+    QString requestId = sendCommandData(sessionFor(ip), operation.cmdId, operation.data);
+    target.attempts++;
+    target.lastSentMs = monotonic.elapsed();
+    if (!requestId.isEmpty())
     {
-        emit logMessage(tr("CRITICAL ERROR: Attempting to send command while disconnected."));
-        return;
+        target.requestIds.append(requestId);
+        fleetRequests.insert(requestId, operationId);
     }
+}
 
-    // Build the JSON structure
-    QJsonObject cmd;
-    QJsonObject innerData;
-    innerData["Cmd"] = cmdId;
-    innerData["Data"] = data;
-    innerData["From"] = 0;
-    innerData["MainboardID"] = printerMainboardID;
-    innerData["RequestID"] = randomHexStr(32);
-    innerData["TimeStamp"] = QDateTime::currentMSecsSinceEpoch();
+/**
+ * @brief Records a printer's answer to a fleet command.
+ * @param ip The printer.
+ * @param requestId The RequestID it answered.
+ * @param ack The printer's Ack.
+ */
+void SaturnBackend::onFleetAck(const QString &ip, const QString &requestId, int ack)
+{
+    const int id = fleetRequests.take(requestId);
+    auto op = fleetOperations.find(id);
+    if (op == fleetOperations.end())
+        return;
 
-    cmd["Data"] = innerData;
+    auto target = op->targets.find(ip);
+    if (target == op->targets.end() || target->ackMs >= 0)
+        return; // Already answered an earlier attempt
+    target->ackMs = monotonic.elapsed();
+    target->ack = ack;
+    target->gaveUp = false;
 
-    if (!this->currentPrinterId.isEmpty())
+    for (const FleetTarget &t : op->targets)
     {
-        cmd["Id"] = this->currentPrinterId;
+        if (t.ackMs < 0 && !t.gaveUp)
+            return;
     }
-    else
+    finishFleetOperation(id);
+}
+
+/**
+ * @brief Retries fleet commands on printers that have not answered in time, and gives
+ * up on those that have used every attempt.
+ */
+void SaturnBackend::onFleetTimer()
+{
+    const qint64 now = monotonic.elapsed();
+    QList<int> finished;
+    for (auto op = fleetOperations.begin(); op != fleetOperations.end(); ++op)
     {
-        cmd["Id"] = this->printerMainboardID; // Fallback
-    }
+        bool waiting = false;
+        for (auto it = op->targets.begin(); it != op->targets.end(); ++it)
+        {
+            FleetTarget &target = it.value();
+            if (target.ackMs >= 0 || target.gaveUp || now - target.lastSentMs < FLEET_RETRY_MS)
+            {
+                waiting = waiting || (target.ackMs < 0 && !target.gaveUp);
+                continue;
+            }
 
-    QByteArray payload = QJsonDocument(cmd).toJson(QJsonDocument::Compact);
+            if (target.attempts >= FLEET_MAX_ATTEMPTS)
+            {
+                target.gaveUp = true;
+                continue;
+            }
+            emit logMessage(QString(tr("Fleet command %1: no answer from %2 yet, retrying.")).arg(op.key()).arg(it.key()));
+            sendFleetAttempt(op.key(), op.value(), target, it.key());
+            waiting = true;
+        }
+        if (!waiting)
+            finished.append(op.key());
+    }
 
-    emit logMessage("DEBUG C++ JSON: " + QString(payload));
+    for (int id : finished)
+        finishFleetOperation(id);
+    if (fleetOperations.isEmpty())
+        fleetTimer->stop();
+}
 
-    // Construct the MQTT PUBLISH packet
-    QString topic = "/sdcp/request/" + printerMainboardID;
-    QByteArray topicBytes = topic.toUtf8();
-    QByteArray packet;
+/**
+ * @brief Reports the outcome of a fleet command and forgets it.
+ * @param operationId The fleet command.
+ */
+void SaturnBackend::finishFleetOperation(int operationId)
+{
+    FleetOperation operation = fleetOperations.take(operationId);
 
-    packet.append((char)(topicBytes.size() >> 8));   // Topic Length MSB
-    packet.append((char)(topicBytes.size() & 0xFF)); // Topic Length LSB
-    packet.append(topicBytes);                       // Topic Name
+    int acknowledged = 0;
+    qint64 worstMs = -1;
+    QStringList rejected;
+    QStringList silent = operation.unreachable;
+    for (auto it = operation.targets.cbegin(); it != operation.targets.cend(); ++it)
+    {
+        for (const QString &requestId : it->requestIds)
+            fleetRequests.remove(requestId);
 
-    // Add Packet ID for QoS 1
-    int pid = nextPackId++;
-    packet.append((char)(pid >> 8));
-    packet.append((char)(pid & 0xFF));
+        if (it->ackMs < 0)
+        {
+            silent.append(it.key());
+            continue;
+        }
+        acknowledged++;
+        worstMs = qMax(worstMs, it->ackMs - operation.startedMs);
+        if (it->ack != 0)
+            rejected.append(QString("%1 (Ack %2)").arg(it.key()).arg(it->ack));
+    }
 
-    packet.append(payload); // JSON payload
+    const int total = operation.targets.size() + operation.unreachable.size();
+    emit logMessage(QString(tr("Fleet command %1: %2 of %3 printers acknowledged, slowest after %4 ms.")).arg(operationId).arg(acknowledged).arg(total).arg(worstMs));
+    if (!rejected.isEmpty())
+        emit logMessage(QString(tr("Fleet command %1: refused by %2.")).arg(operationId).arg(rejected.join(", ")));
+    if (!silent.isEmpty())
+        emit logMessage(QString(tr("Fleet command %1: no answer from %2.")).arg(operationId).arg(silent.join(", ")));
 
-    emit logMessage(QString(tr("Writing command %1 to MQTT socket...")).arg(cmdId));
+    emit fleetCommandFinished(operationId, acknowledged, total, worstMs);
+}
 
-    // Send as MQTT_PUBLISH with QoS 1 (flags = 2)
-    sendMqttMessage(clientSocket, MQTT_PUBLISH, 2, packet, 0); // Packet ID is inside the payload already
+/**
+ * @brief Uploads a file to the active printer.
+ * @param filePath The path to the local file to upload.
+ * @param autoStart Whether to start printing immediately after the upload completes.
+ */
+void SaturnBackend::uploadAndPrint(const QString &filePath, bool autoStart)
+{
+    uploadAndPrint(printerIp, filePath, autoStart);
 }
 
 /**
- * @brief Manages the process of uploading a file to the printer.
+ * @brief Manages the process of uploading a file to a printer.
  * It calculates the file's MD5 hash, generates a unique URL, and sends the
  * UPLOAD_FILE command (256) to the printer.
+ * @param ip The IP address of the target printer.
  * @param filePath The path to the local file to upload.
  * @param autoStart Whether to start printing immediately after the upload completes.
  */
-void SaturnBackend::uploadAndPrint(const QString &filePath, bool autoStart)
+void SaturnBackend::uploadAndPrint(const QString &ip, const QString &filePath, bool autoStart)
 {
-    emit logMessage(tr("Initiating uploadAndPrint."));
+    emit logMessage(QString(tr("Initiating uploadAndPrint on %1.")).arg(ip));
 
-    uploadFilePath = filePath;
+    PrinterSession &session = sessionFor(ip);
     QFileInfo fi(filePath);
+    tracer.beginJob(ip, fi.fileName(), fi.fileName());
 
-    this->shouldAutoPrint = autoStart;
-    this->uploadedFilename = fi.fileName();
-    currentFileId = randomHexStr(32) + ".goo"; // Generate a unique ID for the upload
+    // Keep the slicer's settings for when this file starts printing, so the estimate is
+    // right from the first layer. The printer may still be busy with another job.
+    SliceFileInfo header = SliceFileInfo::read(filePath);
+    if (header.valid)
+    {
+        session.etaPriors.insert(fi.fileName(), EtaPrior{header.bottomLayerCount, header.bottomLayerSeconds(), header.normalLayerSeconds()});
+        if (session.eta.lastLayer() < 0 && session.etaPriorFile == fi.fileName())
+            session.etaPriorFile.clear(); // A new version of the last file: apply its header again
+        emit logMessage(QString(tr("Header: %1 layers, %2 bottom, slicer estimate %3 s.")).arg(header.layerCount).arg(header.bottomLayerCount).arg(header.printTimeSeconds));
+    }
 
-    // Calculate MD5 hash of the file
+    // Calculate MD5 hash of the file (already cached if the hot folder ingested it)
     emit logMessage(tr("Calculating MD5..."));
-    QFile f(filePath);
-    if (!f.open(QIODevice::ReadOnly))
+    tracer.begin(ip, "hash");
+    QString hash = FileDigest::md5(filePath);
+    tracer.end(ip, "hash");
+    if (hash.isEmpty())
     {
         emit logMessage(tr("ERROR: Cannot open file for reading."));
+        tracer.endJob(ip, "file unreadable");
+        return;
+    }
+    emit logMessage(tr("MD5 Calculated: ") + hash);
+
+    // Repeat jobs: the printer may already hold this exact content
+    if (session.inventory.contains(fi.fileName(), fi.size(), hash))
+    {
+        emit logMessage(QString(tr("%1 is already on the printer. Skipping upload.")).arg(fi.fileName()));
+        if (autoStart)
+            printExistingFile(ip, fi.fileName());
+        else
+        {
+            tracer.endJob(ip, "already on printer");
+            if (isActive(session))
+                emit fileReadyToPrint(fi.fileName());
+        }
+        emit uploadSkipped(ip, fi.fileName());
         return;
     }
-    QByteArray hash = QCryptographicHash::hash(f.readAll(), QCryptographicHash::Md5).toHex();
-    f.close();
-    this->currentFileMd5 = QString(hash);
-    emit logMessage(tr("MD5 Calculated: ") + this->currentFileMd5);
+
+    if (!session.currentFileId.isEmpty())
+        uploads.remove(session.currentFileId); // Only the latest upload of a printer is served
+    session.uploadFilePath = filePath;
+    session.uploadFileSize = fi.size();
+    session.currentFileMd5 = hash;
+    session.shouldAutoPrint = autoStart;
+    session.uploadedFilename = fi.fileName();
+    session.currentFileId = randomHexStr(32) + ".goo"; // Generate a unique ID for the upload
+    tracer.rekeyJob(ip, session.currentFileId);
+    session.compressedTransfer = false;
+    session.transferActive = false;
+
+    UploadTicket ticket;
+    ticket.ip = ip;
+    ticket.filePath = filePath;
+    ticket.md5 = hash;
+    ticket.gzipAllowed = compressTransfers && !session.compressionRejected && !session.compressionSuspect;
+    uploads.insert(session.currentFileId, ticket);
     
     // The printer will connect to this URL to download the file
     QString magicUrl = QString("http://${ipaddr}:%1/%2")
                            .arg(httpServer->serverPort())
-                           .arg(currentFileId);
-
-    // Prepare the JSON data for the command
-    QJsonObject cmdData;
-    cmdData["Check"] = 0;
-    cmdData["CleanCache"] = 1;
-    cmdData["Compress"] = 0;
-    cmdData["FileSize"] = fi.size();
-    cmdData["Filename"] = fi.fileName();
-    cmdData["MD5"] = this->currentFileMd5;
-    cmdData["URL"] = magicUrl;
+                           .arg(session.currentFileId);
+
+    Sdcp::UploadFile upload;
+    upload.fileSize = fi.size();
+    upload.filename = fi.fileName();
+    upload.md5 = session.currentFileMd5;
+    upload.url = magicUrl;
 
     emit logMessage(tr("Generated Magic URL: ") + magicUrl);
     emit logMessage(tr("Sending UPLOAD_FILE command (ID 256) to printer..."));
 
-    sendSaturnCommand(256, cmdData);
+    tracer.begin(ip, "await GET");
+    if (sendCommand(session, upload).isEmpty())
+    {
+        // Not sent: nothing will ever request this URL
+        uploads.remove(session.currentFileId);
+        session.currentFileId.clear();
+        session.shouldAutoPrint = false;
+        tracer.endJob(ip, "not sent");
+    }
 }
 
 /**
- * @brief Handles incoming connections on the HTTP server.
- * This is triggered when the printer attempts to download the file from the "magic URL".
- * It serves the file specified in `uploadFilePath`.
+ * @brief Hands a new HTTP connection to a broker worker.
+ * This is triggered when the printer attempts to download the file from the "magic URL";
+ * the worker serves whichever upload the requested file ID belongs to.
+ * @param descriptor The accepted socket descriptor.
  */
-void SaturnBackend::onHttpConnection()
+void SaturnBackend::onHttpConnection(qintptr descriptor)
 {
-    QTcpSocket *sock = httpServer->nextPendingConnection();
-    emit logMessage(QString(tr("Incoming HTTP connection from: %1")).arg(sock->peerAddress().toString()));
-
-    connect(sock, &QTcpSocket::readyRead, [this, sock]()
-            {
-        if (sock->bytesAvailable() < 10) return; // Wait for at least a minimal header
-
-        QByteArray reqData = sock->readAll();
-        QString reqStr = QString::fromUtf8(reqData);
-        emit logMessage(QString(tr("HTTP REQUEST:\n%1")).arg(reqStr));
-
-        // Basic parsing of the request line: "METHOD /path HTTP/1.1"
-        QStringList lines = reqStr.split("\r\n");
-        if (lines.isEmpty()) return;
-        
-        QStringList parts = lines.first().split(" ");
-        if (parts.size() < 2) return;
+    HttpConnection *connection = new HttpConnection(descriptor, &uploads, &recorder, &shaper, &httpGate);
+    shards->adopt(connection);
 
-        QString method = parts[0]; // "GET" or "HEAD"
-        QString path = parts[1];   // "/xxxx.goo"
-        QString requestedId = path.startsWith("/") ? path.mid(1) : path;
-
-        // Check if the requested file ID matches the current upload
-        if (requestedId == currentFileId)
-        {
-            emit logMessage(QString(tr("Request for %1 accepted. Sending headers...")).arg(method));
-            
-            QFile f(uploadFilePath);
-            if (f.open(QIODevice::ReadOnly))
-            {
-                // Send HTTP response headers
-                QByteArray header = "HTTP/1.1 200 OK\r\n";
-                header += "Content-Type: text/plain; charset=utf-8\r\n";
-                header += "Etag: " + this->currentFileMd5.toUtf8() + "\r\n";
-                header += "Content-Length: " + QByteArray::number(f.size()) + "\r\n";
-                header += "Connection: close\r\n\r\n";
-                sock->write(header);
-                
-                if (method == "GET")
-                {
-                    // Send the file content in chunks
-                    const qint64 chunkSize = 64 * 1024;
-                    while (!f.atEnd())
-                    {
-                        QByteArray chunk = f.read(chunkSize);
-                        sock->write(chunk);
-                        if (!sock->waitForBytesWritten(5000))
-                        {
-                            emit logMessage(tr("Error: Timeout while writing to socket."));
-                            break;
-                        }
-                    }
-                    emit logMessage(tr("File body sent completely."));
-                }
+    connect(connection, &HttpConnection::logMessage, this, &SaturnBackend::logMessage);
+    connect(connection, &HttpConnection::transferStarted, this, &SaturnBackend::onHttpTransferStarted);
+    QMetaObject::invokeMethod(connection, &HttpConnection::start);
+}
 
-                sock->flush();
-                QThread::msleep(100); // Brief pause to ensure buffer is sent
-                sock->disconnectFromHost();
-                f.close();
-            }
-            else
-            {
-                emit logMessage(tr("Error: Could not open local file."));
-                sock->write("HTTP/1.1 500 Internal Server Error\r\n\r\n");
-                sock->disconnectFromHost();
-            }
-        }
-        else
-        {
-            emit logMessage(QString(tr("Error 404: Requested %1 but expected %2")).arg(requestedId).arg(currentFileId));
-            sock->write("HTTP/1.1 404 Not Found\r\n\r\n");
-            sock->disconnectFromHost();
-        }
-    });
+/**
+ * @brief Marks the printer's current upload as started and records whether it is
+ * being sent compressed.
+ * @param ip The printer the upload belongs to.
+ * @param fileId The file ID from the URL.
+ * @param compressed True if the body is gzip-encoded.
+ */
+void SaturnBackend::onHttpTransferStarted(QString ip, QString fileId, bool compressed)
+{
+    PrinterSession &session = sessionFor(ip);
+    if (session.currentFileId == fileId)
+    {
+        session.compressedTransfer = compressed;
+        session.transferActive = true; // A short upload may finish between two status reports
+        session.transferStartedMs = monotonic.elapsed();
+        tracer.end(ip, "await GET");
+        tracer.begin(ip, "transfer");
+        emit uploadStarted(ip, session.uploadedFilename);
+    }
 }
 
 /**
@@ -682,32 +1295,106 @@ QString SaturnBackend::randomHexStr(int length)
 /**
  * @brief Sends the initial handshake sequence to the printer after an MQTT connection is established.
  * This typically involves sending commands 0, 1, and 512 to get attributes and set the status update interval.
+ * @param session The printer that just subscribed.
  */
-void SaturnBackend::sendHandshake()
+void SaturnBackend::sendHandshake(PrinterSession &session)
 {
     emit logMessage(tr("Initiating protocol handshake (CMD 0, 1, and TimePeriod)..."));
 
-    sendSaturnCommand(0, QJsonValue::Null); // Get Attributes
-    sendSaturnCommand(1, QJsonValue::Null); // Get Status
+    sendCommand(session, Sdcp::GetAttributes());
+    sendCommand(session, Sdcp::GetStatus());
+
+    Sdcp::SetStatusPeriod period;
+    period.timePeriodMs = STATUS_PERIOD_MS; // Request status updates every 5 seconds
+    sendCommand(session, period);
 
-    QJsonObject timeData;
-    timeData["TimePeriod"] = 5000; // Request status updates every 5 seconds
-    sendSaturnCommand(512, timeData);
+    sendCommand(session, Sdcp::GetFileList()); // So uploads can skip files already there
 
     emit logMessage(tr("Handshake sent."));
 }
 
 /**
- * @brief Sends a command to the printer to start printing a file that is already on its local storage.
+ * @brief Sends a command to the active printer to print a file that is already on its local storage.
  * @param filename The name of the file to print.
  */
 void SaturnBackend::printExistingFile(const QString &filename)
+{
+    printExistingFile(printerIp, filename);
+}
+
+/**
+ * @brief Sends a command to a printer to start printing a file that is already on its local storage.
+ * @param ip The IP address of the target printer.
+ * @param filename The name of the file to print.
+ */
+void SaturnBackend::printExistingFile(const QString &ip, const QString &filename)
 {
     emit logMessage(tr("Sending command to print existing file: ") + filename);
 
-    QJsonObject printData;
-    printData["Filename"] = filename;
-    printData["StartLayer"] = 0;
+    Sdcp::StartPrint print;
+    print.filename = filename;
+
+    PrinterSession &session = sessionFor(ip);
+    session.lastPrintFilename = filename;
+    tracer.end(ip, "await start");
+    tracer.begin(ip, "print start");
+    sendCommand(session, print);
+}
 
-    sendSaturnCommand(128, printData); // 128 = PRINT_FILE command
+/**
+ * @brief Pauses the printer's current print.
+ */
+void SaturnBackend::pausePrint(const QString &ip)
+{
+    sendCommand(sessionFor(ip), Sdcp::PausePrint());
+}
+
+/**
+ * @brief Resumes the printer's paused print.
+ */
+void SaturnBackend::resumePrint(const QString &ip)
+{
+    sendCommand(sessionFor(ip), Sdcp::ResumePrint());
+}
+
+/**
+ * @brief Stops the printer's current print.
+ */
+void SaturnBackend::stopPrint(const QString &ip)
+{
+    sendCommand(sessionFor(ip), Sdcp::StopPrint());
+}
+
+/**
+ * @brief Deletes files from the printer's storage and forgets them in its inventory.
+ */
+void SaturnBackend::deleteFiles(const QString &ip, const QStringList &filenames)
+{
+    PrinterSession &session = sessionFor(ip);
+    Sdcp::DeleteFiles command;
+    for (const QString &name : filenames)
+    {
+        command.fileList.append("/local/" + name);
+        session.inventory.remove(name);
+    }
+    sendCommand(session, command);
+}
+
+/**
+ * @brief Returns true if the printer has an open MQTT session with us.
+ * @param ip The IP address of the printer.
+ */
+bool SaturnBackend::isPrinterConnected(const QString &ip) const
+{
+    auto it = sessions.constFind(ip);
+    return it != sessions.cend() && it->connection;
+}
+
+/**
+ * @brief Returns the machine name the printer reported, or an empty string if unknown.
+ * @param ip The IP address of the printer.
+ */
+QString SaturnBackend::printerModel(const QString &ip) const
+{
+    return sessions.value(ip).model;
 }
\ No newline at end of file
@@ -10,7 +10,22 @@
 #include <QJsonObject>
 #include <QFile>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QSet>
+#include <QHash>
 #include "protocol.h"
+#include "printersession.h"
+#include "brokershards.h"
+#include "mqttconnection.h"
+#include "uploadtable.h"
+#include "trafficrecorder.h"
+#include "jobtracer.h"
+#include "bandwidthshaper.h"
+#include "connectiongate.h"
+#include "knownprinters.h"
+#include "sdcpcommands.h"
+#include "telemetrystore.h"
 #include <QNetworkInterface>
 
 /**
@@ -21,29 +36,79 @@
  * This class sets up UDP, MQTT, and HTTP servers to communicate with the printer.
  * It discovers the printer on the network, establishes a connection, and manages
  * file uploads and print commands.
+ *
+ * The backend owns all its sockets and timers, so it can be moved to a dedicated thread
+ * with moveToThread(). In that case its methods must be called on that thread (e.g. with
+ * QMetaObject::invokeMethod), and its signals reach the UI as queued calls.
  */
 class SaturnBackend : public QObject
 {
     Q_OBJECT
 
 public:
+    /**
+     * @brief Commands that can be sent to the whole farm at once.
+     */
+    enum class FleetAction
+    {
+        Pause,  ///< Pause every print (command 129).
+        Stop,   ///< Stop every print (command 130).
+        Resume  ///< Resume every paused print (command 131).
+    };
+
     /**
      * @brief Constructs a SaturnBackend object.
      * @param parent The parent QObject.
      */
     explicit SaturnBackend(QObject *parent = nullptr);
 
+    /**
+     * @brief Stops the broker workers before the rest of the backend goes away.
+     */
+    ~SaturnBackend() override;
+
     /**
      * @brief Starts the printer discovery process over UDP.
      */
     void startDiscovery();
 
+    /**
+     * @brief Invites the printers remembered from previous runs at once, without waiting
+     * for discovery, and starts a discovery broadcast that revalidates them in the
+     * background. Every cached printer is reported with printerFound().
+     */
+    void warmStart();
+
+    /**
+     * @brief Adds up a printer's recorded history: layers, time spent printing and uploads.
+     * @param ip The IP address of the printer.
+     * @param fromMs Start of the range, in milliseconds since the epoch.
+     * @param toMs End of the range, in milliseconds since the epoch.
+     * @return The totals; empty if the printer's mainboard ID is not known yet.
+     */
+    TelemetrySummary telemetrySummary(const QString &ip, qint64 fromMs, qint64 toMs);
+
     /**
      * @brief Establishes a connection with a printer at the given IP address.
      * @param ip The IP address of the printer.
      */
     void connectToPrinter(const QString &ip);
 
+    /**
+     * @brief Invites several printers at once to connect to our broker.
+     *
+     * The MQTT and HTTP servers are started once and shared by every printer. All
+     * "M66666" invitations are sent immediately and retried with exponential backoff
+     * until the printer subscribes or the retry budget is exhausted.
+     * @param ips The IP addresses of the printers.
+     */
+    void connectToPrinters(const QStringList &ips);
+
+    /**
+     * @brief Invites every printer found during discovery to connect.
+     */
+    void connectToAllDiscovered();
+
     /**
      * @brief Uploads a file to the printer and optionally starts printing.
      * @param filePath The local path to the file to be uploaded.
@@ -51,27 +116,146 @@ public:
      */
     void uploadAndPrint(const QString &filePath, bool autoStart);
 
+    /**
+     * @brief Uploads a file to a specific printer and optionally starts printing.
+     * @param ip The IP address of the target printer.
+     * @param filePath The local path to the file to be uploaded.
+     * @param autoStart If true, starts printing immediately after upload.
+     */
+    void uploadAndPrint(const QString &ip, const QString &filePath, bool autoStart);
+
     /**
      * @brief Commands the printer to print a file that already exists on its storage.
      * @param filename The name of the file on the printer to print.
      */
     void printExistingFile(const QString &filename);
 
+    /**
+     * @brief Commands a specific printer to print a file that already exists on its storage.
+     * @param ip The IP address of the target printer.
+     * @param filename The name of the file on the printer to print.
+     */
+    void printExistingFile(const QString &ip, const QString &filename);
+
+    /**
+     * @brief Pauses a printer's current print (command 129).
+     * @param ip The IP address of the target printer.
+     */
+    void pausePrint(const QString &ip);
+
+    /**
+     * @brief Resumes a printer's paused print (command 131).
+     * @param ip The IP address of the target printer.
+     */
+    void resumePrint(const QString &ip);
+
+    /**
+     * @brief Stops a printer's current print (command 130).
+     * @param ip The IP address of the target printer.
+     */
+    void stopPrint(const QString &ip);
+
+    /**
+     * @brief Deletes files from a printer's local storage (command 259).
+     * @param ip The IP address of the target printer.
+     * @param filenames The file names, without the "/local/" prefix.
+     */
+    void deleteFiles(const QString &ip, const QStringList &filenames);
+
+    /**
+     * @brief Sends a command to every connected printer at once, and tracks each
+     * printer's acknowledgment by its RequestID.
+     *
+     * The command is serialized once and handed to every printer's broker worker in the
+     * same pass, so the printers receive it in parallel. Printers that have not answered
+     * after FLEET_RETRY_MS get it again with a new RequestID, up to FLEET_MAX_ATTEMPTS
+     * times. fleetCommandFinished() reports the outcome and the slowest acknowledgment.
+     * @param action The command to send.
+     * @return The operation ID used in fleetCommandFinished().
+     */
+    int fleetCommand(FleetAction action);
+
+    /**
+     * @brief Returns true if the printer has an open MQTT session with us.
+     * @param ip The IP address of the printer.
+     */
+    bool isPrinterConnected(const QString &ip) const;
+
+    /**
+     * @brief Returns the machine name the printer reported, or an empty string if unknown.
+     * @param ip The IP address of the printer.
+     */
+    QString printerModel(const QString &ip) const;
+
+    /**
+     * @brief Enables or disables gzip-encoded file transfers.
+     * Compression is only used when the printer's HTTP request advertises
+     * "Accept-Encoding: gzip", and is disabled per printer after a failed transfer.
+     * @param enabled True to allow compressed transfers (the default).
+     */
+    void setCompressedTransfers(bool enabled) { compressTransfers = enabled; }
+
+    /**
+     * @brief Starts capturing every UDP datagram, MQTT frame (both directions) and HTTP
+     * request to a binary file. See TrafficRecorder for the format.
+     * @param path The capture file; it is replaced if it exists.
+     * @return False if the file could not be created.
+     */
+    bool startCapture(const QString &path);
+
+    /**
+     * @brief Traces every job from uploadAndPrint() to the printer's first exposure, and
+     * writes the spans as Chrome trace JSON each time a job ends. See JobTracer.
+     * @param path The trace file; empty disables tracing.
+     */
+    void setTraceFile(const QString &path);
+
+    /**
+     * @brief Changes the rate limits of the file downloads. MQTT traffic is never limited.
+     * By default downloads are unlimited until the link saturates, and then kept just
+     * below its measured throughput. See BandwidthShaper.
+     * @param limits The new limits.
+     */
+    void setBandwidthLimits(const BandwidthLimits &limits);
+
+    /**
+     * @brief Stops capturing printer traffic.
+     */
+    void stopCapture();
+
+    /**
+     * @brief Applies a recorded message as if the printer had just published it.
+     * Used by the replay tool to drive the backend from a capture. The layer timings
+     * and the telemetry history use the captured time, not the host's clock, so the
+     * same capture always gives the same estimates, at any replay speed.
+     * @param ip The printer that published the message.
+     * @param topic The MQTT topic the message was published on.
+     * @param root The decoded JSON payload.
+     * @param timestampNs Time of the message since the capture started.
+     */
+    void replayPublish(const QString &ip, const QString &topic, const QJsonObject &root, quint64 timestampNs);
+
+    /**
+     * @brief Keeps the telemetry history in another folder, e.g. a temporary one for a replay.
+     * @param path The folder; an empty path restores the application data folder.
+     */
+    void setTelemetryDirectory(const QString &path);
+
 signals:
     /**
-     * @brief Emitted when the printer's status changes.
-     * @param status A string describing the current status.
-     * @param layer The current printing layer.
-     * @param totalLayers The total number of layers in the print job.
-     * @param filename The name of the currently loaded file.
+     * @brief Emitted when a field of the active printer's status changes.
+     * @param status The new status snapshot.
+     * @param changed The fields that differ from the previous snapshot.
      */
-    void statusUpdate(QString status, int layer, int totalLayers, QString filename);
+    void statusChanged(PrinterStatus status, PrinterStatus::Fields changed);
 
     /**
-     * @brief Emitted when the estimated remaining print time is updated.
-     * @param time A string representing the estimated time remaining (e.g., "1h 23m").
+     * @brief Emitted when a field of any printer's status changes, active or not.
+     * @param ip The IP address of the printer.
+     * @param status The new status snapshot.
+     * @param changed The fields that differ from the previous snapshot.
      */
-    void remainingTimeUpdate(const QString &time);
+    void printerStatusChanged(QString ip, PrinterStatus status, PrinterStatus::Fields changed);
 
     /**
      * @brief Emitted to provide a general log message for display.
@@ -80,15 +264,56 @@ signals:
     void logMessage(QString msg);
 
     /**
-     * @brief Emitted to report the progress of a file upload.
-     * @param percent The completion percentage of the upload.
+     * @brief Emitted when the printer successfully connects to this application's MQTT server.
      */
-    void uploadProgress(int percent);
+    void connectionReady();
 
     /**
-     * @brief Emitted when the printer successfully connects to this application's MQTT server.
+     * @brief Emitted whenever any printer subscribes to our broker, active or not.
+     * @param ip The IP address of the printer.
+     * @param elapsedMs Milliseconds since its first invitation was sent (-1 if it was not invited).
      */
-    void connectionReady();
+    void printerConnected(QString ip, qint64 elapsedMs);
+
+    /**
+     * @brief Emitted when every printer of a fleet command has answered or given up.
+     * @param operationId The ID returned by fleetCommand().
+     * @param acknowledged Printers that acknowledged the command (accepted or not).
+     * @param total Printers the command was meant for, including unreachable ones.
+     * @param worstLatencyMs Time from the fan-out to the slowest acknowledgment (-1 if none).
+     */
+    void fleetCommandFinished(int operationId, int acknowledged, int total, qint64 worstLatencyMs);
+
+    /**
+     * @brief Emitted when a printer did not answer any of its invitations.
+     * @param ip The IP address of the printer.
+     */
+    void printerInviteFailed(QString ip);
+
+    /**
+     * @brief Emitted when a printer's MQTT session dies (socket closed or status reports stopped).
+     * The backend keeps re-inviting the printer until it subscribes again.
+     * @param ip The IP address of the printer.
+     */
+    void connectionLost(QString ip);
+
+    /**
+     * @brief Emitted for every status report of every printer, active or not.
+     * @param ip The IP address of the printer.
+     * @param currentStatus The printer's CurrentStatus (0 = ready, 1 = busy).
+     * @param printStatus The PrintInfo status (see PrintStatus).
+     * @param transferStatus The FileTransferInfo status (1 = downloading, 2 = done, 3 = error).
+     */
+    void printerStatus(QString ip, int currentStatus, int printStatus, int transferStatus);
+
+    /**
+     * @brief Emitted while any printer is printing, with its progress and estimated time left.
+     * @param ip The IP address of the printer.
+     * @param layer The current layer.
+     * @param totalLayers The total number of layers.
+     * @param remainingSeconds The estimated seconds left, or -1 if not known yet.
+     */
+    void printerProgress(QString ip, int layer, int totalLayers, int remainingSeconds);
 
     /**
      * @brief Emitted when a file has been successfully uploaded and is ready to be printed.
@@ -96,6 +321,22 @@ signals:
      */
     void fileReadyToPrint(QString filename);
 
+    /**
+     * @brief Emitted when an upload was skipped because the printer already has the same file.
+     * If auto-start was requested, the print command has already been sent.
+     * @param ip The IP address of the printer.
+     * @param filename The name of the file on the printer.
+     */
+    void uploadSkipped(QString ip, QString filename);
+
+    /**
+     * @brief Emitted when a printer starts downloading its current upload from our HTTP server.
+     * Unlike the status reports, this cannot miss a transfer that ends between two of them.
+     * @param ip The IP address of the printer.
+     * @param filename The name the file will have on the printer.
+     */
+    void uploadStarted(QString ip, QString filename);
+
     /**
      * @brief Emitted when a printer is found on the network during discovery.
      * @param ip The IP address of the printer.
@@ -117,63 +358,203 @@ private slots:
     void onUdpReadyRead();
 
     /**
-     * @brief Slot to handle new incoming connections to the MQTT server.
+     * @brief Slot to hand new MQTT connections to a broker worker.
+     */
+    void onMqttConnection(qintptr descriptor);
+
+    /**
+     * @brief Slot to attach a new MQTT connection to its printer's session.
+     */
+    void onMqttOpened(QString ip);
+
+    /**
+     * @brief Slot called when a printer has subscribed to our broker.
+     */
+    void onMqttSubscribed();
+
+    /**
+     * @brief Slot to handle a message published by a printer.
+     */
+    void onMqttPublished(QString topic, QJsonObject root);
+
+    /**
+     * @brief Slot to hand new HTTP connections to a broker worker.
+     */
+    void onHttpConnection(qintptr descriptor);
+
+    /**
+     * @brief Slot to mark a printer's upload as started and record how it is served.
+     */
+    void onHttpTransferStarted(QString ip, QString fileId, bool compressed);
+
+    /**
+     * @brief Slot that re-sends pending invitations whose backoff delay has expired.
+     */
+    void onInviteTimer();
+
+    /**
+     * @brief Slot to handle a printer's MQTT socket closing.
      */
-    void onMqttConnection();
+    void onMqttDisconnected();
 
     /**
-     * @brief Slot to handle data received from a client on the MQTT socket.
+     * @brief Slot that drops sessions whose status reports have stopped arriving.
      */
-    void onMqttData();
+    void onWatchdogTimer();
 
     /**
-     * @brief Slot to handle new incoming connections to the HTTP server.
+     * @brief Slot that re-sends fleet commands to printers that have not acknowledged them.
      */
-    void onHttpConnection();
+    void onFleetTimer();
 
 private:
+    /**
+     * @brief Book-keeping for a printer that has been invited but has not subscribed yet.
+     */
+    struct PendingInvite
+    {
+        int attempts = 0;       ///< Number of invitations sent so far.
+        qint64 startedMs = 0;   ///< Monotonic time of the first invitation.
+        qint64 nextAttemptMs = 0; ///< Monotonic time at which the next invitation is due.
+        bool persistent = false; ///< Reconnection invites never give up, they stay at the maximum delay.
+    };
+
+    /**
+     * @brief One printer's part in a fleet command.
+     */
+    struct FleetTarget
+    {
+        QStringList requestIds;  ///< RequestIDs of every attempt; a late answer to any of them counts.
+        int attempts = 0;        ///< Times the command was sent.
+        qint64 lastSentMs = 0;   ///< Monotonic time of the last attempt.
+        qint64 ackMs = -1;       ///< Monotonic time of the acknowledgment (-1 while waiting).
+        int ack = -1;            ///< The printer's Ack (0 = accepted).
+        bool gaveUp = false;     ///< No answer after the last attempt.
+    };
+
+    /**
+     * @brief A command sent to the whole farm.
+     */
+    struct FleetOperation
+    {
+        int cmdId = 0;                       ///< The command ID.
+        QByteArray data;                     ///< The serialized command data, shared by every printer.
+        qint64 startedMs = 0;                ///< Monotonic time of the fan-out.
+        QMap<QString, FleetTarget> targets;  ///< Connected printers, by IP.
+        QStringList unreachable;             ///< Known printers that were not connected.
+    };
+
     // Sockets
     QUdpSocket *udpSocket;      ///< Socket for UDP broadcast discovery.
-    QTcpServer *mqttServer;     ///< TCP server for our internal MQTT broker.
-    QTcpServer *httpServer;     ///< TCP server for handling file download requests from the printer.
+    ShardedTcpServer *mqttServer; ///< TCP server for our internal MQTT broker.
+    ShardedTcpServer *httpServer; ///< TCP server for handling file download requests from the printer.
+    BrokerShards *shards;       ///< Worker threads that run the accepted connections.
+
+    QUdpSocket *inviteSocket;   ///< Socket used to send "M66666" invitations.
+    QTimer *inviteTimer;        ///< Drives invitation retries.
+    QTimer *watchdogTimer;      ///< Detects printers that stopped reporting status.
 
     // State
-    QTcpSocket *clientSocket = nullptr; ///< The socket for the currently connected printer (MQTT client).
-    QString printerIp;                  ///< IP address of the target printer.
-    QString currentFileId;              ///< A random ID generated for each HTTP upload session.
-    QString uploadFilePath;             ///< Local path of the file being uploaded.
-    int nextPackId = 1;                 ///< Counter for MQTT packet IDs.
-    QString printerMainboardID;         ///< The mainboard ID received from the printer.
+    QString printerIp;                    ///< IP address of the active printer (the one shown in the UI).
     QMap<QString, QString> discoveredIds; ///< Map to store discovered printer IPs and their UUIDs.
-    QString currentPrinterId;           ///< The UUID of the currently connected printer.
-    QString currentFileMd5;             ///< MD5 checksum of the file being uploaded.
-    bool shouldAutoPrint = false;       ///< Flag to indicate if printing should start after upload.
-    QString uploadedFilename;           ///< Name of the last successfully uploaded file.
-
-    // Time Estimation
-    QDateTime layerStartTime;   ///< Timestamp for when the current layer started.
-    QList<double> layerTimes;   ///< A list of times (in seconds) for the last few layers.
-    int lastLayer = -1;         ///< The last layer number reported by the printer.
+    QMap<QString, PrinterSession> sessions; ///< Every known printer, keyed by IP.
+    QMap<QString, PendingInvite> pendingInvites; ///< Invited printers that have not subscribed yet.
+    UploadTable uploads;                  ///< Files the HTTP workers may serve, by file ID.
+    TrafficRecorder recorder;             ///< Optional capture of all printer traffic; read by the broker workers.
+    JobTracer tracer;                     ///< Optional spans of each job's upload-to-first-layer pipeline.
+    BandwidthShaper shaper;               ///< Paces the HTTP downloads; shared with the broker workers.
+    ConnectionGate httpGate{32, 4};       ///< At most 32 HTTP connections, 4 per address.
+    KnownPrinters knownPrinters;          ///< Printers seen in previous runs, invited at startup.
+    TelemetryStore telemetry;             ///< Per-printer history of layers, states and uploads.
+    QMap<int, FleetOperation> fleetOperations; ///< Fleet commands still waiting for acknowledgments.
+    QHash<QString, int> fleetRequests;    ///< Operation of each RequestID sent by a fleet command.
+    int nextFleetId = 1;                  ///< ID of the next fleet command.
+    QTimer *fleetTimer;                   ///< Drives fleet command retries.
+    QSet<MqttConnection *> mqttConnections; ///< Live MQTT connections; released with releaseConnection().
+    QElapsedTimer monotonic;              ///< Monotonic clock for invitation timing.
+    bool compressTransfers = true;        ///< Allow gzip transfers to printers that accept them.
 
     // Ports
     const quint16 PORT_UDP_LISTEN = 0;    ///< Listen on any available UDP port for discovery responses.
     const quint16 PORT_MQTT_FIXED = 9090; ///< Fixed port for the MQTT server.
     const quint16 PORT_HTTP_FIXED = 9091; ///< Fixed port for the HTTP server.
 
+    // Invitations
+    const int INVITE_MAX_ATTEMPTS = 6;          ///< Invitations sent before giving up on a printer.
+    const qint64 INVITE_INITIAL_DELAY_MS = 500; ///< Delay before the first retry; doubled each time.
+    const qint64 INVITE_MAX_DELAY_MS = 8000;    ///< Upper bound for the retry delay.
+
+    // Supervision
+    const int STATUS_PERIOD_MS = 5000;      ///< Status report interval requested in the handshake.
+    const qint64 STATUS_TIMEOUT_MS = 3 * STATUS_PERIOD_MS; ///< A session is dead after three missed status reports.
+    const int MAX_PENDING_COMMANDS = 16;    ///< Commands kept while a printer is reconnecting.
+    const qint64 ETA_HISTORY_MS = 30LL * 24 * 3600 * 1000; ///< History used for the ETA of files without a header.
+
+    // Fleet commands
+    const qint64 FLEET_RETRY_MS = 200;      ///< A printer that has not acknowledged by then gets the command again.
+    const int FLEET_MAX_ATTEMPTS = 5;       ///< Attempts per printer before giving up (about a second).
+
     // MQTT Helpers
-    void handleMqttPacket(const QByteArray &data, QTcpSocket *socket);
-    void sendMqttMessage(QTcpSocket *socket, int type, int flags, const QByteArray &payload, int packetId = 0);
-    QByteArray encodeLength(int length);
-    void processPublish(const QString &topic, const QByteArray &payload);
+    void processPublish(PrinterSession &session, const QString &topic, const QJsonObject &root, qint64 nowMs, qint64 wallMs);
 
     // Saturn Command Helpers
-    void sendSaturnCommand(int cmdId, const QJsonValue &data);
+    /**
+     * @brief Sends a typed command (see sdcpcommands.h) to a printer.
+     * @param session The target printer.
+     * @param command The command's payload.
+     */
+    template <typename Command>
+    QString sendCommand(PrinterSession &session, const Command &command)
+    {
+        return sendCommandData(session, Command::Id, Sdcp::serializeData(command));
+    }
+    QString sendCommandData(PrinterSession &session, int cmdId, const QByteArray &data);
     QString randomHexStr(int length);
 
     /**
      * @brief Sends the initial handshake command to the printer.
+     * @param session The printer that just subscribed.
+     */
+    void sendHandshake(PrinterSession &session);
+
+    // Session Helpers
+    PrinterSession &sessionFor(const QString &ip);
+    PrinterSession *sessionForConnection(MqttConnection *connection);
+    void releaseConnection(MqttConnection *connection);
+    bool isActive(const PrinterSession &session) const { return session.ip == printerIp; }
+    void publishStatus(PrinterSession &session, const PrinterStatus &status, qint64 wallMs);
+
+    // Fleet Helpers
+    void sendFleetAttempt(int operationId, FleetOperation &operation, FleetTarget &target, const QString &ip);
+    void onFleetAck(const QString &ip, const QString &requestId, int ack);
+    void finishFleetOperation(int operationId);
+
+    /**
+     * @brief Starts the MQTT and HTTP servers unless they already serve the given address.
+     * If they are listening on another interface, they are re-bound to all interfaces so
+     * that printers on both networks can reach them.
+     * @param address The local address the printers will connect to.
+     */
+    void ensureServersListening(const QHostAddress &address);
+
+    /**
+     * @brief Registers a printer for invitation and sends the first "M66666" datagram.
+     * @param ip The IP address of the printer.
+     */
+    void invitePrinter(const QString &ip, bool persistent = false);
+
+    /**
+     * @brief Tears down a dead MQTT session and starts re-inviting the printer.
+     * @param session The printer whose connection was lost.
+     * @param reason A short description for the log.
+     */
+    void dropSession(PrinterSession &session, const QString &reason);
+
+    /**
+     * @brief Sends a single "M66666" datagram with our MQTT port.
+     * @param ip The IP address of the printer.
      */
-    void sendHandshake();
+    void sendInvite(const QString &ip);
 
     /**
      * @brief Finds the local IP address on the same subnet as the target printer.
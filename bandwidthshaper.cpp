@@ -0,0 +1,221 @@
+#include "bandwidthshaper.h"
+#include <QStringList>
+#include <cmath>
+
+/**
+ * @brief Parses "global[,per-printer[,adaptive]]", with rates in KB/s.
+ */
+BandwidthLimits BandwidthLimits::fromString(const QString &text, bool &ok)
+{
+    BandwidthLimits limits;
+    const QStringList parts = text.split(',');
+    ok = parts.size() <= 3;
+    if (!ok)
+        return limits;
+
+    limits.globalRate = parts[0].trimmed().toLongLong(&ok) * 1024;
+    if (ok && parts.size() > 1)
+        limits.perConnectionRate = parts[1].trimmed().toLongLong(&ok) * 1024;
+    if (ok && parts.size() > 2)
+        limits.adaptive = parts[2].trimmed().toInt(&ok) != 0;
+    ok = ok && limits.globalRate >= 0 && limits.perConnectionRate >= 0;
+    return limits;
+}
+
+BandwidthShaper::BandwidthShaper()
+{
+    clock.start();
+}
+
+/**
+ * @brief Replaces the limits and restarts adaptation from them.
+ */
+void BandwidthShaper::setLimits(const BandwidthLimits &limits)
+{
+    QMutexLocker locker(&mutex);
+    config = limits;
+    adaptiveRate = 0;
+    restartWindow(nowUs());
+}
+
+/**
+ * @brief Returns the configured limits.
+ */
+BandwidthLimits BandwidthShaper::limits() const
+{
+    QMutexLocker locker(&mutex);
+    return config;
+}
+
+/**
+ * @brief Returns the global rate in effect.
+ */
+qint64 BandwidthShaper::currentRate() const
+{
+    QMutexLocker locker(&mutex);
+    return effectiveRate();
+}
+
+/**
+ * @brief Returns the global rate in effect. Call with the mutex held.
+ */
+qint64 BandwidthShaper::effectiveRate() const
+{
+    if (!config.adaptive || adaptiveRate <= 0)
+        return config.globalRate;
+    return config.globalRate > 0 ? qMin(adaptiveRate, config.globalRate) : adaptiveRate;
+}
+
+/**
+ * @brief Registers a download with a full bucket.
+ */
+int BandwidthShaper::addConnection()
+{
+    QMutexLocker locker(&mutex);
+    Bucket bucket;
+    bucket.tokens = MIN_BURST;
+    bucket.refilledUs = nowUs();
+    if (connections.isEmpty())
+        restartWindow(bucket.refilledUs); // The time without downloads says nothing about the link
+    connections.insert(nextId, bucket);
+    return nextId++;
+}
+
+/**
+ * @brief Forgets a download.
+ */
+void BandwidthShaper::removeConnection(int id)
+{
+    QMutexLocker locker(&mutex);
+    connections.remove(id);
+}
+
+/**
+ * @brief Returns how long a download must wait before its next write.
+ */
+qint64 BandwidthShaper::delayFor(int id)
+{
+    QMutexLocker locker(&mutex);
+    auto it = connections.find(id);
+    if (it == connections.end())
+        return 0;
+
+    qint64 now = nowUs();
+    adapt(now);
+    qint64 rate = effectiveRate();
+    qint64 perConnection = connectionRate();
+    refill(global, rate, now);
+    refill(*it, perConnection, now);
+
+    qint64 wait = qMax(waitUs(global, rate), waitUs(*it, perConnection));
+    if (wait > 0)
+        windowShaped = true;
+    return (wait + 999) / 1000;
+}
+
+/**
+ * @brief Charges written bytes to the download's bucket and the global one.
+ */
+void BandwidthShaper::consume(int id, qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    windowBytes += bytes;
+    if (effectiveRate() > 0)
+        global.tokens -= bytes;
+
+    auto it = connections.find(id);
+    if (it != connections.end() && connectionRate() > 0)
+        it->tokens -= bytes;
+}
+
+/**
+ * @brief Notes that a download is limited by the link in the current window.
+ */
+void BandwidthShaper::reportLinkBound()
+{
+    QMutexLocker locker(&mutex);
+    windowLinkBound = true;
+}
+
+/**
+ * @brief Adds the tokens earned since the last refill, up to the burst size.
+ */
+void BandwidthShaper::refill(Bucket &bucket, qint64 rate, qint64 now) const
+{
+    if (rate <= 0)
+    {
+        bucket.tokens = 0; // Unlimited: no debt is carried into a later limit
+    }
+    else
+    {
+        double burst = qMax<double>(MIN_BURST, rate * BURST_US / 1e6);
+        bucket.tokens = qMin(burst, bucket.tokens + rate * (now - bucket.refilledUs) / 1e6);
+    }
+    bucket.refilledUs = now;
+}
+
+/**
+ * @brief Time until the bucket has a positive balance again.
+ */
+qint64 BandwidthShaper::waitUs(const Bucket &bucket, qint64 rate) const
+{
+    if (rate <= 0 || bucket.tokens > 0)
+        return 0;
+    return static_cast<qint64>(std::ceil((1 - bucket.tokens) * 1e6 / rate));
+}
+
+/**
+ * @brief Rate of each download: the configured one, or an equal share of the global rate
+ * so one fast printer cannot take the whole global bucket.
+ */
+qint64 BandwidthShaper::connectionRate() const
+{
+    if (config.perConnectionRate > 0)
+        return config.perConnectionRate;
+    qint64 rate = effectiveRate();
+    if (rate <= 0 || connections.size() < 2)
+        return 0; // The global bucket alone limits a single download
+    return rate / connections.size();
+}
+
+/**
+ * @brief Closes the measurement window once it is complete and adjusts the adaptive rate.
+ */
+void BandwidthShaper::adapt(qint64 now)
+{
+    qint64 elapsed = now - windowStartUs;
+    if (elapsed < WINDOW_US)
+        return;
+
+    // A window left open across an idle period would spread its bytes over the pause
+    // and look like a very slow link; discard it instead
+    if (config.adaptive && elapsed <= 2 * WINDOW_US)
+    {
+        if (windowLinkBound && windowBytes > 0)
+        {
+            // The link is full: settle just below what it delivered
+            qint64 measured = windowBytes * 1000000 / elapsed;
+            adaptiveRate = qMax(MIN_ADAPTIVE_RATE, measured * (100 - config.controlReservePercent) / 100);
+        }
+        else if (windowShaped && adaptiveRate > 0)
+        {
+            // The buckets are the bottleneck: probe for more
+            adaptiveRate = static_cast<qint64>(adaptiveRate * PROBE_STEP);
+            if (config.globalRate > 0)
+                adaptiveRate = qMin(adaptiveRate, config.globalRate);
+        }
+    }
+
+    restartWindow(now);
+}
+
+/**
+ * @brief Starts a new measurement window, discarding the current one.
+ */
+void BandwidthShaper::restartWindow(qint64 now)
+{
+    windowStartUs = now;
+    windowBytes = 0;
+    windowLinkBound = false;
+    windowShaped = false;
+}
@@ -0,0 +1,137 @@
+#ifndef BANDWIDTHSHAPER_H
+#define BANDWIDTHSHAPER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief Upload rate limits of the HTTP file server.
+ */
+struct BandwidthLimits
+{
+    qint64 globalRate = 0;        ///< Bytes per second for all downloads together; 0 means unlimited.
+    qint64 perConnectionRate = 0; ///< Bytes per second for each download; 0 means a fair share of the global rate.
+    bool adaptive = true;         ///< Follow the measured link throughput, with globalRate as the ceiling.
+    int controlReservePercent = 10; ///< Share of the measured link kept free for control traffic.
+
+    /**
+     * @brief Parses "global[,per-printer[,adaptive]]", with rates in KB/s (e.g. "4096,1024,0").
+     * @param text The text to parse.
+     * @param ok Receives false if the text is malformed.
+     */
+    static BandwidthLimits fromString(const QString &text, bool &ok);
+};
+
+/**
+ * @class BandwidthShaper
+ * @brief Token buckets that pace the HTTP file downloads, per connection and globally.
+ *
+ * Bulk downloads to several printers easily fill the access point's queue, and the
+ * small MQTT frames (status reports, acknowledgements) then wait behind megabytes of
+ * file data. Every download connection takes tokens from its own bucket and from a
+ * shared one before it writes; MQTT is never shaped, so the headroom left by the
+ * limits belongs to the control channel.
+ *
+ * In adaptive mode the global rate tracks the link: when downloads are held back by
+ * their socket backlogs rather than by the buckets, the link is the bottleneck, and the
+ * rate is set to the throughput measured over the last window minus the control
+ * reserve. While the buckets are the bottleneck the rate is raised a step per window.
+ *
+ * Buckets may go into debt, so a whole gzip member can be written at once; the next
+ * write then waits until the debt is paid back. All methods are thread-safe, since the
+ * connections run on different broker workers.
+ */
+class BandwidthShaper
+{
+public:
+    BandwidthShaper();
+
+    /**
+     * @brief Replaces the limits. Running downloads follow them from their next write.
+     * @param limits The new limits.
+     */
+    void setLimits(const BandwidthLimits &limits);
+
+    /**
+     * @brief Returns the configured limits.
+     */
+    BandwidthLimits limits() const;
+
+    /**
+     * @brief Returns the global rate in effect (the adaptive one, if enabled), 0 if unlimited.
+     */
+    qint64 currentRate() const;
+
+    /**
+     * @brief Registers a download.
+     * @return The ID to pass to the other methods.
+     */
+    int addConnection();
+
+    /**
+     * @brief Forgets a download.
+     * @param id The ID from addConnection().
+     */
+    void removeConnection(int id);
+
+    /**
+     * @brief Returns how long a download must wait before its next write.
+     * @param id The ID from addConnection().
+     * @return Milliseconds to wait, 0 if it may write now.
+     */
+    qint64 delayFor(int id);
+
+    /**
+     * @brief Charges written bytes to the download's bucket and the global one.
+     * @param id The ID from addConnection().
+     * @param bytes The bytes handed to the socket.
+     */
+    void consume(int id, qint64 bytes);
+
+    /**
+     * @brief Tells the shaper that a download is waiting on its socket backlog, i.e. the
+     * link rather than the shaper is limiting it. Drives the adaptive rate.
+     */
+    void reportLinkBound();
+
+private:
+    /**
+     * @brief A token bucket; tokens are bytes.
+     */
+    struct Bucket
+    {
+        double tokens = 0;
+        qint64 refilledUs = 0; ///< Time of the last refill.
+    };
+
+    qint64 nowUs() const { return clock.nsecsElapsed() / 1000; }
+    qint64 effectiveRate() const;
+    void refill(Bucket &bucket, qint64 rate, qint64 now) const;
+    qint64 waitUs(const Bucket &bucket, qint64 rate) const;
+    qint64 connectionRate() const;
+    void adapt(qint64 now);
+    void restartWindow(qint64 now);
+
+    mutable QMutex mutex;            ///< Guards everything below.
+    QElapsedTimer clock;             ///< Time base of the buckets.
+    BandwidthLimits config;          ///< Configured limits.
+    qint64 adaptiveRate = 0;         ///< Rate found by adaptation; 0 until the link is first saturated.
+    Bucket global;                   ///< Shared by every download.
+    QHash<int, Bucket> connections;  ///< Per download.
+    int nextId = 1;                  ///< ID of the next download.
+
+    qint64 windowStartUs = 0;        ///< Start of the current measurement window.
+    qint64 windowBytes = 0;          ///< Bytes written in the window.
+    bool windowLinkBound = false;    ///< A download waited on its socket in the window.
+    bool windowShaped = false;       ///< A download waited on a bucket in the window.
+
+    const qint64 BURST_US = 100000;          ///< Buckets hold at most this much time worth of tokens.
+    const qint64 MIN_BURST = 64 * 1024;      ///< ... but never less than one write.
+    const qint64 WINDOW_US = 1000000;        ///< Measurement window of the adaptive rate.
+    const qint64 MIN_ADAPTIVE_RATE = 64 * 1024; ///< Adaptation never throttles below this.
+    const double PROBE_STEP = 1.1;           ///< Rate increase per window while the shaper is the bottleneck.
+};
+
+#endif // BANDWIDTHSHAPER_H
@@ -0,0 +1,78 @@
+#include "brokershards.h"
+
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#else
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Hands the accepted descriptor to the owner; no QTcpSocket is created here.
+ */
+void ShardedTcpServer::incomingConnection(qintptr descriptor)
+{
+    emit socketAccepted(descriptor);
+}
+
+/**
+ * @brief Closes a descriptor that no QTcpSocket owns.
+ */
+void ShardedTcpServer::closeDescriptor(qintptr descriptor)
+{
+#ifdef Q_OS_WIN
+    closesocket(static_cast<SOCKET>(descriptor));
+#else
+    ::close(static_cast<int>(descriptor));
+#endif
+}
+
+/**
+ * @brief Starts the worker threads.
+ * @param count Number of workers; 0 means one per core.
+ * @param parent The parent QObject.
+ */
+BrokerShards::BrokerShards(int count, QObject *parent) : QObject(parent)
+{
+    if (count <= 0)
+        count = qMax(1, QThread::idealThreadCount());
+
+    for (int i = 0; i < count; ++i)
+    {
+        QThread *thread = new QThread(this);
+        thread->setObjectName(QString("SaturnShard%1").arg(i));
+        thread->start();
+        threads.append(thread);
+    }
+}
+
+/**
+ * @brief Stops the workers before the threads are deleted with this object.
+ */
+BrokerShards::~BrokerShards()
+{
+    stop();
+}
+
+/**
+ * @brief Moves a connection object to the next worker, round-robin.
+ */
+QThread *BrokerShards::adopt(QObject *connection)
+{
+    QThread *thread = threads[next];
+    next = (next + 1) % threads.size();
+
+    connection->moveToThread(thread);
+    connect(thread, &QThread::finished, connection, &QObject::deleteLater);
+    return thread;
+}
+
+/**
+ * @brief Stops every worker. Objects still living on a worker are deleted as it finishes.
+ */
+void BrokerShards::stop()
+{
+    for (QThread *thread : threads)
+        thread->quit();
+    for (QThread *thread : threads)
+        thread->wait();
+}
@@ -0,0 +1,88 @@
+#ifndef BROKERSHARDS_H
+#define BROKERSHARDS_H
+
+#include <QObject>
+#include <QList>
+#include <QTcpServer>
+#include <QThread>
+
+/**
+ * @class ShardedTcpServer
+ * @brief A TCP server that hands every accepted socket descriptor to its owner instead of
+ * creating the socket itself, so the socket can be created on a worker thread.
+ */
+class ShardedTcpServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    using QTcpServer::QTcpServer;
+
+    /**
+     * @brief Closes an accepted descriptor that no socket took over, e.g. because
+     * QTcpSocket::setSocketDescriptor() failed. Deleting the connection object alone
+     * would leak it.
+     * @param descriptor The native socket descriptor.
+     */
+    static void closeDescriptor(qintptr descriptor);
+
+signals:
+    /**
+     * @brief Emitted for every accepted connection.
+     * @param descriptor The native socket descriptor. The receiver owns it.
+     */
+    void socketAccepted(qintptr descriptor);
+
+protected:
+    void incomingConnection(qintptr descriptor) override;
+};
+
+/**
+ * @class BrokerShards
+ * @brief A pool of worker threads, one event loop per core, that run the printers' connections.
+ *
+ * Each accepted MQTT or HTTP connection is pinned to one worker for its whole life: its
+ * socket, framing, acknowledgements and JSON decoding all run there, so a busy printer
+ * or a large transfer only loads its own core. Workers are chosen round-robin.
+ */
+class BrokerShards : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Starts the worker threads.
+     * @param count Number of workers; 0 means one per core.
+     * @param parent The parent QObject.
+     */
+    explicit BrokerShards(int count = 0, QObject *parent = nullptr);
+
+    /**
+     * @brief Stops the workers (see stop()).
+     */
+    ~BrokerShards() override;
+
+    /**
+     * @brief Moves a connection object to the next worker. The object is deleted when the
+     * worker stops, unless it has been deleted before.
+     * @param connection A parentless object that lives on the caller's thread.
+     * @return The worker the object now lives on.
+     */
+    QThread *adopt(QObject *connection);
+
+    /**
+     * @brief Stops every worker and waits for it. Objects still living on the workers are deleted.
+     */
+    void stop();
+
+    /**
+     * @brief Returns the number of workers.
+     */
+    int count() const { return static_cast<int>(threads.size()); }
+
+private:
+    QList<QThread *> threads; ///< The workers.
+    int next = 0;             ///< Worker that receives the next connection.
+};
+
+#endif // BROKERSHARDS_H
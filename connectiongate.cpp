@@ -0,0 +1,33 @@
+#include "connectiongate.h"
+
+/**
+ * @brief Takes a slot for a new connection, unless a cap is reached.
+ */
+bool ConnectionGate::tryAcquire(const QString &ip)
+{
+    QMutexLocker locker(&mutex);
+    int &count = perPeer[ip];
+    if (total >= maxTotal || count >= maxPerPeer)
+    {
+        if (count == 0)
+            perPeer.remove(ip);
+        return false;
+    }
+    count++;
+    total++;
+    return true;
+}
+
+/**
+ * @brief Gives back a slot taken with tryAcquire().
+ */
+void ConnectionGate::release(const QString &ip)
+{
+    QMutexLocker locker(&mutex);
+    auto it = perPeer.find(ip);
+    if (it == perPeer.end())
+        return;
+    if (--it.value() == 0)
+        perPeer.erase(it);
+    total--;
+}
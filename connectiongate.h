@@ -0,0 +1,45 @@
+#ifndef CONNECTIONGATE_H
+#define CONNECTIONGATE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @class ConnectionGate
+ * @brief Thread-safe caps on the number of open connections, in total and per peer.
+ * The backend owns one for the HTTP server; connections on the broker workers take a
+ * slot when they start and give it back when they go away.
+ */
+class ConnectionGate
+{
+public:
+    /**
+     * @brief Constructs a gate.
+     * @param maxTotal Most connections open at once.
+     * @param maxPerPeer Most connections open at once from one address.
+     */
+    ConnectionGate(int maxTotal, int maxPerPeer) : maxTotal(maxTotal), maxPerPeer(maxPerPeer) {}
+
+    /**
+     * @brief Takes a slot for a new connection.
+     * @param ip The peer's address.
+     * @return False if a cap is reached; the connection should be refused.
+     */
+    bool tryAcquire(const QString &ip);
+
+    /**
+     * @brief Gives back a slot taken with tryAcquire().
+     * @param ip The peer's address.
+     */
+    void release(const QString &ip);
+
+private:
+    QMutex mutex;                ///< Guards the counters.
+    QHash<QString, int> perPeer; ///< Open connections by address.
+    int total = 0;               ///< Open connections.
+    const int maxTotal;
+    const int maxPerPeer;
+};
+
+#endif // CONNECTIONGATE_H
@@ -0,0 +1,203 @@
+#include "etaestimator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+const double EWMA_ALPHA = 0.2;        ///< Weight of a new inlier in the moving average.
+const double MAD_TO_SIGMA = 1.4826;   ///< Scales the MAD to a standard deviation for normal data.
+const double OUTLIER_SIGMAS = 3.0;    ///< Samples further than this from the median are outliers.
+const double MIN_TOLERANCE = 0.1;     ///< Minimum tolerance as a fraction of the median (MAD can be 0).
+}
+
+/**
+ * @brief Sets the expected layer durations used until real samples arrive.
+ */
+void EtaEstimator::setPrior(int bottomLayers, double bottomLayerSeconds, double normalLayerSeconds)
+{
+    m_bottomLayers = qMax(0, bottomLayers);
+    m_priorBottomSeconds = qMax(0.0, bottomLayerSeconds);
+    m_priorNormalSeconds = qMax(0.0, normalLayerSeconds);
+}
+
+/**
+ * @brief Forgets the prior, falling back to measurements only.
+ */
+void EtaEstimator::clearPrior()
+{
+    setPrior(0, 0, 0);
+}
+
+/**
+ * @brief Clears all measurements but keeps the prior for the next print.
+ */
+void EtaEstimator::reset()
+{
+    m_bottom.clear();
+    m_normal.clear();
+    m_lastLayer = -1;
+    m_lastTimestampMs = 0;
+}
+
+/**
+ * @brief Feeds a layer report and updates the model of the layers that just finished.
+ * @param layer The current layer reported by the printer.
+ * @param timestampMs A monotonic timestamp of the report in milliseconds.
+ * @return True if the layer advanced or a new print started.
+ */
+bool EtaEstimator::addLayerReport(int layer, qint64 timestampMs)
+{
+    if (layer <= 0)
+        return false;
+
+    // First report of a print (or the printer went backwards: a new job)
+    if (m_lastLayer < 0 || layer < m_lastLayer)
+    {
+        reset();
+        m_lastLayer = layer;
+        m_lastTimestampMs = timestampMs;
+        return true;
+    }
+
+    if (layer == m_lastLayer)
+        return false;
+
+    // A skipped status update covers several layers: spread the time evenly instead
+    // of counting the whole interval once per layer.
+    int advanced = layer - m_lastLayer;
+    double perLayer = (timestampMs - m_lastTimestampMs) / 1000.0 / advanced;
+
+    if (m_lastLayer <= m_bottomLayers)
+        m_bottom.add(perLayer);
+    else
+        m_normal.add(perLayer);
+
+    m_lastLayer = layer;
+    m_lastTimestampMs = timestampMs;
+    return true;
+}
+
+/**
+ * @brief Computes the remaining time as bottom layers left times the bottom estimate
+ * plus normal layers left times the normal estimate.
+ * @return The remaining time in seconds, or -1 if a needed estimate is missing.
+ */
+double EtaEstimator::remainingSeconds(int currentLayer, int totalLayers) const
+{
+    if (totalLayers <= 0 || currentLayer < 0)
+        return -1;
+    if (currentLayer >= totalLayers)
+        return 0;
+
+    double normal = m_normal.estimate(m_priorNormalSeconds);
+    double bottom = m_bottom.estimate(m_priorBottomSeconds);
+
+    int layersLeft = totalLayers - currentLayer;
+    int bottomLeft = qBound(0, m_bottomLayers - currentLayer, layersLeft);
+    int normalLeft = layersLeft - bottomLeft;
+
+    if ((bottomLeft > 0 && bottom <= 0) || (normalLeft > 0 && normal <= 0))
+        return -1;
+
+    return bottomLeft * bottom + normalLeft * normal;
+}
+
+/**
+ * @brief Drops every sample of the model.
+ */
+void EtaEstimator::LayerModel::clear()
+{
+    m_head = 0;
+    m_count = 0;
+    m_ewma = 0;
+    m_outlierRun = 0;
+    m_outlierSide = 0;
+}
+
+/**
+ * @brief Adds a layer duration to the model.
+ * Samples far from the rolling median are kept in the ring buffer but do not move the
+ * average. SHIFT_RUN consecutive outliers on the same side restart the model from them.
+ * @param seconds The duration of one layer.
+ */
+void EtaEstimator::LayerModel::add(double seconds)
+{
+    if (seconds <= 0)
+        return;
+
+    bool outlier = false;
+    int side = 0;
+    if (m_count >= MIN_SAMPLES)
+    {
+        double center = median();
+        double tolerance = qMax(OUTLIER_SIGMAS * MAD_TO_SIGMA * medianAbsoluteDeviation(center), MIN_TOLERANCE * center);
+        if (std::fabs(seconds - center) > tolerance)
+        {
+            outlier = true;
+            side = seconds > center ? 1 : -1;
+        }
+    }
+
+    m_samples[m_head] = seconds;
+    m_head = (m_head + 1) % WINDOW;
+    m_count = qMin(m_count + 1, WINDOW);
+
+    if (!outlier)
+    {
+        m_outlierRun = 0;
+        m_outlierSide = 0;
+        m_ewma = (m_ewma <= 0) ? seconds : EWMA_ALPHA * seconds + (1.0 - EWMA_ALPHA) * m_ewma;
+        return;
+    }
+
+    m_outlierRun = (side == m_outlierSide) ? m_outlierRun + 1 : 1;
+    m_outlierSide = side;
+    if (m_outlierRun < SHIFT_RUN)
+        return;
+
+    // The pace really changed (e.g. bottom to normal layers): keep only the recent run
+    std::array<double, SHIFT_RUN> recent;
+    double sum = 0;
+    for (int i = 0; i < SHIFT_RUN; ++i)
+    {
+        recent[i] = m_samples[(m_head - SHIFT_RUN + i + WINDOW) % WINDOW];
+        sum += recent[i];
+    }
+    clear();
+    for (double sample : recent)
+        m_samples[m_head++] = sample;
+    m_count = SHIFT_RUN;
+    m_ewma = sum / SHIFT_RUN;
+}
+
+/**
+ * @brief Returns the smoothed layer duration, or the prior if there are no samples yet.
+ */
+double EtaEstimator::LayerModel::estimate(double prior) const
+{
+    return hasSamples() ? m_ewma : prior;
+}
+
+/**
+ * @brief Returns the median of the samples in the ring buffer.
+ */
+double EtaEstimator::LayerModel::median() const
+{
+    std::array<double, WINDOW> sorted = m_samples;
+    auto mid = sorted.begin() + m_count / 2;
+    std::nth_element(sorted.begin(), mid, sorted.begin() + m_count);
+    return *mid;
+}
+
+/**
+ * @brief Returns the median absolute deviation of the samples around a center.
+ */
+double EtaEstimator::LayerModel::medianAbsoluteDeviation(double center) const
+{
+    std::array<double, WINDOW> deviations;
+    for (int i = 0; i < m_count; ++i)
+        deviations[i] = std::fabs(m_samples[i] - center);
+    auto mid = deviations.begin() + m_count / 2;
+    std::nth_element(deviations.begin(), mid, deviations.begin() + m_count);
+    return *mid;
+}
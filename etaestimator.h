@@ -0,0 +1,103 @@
+#ifndef ETAESTIMATOR_H
+#define ETAESTIMATOR_H
+
+#include <QtGlobal>
+#include <array>
+
+/**
+ * @class EtaEstimator
+ * @brief Estimates the remaining print time from the layer reports of a printer.
+ *
+ * Bottom layers (long exposure) and normal layers are modelled separately. Each model
+ * keeps the most recent layer durations in a fixed-size ring buffer and tracks an
+ * exponentially weighted moving average fed only with inliers (samples close to the
+ * rolling median). A sustained run of outliers is treated as a genuine change of pace
+ * and re-seeds the model.
+ *
+ * The class has no Qt event-loop dependencies: timestamps are passed in explicitly, so a
+ * recorded layer timeline can be replayed through it deterministically.
+ */
+class EtaEstimator
+{
+public:
+    /**
+     * @brief Sets the expected layer durations, e.g. from the sliced file's header.
+     * The prior is used until real samples arrive and survives reset().
+     * @param bottomLayers Number of bottom layers in the job.
+     * @param bottomLayerSeconds Expected duration of a bottom layer (0 if unknown).
+     * @param normalLayerSeconds Expected duration of a normal layer (0 if unknown).
+     */
+    void setPrior(int bottomLayers, double bottomLayerSeconds, double normalLayerSeconds);
+
+    /**
+     * @brief Forgets the prior set by setPrior().
+     */
+    void clearPrior();
+
+    /**
+     * @brief Clears all measurements, keeping the prior. Call when a print ends.
+     */
+    void reset();
+
+    /**
+     * @brief Feeds a layer report from the printer.
+     * Reports that skip several layers are spread evenly over the skipped layers.
+     * @param layer The current layer reported by the printer.
+     * @param timestampMs A monotonic timestamp of the report in milliseconds.
+     * @return True if the layer advanced (so a new estimate is worth publishing).
+     */
+    bool addLayerReport(int layer, qint64 timestampMs);
+
+    /**
+     * @brief Computes the remaining time for the job.
+     * @param currentLayer The current layer.
+     * @param totalLayers The total number of layers in the job.
+     * @return The remaining time in seconds, or -1 if there is not enough data yet.
+     */
+    double remainingSeconds(int currentLayer, int totalLayers) const;
+
+    /**
+     * @brief Returns the last layer seen, or -1 if no print is being tracked.
+     */
+    int lastLayer() const { return m_lastLayer; }
+
+private:
+    /**
+     * @brief Robust running estimate of one kind of layer.
+     */
+    class LayerModel
+    {
+    public:
+        static constexpr int WINDOW = 32;     ///< Samples kept for the median.
+        static constexpr int MIN_SAMPLES = 5; ///< Samples needed before rejecting outliers.
+        static constexpr int SHIFT_RUN = 3;   ///< Consecutive outliers that signal a change of pace.
+
+        void clear();
+        void add(double seconds);
+        double estimate(double prior) const;
+        bool hasSamples() const { return m_count > 0; }
+
+    private:
+        double median() const;
+        double medianAbsoluteDeviation(double center) const;
+
+        std::array<double, WINDOW> m_samples{}; ///< Ring buffer of layer durations.
+        int m_head = 0;                         ///< Next write position in the ring buffer.
+        int m_count = 0;                        ///< Valid samples in the ring buffer.
+        double m_ewma = 0;                      ///< Smoothed layer duration (inliers only).
+        int m_outlierRun = 0;                   ///< Consecutive rejected samples on the same side.
+        int m_outlierSide = 0;                  ///< +1 if the run is slower than the median, -1 if faster.
+    };
+
+    LayerModel m_bottom;              ///< Model for the bottom layers.
+    LayerModel m_normal;              ///< Model for all other layers.
+
+    int m_bottomLayers = 0;           ///< Number of bottom layers (0 if unknown).
+    double m_priorBottomSeconds = 0;  ///< Expected bottom layer duration (0 if unknown).
+    double m_priorNormalSeconds = 0;  ///< Expected normal layer duration (0 if unknown).
+
+    int m_lastLayer = -1;             ///< Last layer reported.
+    qint64 m_lastTimestampMs = 0;     ///< Time at which m_lastLayer was reported.
+};
+
+#endif // ETAESTIMATOR_H
@@ -0,0 +1,39 @@
+#include "farmdelegate.h"
+#include "farmmodel.h"
+#include <QApplication>
+#include <QPainter>
+#include <QStyle>
+
+/**
+ * @brief Constructs the delegate.
+ * @param parent The parent QObject.
+ */
+FarmDelegate::FarmDelegate(QObject *parent) : QStyledItemDelegate(parent)
+{
+}
+
+/**
+ * @brief Draws a progress bar with the cell's text in the progress column.
+ */
+void FarmDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    int percent = index.data(FarmModel::ProgressRole).toInt();
+    if (index.column() != FarmModel::ProgressColumn || percent < 0)
+    {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+
+    QStyleOptionProgressBar bar;
+    bar.rect = option.rect.adjusted(2, 2, -2, -2);
+    bar.state = option.state | QStyle::State_Horizontal;
+    bar.minimum = 0;
+    bar.maximum = 100;
+    bar.progress = percent;
+    bar.text = index.data(Qt::DisplayRole).toString();
+    bar.textVisible = true;
+    bar.textAlignment = Qt::AlignCenter;
+
+    QStyle *style = option.widget ? option.widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ProgressBar, &bar, painter, option.widget);
+}
@@ -0,0 +1,27 @@
+#ifndef FARMDELEGATE_H
+#define FARMDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+/**
+ * @class FarmDelegate
+ * @brief Paints the farm dashboard's progress column as a progress bar.
+ *
+ * The bar is drawn with the current style directly into the cell, so the dashboard
+ * needs no widget per printer. Other columns use the default rendering.
+ */
+class FarmDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs the delegate.
+     * @param parent The parent QObject.
+     */
+    explicit FarmDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+};
+
+#endif // FARMDELEGATE_H
@@ -0,0 +1,212 @@
+#include "farmmodel.h"
+#include <QBrush>
+#include <QColor>
+
+/**
+ * @brief Constructs an empty model.
+ * @param parent The parent QObject.
+ */
+FarmModel::FarmModel(QObject *parent) : QAbstractTableModel(parent)
+{
+}
+
+int FarmModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rows.size();
+}
+
+int FarmModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+/**
+ * @brief Returns the data of one cell. Text is formatted here, on demand, so only the
+ * cells a view actually paints are ever formatted.
+ */
+QVariant FarmModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size())
+        return QVariant();
+
+    const Row &row = rows.at(index.row());
+    const PrinterStatus &status = row.status;
+
+    if (role == IpRole)
+        return row.ip;
+
+    switch (index.column())
+    {
+    case PrinterColumn:
+        if (role == Qt::DisplayRole)
+            return row.name.isEmpty() ? row.ip : QString("%1 (%2)").arg(row.name, row.ip);
+        if (role == Qt::ToolTipRole)
+            return row.model;
+        break;
+
+    case StatusColumn:
+        if (role == Qt::DisplayRole)
+            return statusText(status);
+        if (role == Qt::ForegroundRole)
+        {
+            if (status.isPrinting())
+                return QBrush(QColor(Qt::darkGreen));
+            if (status.state == PrinterStatus::State::Receiving)
+                return QBrush(QColor(255, 140, 0));
+            if (status.state == PrinterStatus::State::Disconnected || status.state == PrinterStatus::State::TransferError)
+                return QBrush(QColor(Qt::red));
+        }
+        break;
+
+    case ProgressColumn:
+        if (role == ProgressRole)
+            return progressPercent(status);
+        if (role == Qt::DisplayRole)
+        {
+            if (status.totalLayers > 0)
+                return QString(tr("%1 (Layer %2/%3)")).arg(status.filename).arg(status.layer).arg(status.totalLayers);
+            return status.filename;
+        }
+        break;
+
+    case EtaColumn:
+        if (role == Qt::DisplayRole && status.isPrinting())
+        {
+            if (status.remainingSeconds < 0)
+                return tr("Calculating...");
+            return QString("%1h %2m").arg(status.remainingSeconds / 3600).arg((status.remainingSeconds % 3600) / 60);
+        }
+        break;
+    }
+    return QVariant();
+}
+
+QVariant FarmModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section)
+    {
+    case PrinterColumn: return tr("Printer");
+    case StatusColumn: return tr("Status");
+    case ProgressColumn: return tr("Progress");
+    case EtaColumn: return tr("Remaining");
+    }
+    return QVariant();
+}
+
+/**
+ * @brief Formats a status snapshot's state in the current language.
+ */
+QString FarmModel::statusText(const PrinterStatus &status)
+{
+    switch (status.state)
+    {
+    case PrinterStatus::State::Disconnected: return tr("Connection lost. Reconnecting...");
+    case PrinterStatus::State::Ready: return tr("Ready");
+    case PrinterStatus::State::Receiving: return QString(tr("RECEIVING FILE (%1%)...")).arg(status.transferPercent);
+    case PrinterStatus::State::Processing: return tr("Processing file...");
+    case PrinterStatus::State::Exposing: return tr("Exposing Layer");
+    case PrinterStatus::State::Retracting: return tr("Retracting");
+    case PrinterStatus::State::Lowering: return tr("Lowering");
+    case PrinterStatus::State::Printing: return QString(tr("Printing (Code %1)")).arg(status.printCode);
+    case PrinterStatus::State::Paused: return tr("Complete / Paused");
+    case PrinterStatus::State::TransferError: return tr("Error in last transfer");
+    case PrinterStatus::State::Unknown: break;
+    }
+    return tr("Unknown");
+}
+
+/**
+ * @brief Asks the views to fetch every text again, after a language change.
+ */
+void FarmModel::retranslate()
+{
+    emit headerDataChanged(Qt::Horizontal, 0, ColumnCount - 1);
+    if (!rows.isEmpty())
+        emit dataChanged(index(0, 0), index(rows.size() - 1, ColumnCount - 1), {Qt::DisplayRole});
+}
+
+/**
+ * @brief Adds a printer found by discovery, or updates its name.
+ */
+void FarmModel::onPrinterFound(QString ip, QString name, QString model)
+{
+    int row = rowFor(ip);
+    if (rows[row].name == name && rows[row].model == model)
+        return;
+
+    rows[row].name = name;
+    rows[row].model = model;
+    QModelIndex cell = index(row, PrinterColumn);
+    emit dataChanged(cell, cell, {Qt::DisplayRole, Qt::ToolTipRole});
+}
+
+/**
+ * @brief Makes sure a printer that connected to our broker has a row.
+ */
+void FarmModel::onPrinterConnected(QString ip)
+{
+    rowFor(ip);
+}
+
+/**
+ * @brief Applies a printer's new status. The changed fields are mapped to a column
+ * range, and only that range of the row is reported to the views.
+ */
+void FarmModel::onPrinterStatusChanged(QString ip, PrinterStatus status, PrinterStatus::Fields changed)
+{
+    int row = rowFor(ip);
+    rows[row].status = status;
+
+    int first = ColumnCount;
+    int last = -1;
+    auto touch = [&first, &last](int column)
+    {
+        first = qMin(first, column);
+        last = qMax(last, column);
+    };
+
+    if (changed & (PrinterStatus::StateField | PrinterStatus::TransferField))
+        touch(StatusColumn);
+    if (changed & (PrinterStatus::LayerField | PrinterStatus::FileField | PrinterStatus::TransferField))
+        touch(ProgressColumn);
+    if (changed & (PrinterStatus::StateField | PrinterStatus::EtaField))
+        touch(EtaColumn);
+
+    if (last >= 0)
+        emit dataChanged(index(row, first), index(row, last));
+}
+
+/**
+ * @brief Returns the row of a printer, appending one if it is new.
+ */
+int FarmModel::rowFor(const QString &ip)
+{
+    auto it = rowByIp.constFind(ip);
+    if (it != rowByIp.cend())
+        return it.value();
+
+    int row = rows.size();
+    beginInsertRows(QModelIndex(), row, row);
+    Row entry;
+    entry.ip = ip;
+    rows.append(entry);
+    rowByIp.insert(ip, row);
+    endInsertRows();
+    return row;
+}
+
+/**
+ * @brief Returns the progress to draw for a status: layers while printing, the
+ * download while receiving, nothing otherwise.
+ */
+int FarmModel::progressPercent(const PrinterStatus &status)
+{
+    if (status.state == PrinterStatus::State::Receiving)
+        return status.transferPercent;
+    if (status.totalLayers > 0)
+        return (status.layer * 100) / status.totalLayers;
+    return -1;
+}
@@ -0,0 +1,108 @@
+#ifndef FARMMODEL_H
+#define FARMMODEL_H
+
+#include <QAbstractTableModel>
+#include <QList>
+#include <QHash>
+#include "printerstatus.h"
+
+/**
+ * @class FarmModel
+ * @brief Table model with one row per known printer, for the farm dashboard.
+ *
+ * Rows are appended as printers are discovered or connect, and are never rebuilt:
+ * a status update only emits dataChanged() for the columns whose fields changed, so
+ * a view over hundreds of printers repaints just the affected cells.
+ */
+class FarmModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief The columns of the table.
+     */
+    enum Column
+    {
+        PrinterColumn,  ///< Printer name and IP.
+        StatusColumn,   ///< State text, colored by state.
+        ProgressColumn, ///< Layer or transfer progress, drawn as a bar by FarmDelegate.
+        EtaColumn,      ///< Estimated time left.
+        ColumnCount
+    };
+
+    /**
+     * @brief Extra data roles.
+     */
+    enum Role
+    {
+        IpRole = Qt::UserRole,  ///< The printer's IP (any column).
+        ProgressRole            ///< Progress in percent, or -1 when there is nothing to show.
+    };
+
+    /**
+     * @brief Constructs an empty model.
+     * @param parent The parent QObject.
+     */
+    explicit FarmModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    /**
+     * @brief Formats a status snapshot's state in the current language.
+     * @param status The snapshot to describe.
+     * @return A text such as "Exposing Layer" or "RECEIVING FILE (42%)...".
+     */
+    static QString statusText(const PrinterStatus &status);
+
+    /**
+     * @brief Asks the views to fetch every text again, after a language change.
+     */
+    void retranslate();
+
+public slots:
+    /**
+     * @brief Adds a printer found by discovery, or updates its name.
+     * @param ip The printer's IP address.
+     * @param name The name the printer announced.
+     * @param model The printer's model.
+     */
+    void onPrinterFound(QString ip, QString name, QString model);
+
+    /**
+     * @brief Makes sure a printer that connected to our broker has a row.
+     * @param ip The printer's IP address.
+     */
+    void onPrinterConnected(QString ip);
+
+    /**
+     * @brief Applies a printer's new status, refreshing only the changed cells.
+     * @param ip The printer's IP address.
+     * @param status The new status snapshot.
+     * @param changed The fields that differ from the previous snapshot.
+     */
+    void onPrinterStatusChanged(QString ip, PrinterStatus status, PrinterStatus::Fields changed);
+
+private:
+    /**
+     * @brief What the dashboard shows for one printer.
+     */
+    struct Row
+    {
+        QString ip;
+        QString name;
+        QString model;
+        PrinterStatus status;
+    };
+
+    int rowFor(const QString &ip);
+    static int progressPercent(const PrinterStatus &status);
+
+    QList<Row> rows;               ///< One entry per printer, in order of appearance.
+    QHash<QString, int> rowByIp;   ///< Row index of each printer.
+};
+
+#endif // FARMMODEL_H
@@ -0,0 +1,402 @@
+#include "farmscheduler.h"
+#include "backend.h"
+#include "sliceheader.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QUuid>
+
+/**
+ * @brief Constructs the scheduler and starts listening to printer status reports.
+ * @param backend The backend that talks to the printers.
+ * @param parent The parent QObject.
+ */
+FarmScheduler::FarmScheduler(SaturnBackend *backend, QObject *parent)
+    : QObject(parent), backend(backend)
+{
+    monotonic.start();
+    timeoutTimer = new QTimer(this);
+    timeoutTimer->setInterval(5000);
+
+    connect(backend, &SaturnBackend::printerStatus, this, &FarmScheduler::onPrinterStatus);
+    connect(backend, &SaturnBackend::printerProgress, this, &FarmScheduler::onPrinterProgress);
+    connect(backend, &SaturnBackend::uploadSkipped, this, &FarmScheduler::onUploadSkipped);
+    connect(backend, &SaturnBackend::uploadStarted, this, &FarmScheduler::onUploadStarted);
+    connect(timeoutTimer, &QTimer::timeout, this, &FarmScheduler::onTimeoutTimer);
+}
+
+/**
+ * @brief Adds a file to the end of the queue and tries to dispatch it right away.
+ * @param filePath The local path of the file.
+ * @param machineName Required printer model; if empty, it is read from the file header.
+ * @return The new job's ID.
+ */
+QString FarmScheduler::enqueue(const QString &filePath, const QString &machineName)
+{
+    FarmJob job;
+    job.id = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    job.filePath = filePath;
+    job.machineName = machineName.isEmpty() ? SliceFileInfo::read(filePath).machineName : machineName;
+    queue.append(job);
+
+    save();
+    emit queueChanged(queue.size(), dispatches.size());
+    dispatch();
+    return job.id;
+}
+
+/**
+ * @brief Removes a job that has not been sent to a printer yet.
+ * @param jobId The job's ID.
+ * @return True if the job was found in the queue.
+ */
+bool FarmScheduler::remove(const QString &jobId)
+{
+    for (int i = 0; i < queue.size(); ++i)
+    {
+        if (queue[i].id == jobId)
+        {
+            queue.removeAt(i);
+            save();
+            emit queueChanged(queue.size(), dispatches.size());
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Sets the global cap on simultaneous uploads.
+ * @param limit The maximum number of concurrent uploads (at least 1).
+ */
+void FarmScheduler::setMaxConcurrentUploads(int limit)
+{
+    maxConcurrentUploads = qMax(1, limit);
+    dispatch();
+}
+
+/**
+ * @brief Records a printer's status and moves its dispatch (if any) forward.
+ * A dispatch only counts a finished transfer after it has seen the transfer start,
+ * because the printer keeps reporting the result of its previous transfer until then.
+ * A staged job is started as soon as its printer reports ready.
+ */
+void FarmScheduler::onPrinterStatus(QString ip, int currentStatus, int printStatus, int transferStatus)
+{
+    PrinterState &state = printers[ip];
+    state.currentStatus = currentStatus;
+    state.printStatus = printStatus;
+
+    auto it = dispatches.find(ip);
+    if (it != dispatches.end())
+    {
+        Dispatch &d = it.value();
+        if (!d.transferDone)
+        {
+            if (d.transferSeen && transferStatus == 3)
+            {
+                failDispatch(ip, tr("Transfer error"));
+                return;
+            }
+            if (d.transferSeen && transferStatus == 2)
+            {
+                d.transferDone = true; // Frees an upload slot
+                d.sinceMs = monotonic.elapsed();
+            }
+            else if (transferStatus == 1 || (currentStatus == 1 && !d.staged)) // A staged printer is busy printing anyway
+            {
+                d.transferSeen = true;
+                d.sinceMs = monotonic.elapsed();
+            }
+
+            if (d.transferDone && d.staged)
+                emit jobStaged(d.job.id, ip);
+        }
+
+        if (d.transferDone && d.staged && !d.startSent && currentStatus == 0)
+        {
+            // The previous print is over: start the staged file right away
+            backend->printExistingFile(ip, QFileInfo(d.job.filePath).fileName());
+            d.startSent = true;
+            d.sinceMs = monotonic.elapsed();
+        }
+        else if (d.transferDone && (!d.staged || d.startSent) && currentStatus == 1 && printStatus > 0)
+        {
+            finishDispatch(ip);
+        }
+    }
+
+    dispatch();
+}
+
+/**
+ * @brief Records print progress, which decides when a printer is in the tail of its job.
+ */
+void FarmScheduler::onPrinterProgress(QString ip, int layer, int totalLayers, int remainingSeconds)
+{
+    PrinterState &state = printers[ip];
+    bool wasInTail = isInTail(state);
+    state.layer = layer;
+    state.totalLayers = totalLayers;
+    state.remainingSeconds = remainingSeconds;
+
+    if (!wasInTail && isInTail(state))
+        dispatch();
+}
+
+/**
+ * @brief Marks the dispatch on a printer as transferred when its file was already there.
+ * An immediate dispatch has had its print command sent by the backend; a staged one now
+ * waits for the printer to become ready, as after a real transfer.
+ */
+void FarmScheduler::onUploadSkipped(QString ip, QString filename)
+{
+    auto it = dispatches.find(ip);
+    if (it == dispatches.end() || it->transferDone || QFileInfo(it->job.filePath).fileName() != filename)
+        return;
+
+    it->transferSeen = true;
+    it->transferDone = true;
+    it->sinceMs = monotonic.elapsed();
+    if (it->staged)
+        emit jobStaged(it->job.id, ip);
+}
+
+/**
+ * @brief Marks the dispatch on a printer as transferring once the printer requests its file.
+ * A staged printer keeps reporting its print, and a short transfer may start and end
+ * between two status reports, so the reports alone can miss it.
+ */
+void FarmScheduler::onUploadStarted(QString ip, QString filename)
+{
+    auto it = dispatches.find(ip);
+    if (it == dispatches.end() || it->transferSeen || QFileInfo(it->job.filePath).fileName() != filename)
+        return;
+
+    it->transferSeen = true;
+    it->sinceMs = monotonic.elapsed();
+}
+
+/**
+ * @brief Fails dispatches whose download never began or whose print never started.
+ * Staged jobs waiting for the current print to end have no deadline.
+ */
+void FarmScheduler::onTimeoutTimer()
+{
+    qint64 now = monotonic.elapsed();
+    QStringList expired;
+    for (auto it = dispatches.cbegin(); it != dispatches.cend(); ++it)
+    {
+        const Dispatch &d = it.value();
+        if (d.staged && d.transferDone && !d.startSent)
+            continue;
+        qint64 limit = d.transferDone ? PRINT_START_TIMEOUT_MS : TRANSFER_START_TIMEOUT_MS;
+        if ((d.transferDone || !d.transferSeen) && now - d.sinceMs > limit)
+            expired.append(it.key());
+    }
+
+    for (const QString &ip : expired)
+        failDispatch(ip, dispatches[ip].transferDone ? tr("Print did not start") : tr("Transfer did not start"));
+
+    if (dispatches.isEmpty())
+        timeoutTimer->stop();
+}
+
+/**
+ * @brief Sends queued jobs to idle printers, oldest job first, within the upload limit.
+ */
+void FarmScheduler::dispatch()
+{
+    int uploading = uploadsInFlight();
+
+    for (int i = 0; i < queue.size() && uploading < maxConcurrentUploads;)
+    {
+        bool staged = false;
+        QString target = findPrinter(queue[i], staged);
+
+        if (target.isEmpty())
+        {
+            ++i; // No printer for this job yet; a later job may fit another model
+            continue;
+        }
+
+        Dispatch d;
+        d.job = queue.takeAt(i);
+        d.sinceMs = monotonic.elapsed();
+        d.staged = staged;
+        dispatches.insert(target, d);
+        uploading++;
+
+        backend->uploadAndPrint(target, d.job.filePath, !staged);
+        emit jobDispatched(d.job.id, target);
+        emit queueChanged(queue.size(), dispatches.size());
+        save();
+
+        if (!timeoutTimer->isActive())
+            timeoutTimer->start();
+    }
+}
+
+/**
+ * @brief Completes the dispatch on a printer that started printing.
+ * @param ip The printer's IP address.
+ */
+void FarmScheduler::finishDispatch(const QString &ip)
+{
+    Dispatch d = dispatches.take(ip);
+    save();
+    emit jobStarted(d.job.id, ip);
+    emit queueChanged(queue.size(), dispatches.size());
+}
+
+/**
+ * @brief Puts a failed job back at the front of the queue, or drops it after MAX_ATTEMPTS.
+ * @param ip The printer's IP address.
+ * @param reason A short description of the problem.
+ */
+void FarmScheduler::failDispatch(const QString &ip, const QString &reason)
+{
+    Dispatch d = dispatches.take(ip);
+    d.job.attempts++;
+
+    if (d.job.attempts < MAX_ATTEMPTS)
+        queue.prepend(d.job);
+    else
+        emit jobFailed(d.job.id, d.job.filePath, reason);
+
+    save();
+    emit queueChanged(queue.size(), dispatches.size());
+    dispatch();
+}
+
+/**
+ * @brief Picks a printer for a job: an idle one if possible, otherwise one in the tail of its print.
+ * @param job The job to place.
+ * @param staged Set to true if the chosen printer is still printing.
+ * @return The printer's IP address, or an empty string if none fits.
+ */
+QString FarmScheduler::findPrinter(const FarmJob &job, bool &staged) const
+{
+    QString tail;
+    for (auto it = printers.cbegin(); it != printers.cend(); ++it)
+    {
+        const QString &ip = it.key();
+        if (dispatches.contains(ip) || !backend->isPrinterConnected(ip) || !isCompatible(job, ip))
+            continue;
+
+        if (it->currentStatus == 0)
+        {
+            staged = false;
+            return ip;
+        }
+        if (tail.isEmpty() && isInTail(it.value()))
+            tail = ip;
+    }
+
+    staged = !tail.isEmpty();
+    return tail;
+}
+
+/**
+ * @brief Checks whether a printer is close enough to the end of its print to pre-stage.
+ */
+bool FarmScheduler::isInTail(const PrinterState &state) const
+{
+    if (stagingLeadSeconds <= 0 || state.currentStatus != 1 || state.printStatus <= 0 ||
+        state.printStatus == static_cast<int>(PrintStatus::COMPLETE) || state.totalLayers <= 0)
+        return false;
+
+    if (state.remainingSeconds >= 0)
+        return state.remainingSeconds <= stagingLeadSeconds;
+    return state.layer * 10 >= state.totalLayers * 9;
+}
+
+/**
+ * @brief Checks that a printer's model matches the model the job was sliced for.
+ */
+bool FarmScheduler::isCompatible(const FarmJob &job, const QString &ip) const
+{
+    if (job.machineName.isEmpty())
+        return true;
+    return backend->printerModel(ip).compare(job.machineName, Qt::CaseInsensitive) == 0;
+}
+
+/**
+ * @brief Counts dispatches whose download has not finished yet.
+ */
+int FarmScheduler::uploadsInFlight() const
+{
+    int count = 0;
+    for (const Dispatch &d : dispatches)
+    {
+        if (!d.transferDone)
+            count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the file the queue is saved to.
+ */
+QString FarmScheduler::storagePath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/jobqueue.json";
+}
+
+/**
+ * @brief Saves the queue as JSON. Jobs still being delivered are saved too, so that
+ * they are dispatched again if the application stops before they start printing.
+ */
+void FarmScheduler::save() const
+{
+    QJsonArray array;
+    auto append = [&array](const FarmJob &job)
+    {
+        QJsonObject obj;
+        obj["Id"] = job.id;
+        obj["FilePath"] = job.filePath;
+        obj["MachineName"] = job.machineName;
+        obj["Attempts"] = job.attempts;
+        array.append(obj);
+    };
+    for (const Dispatch &d : dispatches)
+        append(d.job);
+    for (const FarmJob &job : queue)
+        append(job);
+
+    QString path = storagePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile f(path);
+    if (f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        f.write(QJsonDocument(array).toJson(QJsonDocument::Compact));
+}
+
+/**
+ * @brief Loads the queue saved by a previous run, skipping files that no longer exist.
+ */
+void FarmScheduler::load()
+{
+    QFile f(storagePath());
+    if (!f.open(QIODevice::ReadOnly))
+        return;
+
+    const QJsonArray array = QJsonDocument::fromJson(f.readAll()).array();
+    for (const QJsonValue &value : array)
+    {
+        QJsonObject obj = value.toObject();
+        FarmJob job;
+        job.id = obj["Id"].toString();
+        job.filePath = obj["FilePath"].toString();
+        job.machineName = obj["MachineName"].toString();
+        job.attempts = obj["Attempts"].toInt();
+        if (!job.id.isEmpty() && QFileInfo::exists(job.filePath))
+            queue.append(job);
+    }
+
+    emit queueChanged(queue.size(), dispatches.size());
+    dispatch();
+}
@@ -0,0 +1,199 @@
+#ifndef FARMSCHEDULER_H
+#define FARMSCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class SaturnBackend;
+
+/**
+ * @brief A sliced file waiting to be printed somewhere in the farm.
+ */
+struct FarmJob
+{
+    QString id;          ///< Unique job ID.
+    QString filePath;    ///< Local path of the .goo/.ctb file.
+    QString machineName; ///< Printer model the file was sliced for (empty = any printer).
+    int attempts = 0;    ///< Failed transfers so far.
+};
+
+/**
+ * @class FarmScheduler
+ * @brief Keeps a queue of print jobs and dispatches each one to the first idle, compatible printer.
+ *
+ * The scheduler watches every printer's status through SaturnBackend::printerStatus and
+ * sends the next job with uploadAndPrint() (auto-start on) as soon as a connected printer
+ * of the right model is ready. A global limit caps how many uploads run at once, and the
+ * queue is saved to disk so it survives restarts.
+ *
+ * Printers in the tail of a print are also eligible: the next job is uploaded without
+ * auto-start while the current one finishes ("staged"), and started with command 128 as
+ * soon as the printer reports ready, so the upload never adds to printer idle time.
+ */
+class FarmScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs the scheduler on top of a backend.
+     * @param backend The backend that talks to the printers.
+     * @param parent The parent QObject.
+     */
+    explicit FarmScheduler(SaturnBackend *backend, QObject *parent = nullptr);
+
+    /**
+     * @brief Adds a file to the end of the queue.
+     * @param filePath The local path of the file.
+     * @param machineName Required printer model; if empty, it is read from the file header.
+     * @return The new job's ID.
+     */
+    QString enqueue(const QString &filePath, const QString &machineName = QString());
+
+    /**
+     * @brief Removes a queued job (jobs already sent to a printer cannot be removed).
+     * @param jobId The job's ID.
+     * @return True if the job was found in the queue.
+     */
+    bool remove(const QString &jobId);
+
+    /**
+     * @brief Returns the jobs still waiting for a printer, in dispatch order.
+     */
+    QList<FarmJob> queuedJobs() const { return queue; }
+
+    /**
+     * @brief Sets how many uploads may run at the same time across the whole farm.
+     * @param limit The maximum number of concurrent uploads (at least 1).
+     */
+    void setMaxConcurrentUploads(int limit);
+
+    /**
+     * @brief Sets how long before the end of a print the next job may be pre-staged.
+     * When the remaining time is unknown, the last 10% of the layers count as the tail.
+     * @param seconds The lead time in seconds; 0 disables pre-staging.
+     */
+    void setStagingLeadTime(int seconds) { stagingLeadSeconds = qMax(0, seconds); }
+
+    /**
+     * @brief Loads the queue saved by a previous run.
+     */
+    void load();
+
+signals:
+    /**
+     * @brief Emitted when a job is sent to a printer.
+     * @param jobId The job's ID.
+     * @param ip The printer's IP address.
+     */
+    void jobDispatched(QString jobId, QString ip);
+
+    /**
+     * @brief Emitted when a pre-staged job has been fully transferred and waits for the printer.
+     * @param jobId The job's ID.
+     * @param ip The printer's IP address.
+     */
+    void jobStaged(QString jobId, QString ip);
+
+    /**
+     * @brief Emitted when the printer starts printing a dispatched job.
+     * @param jobId The job's ID.
+     * @param ip The printer's IP address.
+     */
+    void jobStarted(QString jobId, QString ip);
+
+    /**
+     * @brief Emitted when a job could not be delivered and was given up.
+     * @param jobId The job's ID.
+     * @param filePath The job's file.
+     * @param reason A short description of the problem.
+     */
+    void jobFailed(QString jobId, QString filePath, QString reason);
+
+    /**
+     * @brief Emitted whenever the queue or the set of running dispatches changes.
+     * @param queued Jobs waiting for a printer.
+     * @param dispatched Jobs sent to a printer that has not started printing them yet.
+     */
+    void queueChanged(int queued, int dispatched);
+
+private slots:
+    /**
+     * @brief Tracks the printer's state and dispatches jobs when printers become idle.
+     */
+    void onPrinterStatus(QString ip, int currentStatus, int printStatus, int transferStatus);
+
+    /**
+     * @brief Tracks print progress to find printers in the tail of their job.
+     */
+    void onPrinterProgress(QString ip, int layer, int totalLayers, int remainingSeconds);
+
+    /**
+     * @brief Treats a job whose file was already on the printer as transferred.
+     */
+    void onUploadSkipped(QString ip, QString filename);
+
+    /**
+     * @brief Marks a dispatch's transfer as started when the printer requests the file.
+     */
+    void onUploadStarted(QString ip, QString filename);
+
+    /**
+     * @brief Gives up on dispatches whose transfer or print never started.
+     */
+    void onTimeoutTimer();
+
+private:
+    /**
+     * @brief A job that has been sent to a printer but has not started printing yet.
+     */
+    struct Dispatch
+    {
+        FarmJob job;                ///< The job being delivered.
+        bool transferSeen = false;  ///< The printer started downloading.
+        bool transferDone = false;  ///< The download finished; waiting for the print to start.
+        bool staged = false;        ///< Uploaded during the previous print, without auto-start.
+        bool startSent = false;     ///< The print command for a staged job has been sent.
+        qint64 sinceMs = 0;         ///< Monotonic time of the last state change.
+    };
+
+    /**
+     * @brief Last status seen from a printer.
+     */
+    struct PrinterState
+    {
+        int currentStatus = -1;
+        int printStatus = 0;
+        int layer = 0;
+        int totalLayers = 0;
+        int remainingSeconds = -1;
+    };
+
+    void dispatch();
+    void finishDispatch(const QString &ip);
+    void failDispatch(const QString &ip, const QString &reason);
+    bool isCompatible(const FarmJob &job, const QString &ip) const;
+    bool isInTail(const PrinterState &state) const;
+    QString findPrinter(const FarmJob &job, bool &staged) const;
+    int uploadsInFlight() const;
+    void save() const;
+    QString storagePath() const;
+
+    SaturnBackend *backend;              ///< The backend used to reach the printers.
+    QList<FarmJob> queue;                ///< Jobs waiting for a printer.
+    QMap<QString, Dispatch> dispatches;  ///< Jobs in delivery, keyed by printer IP.
+    QMap<QString, PrinterState> printers; ///< Last known state of each printer, keyed by IP.
+    int maxConcurrentUploads = 2;        ///< Global cap on simultaneous uploads.
+    int stagingLeadSeconds = 20 * 60;    ///< How early before the end of a print to pre-stage.
+    QTimer *timeoutTimer;                ///< Checks dispatches for timeouts.
+    QElapsedTimer monotonic;             ///< Monotonic clock for timeouts.
+
+    const qint64 TRANSFER_START_TIMEOUT_MS = 60 * 1000; ///< Time allowed for the download to begin.
+    const qint64 PRINT_START_TIMEOUT_MS = 120 * 1000;   ///< Time allowed between download end and printing.
+    const int MAX_ATTEMPTS = 3;                         ///< Transfers tried before a job fails.
+};
+
+#endif // FARMSCHEDULER_H
@@ -0,0 +1,74 @@
+#include "filedigest.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+
+namespace
+{
+const qint64 CHUNK_SIZE = 1024 * 1024; ///< Bytes read per step.
+const int MAX_CACHED = 256;            ///< Entries kept before the cache is flushed.
+
+/**
+ * @brief A cached digest, valid while the file keeps its size and modification time.
+ */
+struct CachedDigest
+{
+    qint64 size = -1;
+    QDateTime modified;
+    QString md5;
+};
+
+QMutex cacheMutex;
+QHash<QString, CachedDigest> cache;
+}
+
+/**
+ * @brief Returns the cached MD5 of a file without reading it.
+ */
+QString FileDigest::cachedMd5(const QString &filePath)
+{
+    QFileInfo fi(filePath);
+    QMutexLocker locker(&cacheMutex);
+    auto it = cache.constFind(fi.absoluteFilePath());
+    if (it == cache.cend() || it->size != fi.size() || it->modified != fi.lastModified())
+        return QString();
+    return it->md5;
+}
+
+/**
+ * @brief Returns the MD5 of a file, hashing it in chunks if it is not cached.
+ */
+QString FileDigest::md5(const QString &filePath)
+{
+    QString cached = cachedMd5(filePath);
+    if (!cached.isEmpty())
+        return cached;
+
+    QFile f(filePath);
+    if (!f.open(QIODevice::ReadOnly))
+        return QString();
+
+    QFileInfo fi(filePath);
+    CachedDigest entry;
+    entry.size = fi.size();
+    entry.modified = fi.lastModified();
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    while (!f.atEnd())
+    {
+        QByteArray chunk = f.read(CHUNK_SIZE);
+        if (chunk.isEmpty())
+            return QString(); // Read error
+        hash.addData(chunk);
+    }
+    entry.md5 = QString(hash.result().toHex());
+
+    QMutexLocker locker(&cacheMutex);
+    if (cache.size() >= MAX_CACHED)
+        cache.clear();
+    cache.insert(fi.absoluteFilePath(), entry);
+    return entry.md5;
+}
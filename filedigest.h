@@ -0,0 +1,32 @@
+#ifndef FILEDIGEST_H
+#define FILEDIGEST_H
+
+#include <QString>
+
+/**
+ * @class FileDigest
+ * @brief Streaming MD5 of local files, with a process-wide cache.
+ *
+ * Files are hashed in fixed-size chunks, so memory use does not grow with the file.
+ * Results are cached by path, size and modification time, so a file hashed ahead of
+ * time (e.g. by the hot folder) costs nothing when it is uploaded. Thread-safe.
+ */
+class FileDigest
+{
+public:
+    /**
+     * @brief Returns the MD5 of a file as lowercase hex, from the cache if it is still valid.
+     * @param filePath The local file.
+     * @return The digest, or an empty string if the file cannot be read.
+     */
+    static QString md5(const QString &filePath);
+
+    /**
+     * @brief Returns the cached MD5 of a file without reading it.
+     * @param filePath The local file.
+     * @return The digest, or an empty string if it is not cached or the file changed.
+     */
+    static QString cachedMd5(const QString &filePath);
+};
+
+#endif // FILEDIGEST_H
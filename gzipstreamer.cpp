@@ -0,0 +1,193 @@
+#include "gzipstreamer.h"
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QtEndian>
+#include <array>
+
+namespace
+{
+const qint64 BLOCK_SIZE = 1024 * 1024; ///< Uncompressed bytes per gzip member.
+const int COMPRESSION_LEVEL = 6;       ///< zlib level: good ratio without starving the link.
+const int ZLIB_HEADER_SIZE = 2;        ///< CMF and FLG bytes of a zlib stream.
+const int ZLIB_TRAILER_SIZE = 4;       ///< Adler-32 checksum of a zlib stream.
+const int QCOMPRESS_PREFIX_SIZE = 4;   ///< Length prefix added by qCompress().
+
+/**
+ * @brief Builds the lookup table for the CRC-32 used by gzip (polynomial 0xEDB88320).
+ */
+std::array<quint32, 256> makeCrcTable()
+{
+    std::array<quint32, 256> table{};
+    for (quint32 n = 0; n < 256; ++n)
+    {
+        quint32 c = n;
+        for (int k = 0; k < 8; ++k)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table[n] = c;
+    }
+    return table;
+}
+
+/**
+ * @brief Computes the gzip CRC-32 of a buffer.
+ */
+quint32 crc32(const QByteArray &data)
+{
+    static const std::array<quint32, 256> table = makeCrcTable();
+    quint32 c = 0xFFFFFFFFu;
+    for (char byte : data)
+        c = table[(c ^ static_cast<quint8>(byte)) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+/**
+ * @brief Wraps a block into a complete gzip member.
+ * qCompress() produces a zlib stream; stripping its prefix, header and Adler-32 leaves a
+ * raw deflate stream, which gzip frames with its own header, CRC-32 and size.
+ */
+QByteArray makeGzipMember(const QByteArray &block)
+{
+    QByteArray zlib = qCompress(block, COMPRESSION_LEVEL);
+    const int skip = QCOMPRESS_PREFIX_SIZE + ZLIB_HEADER_SIZE;
+    QByteArray member;
+    member.reserve(zlib.size() + 16);
+
+    static const char header[10] = {'\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff'};
+    member.append(header, sizeof(header));
+    member.append(zlib.constData() + skip, zlib.size() - skip - ZLIB_TRAILER_SIZE);
+
+    uchar trailer[8];
+    qToLittleEndian<quint32>(crc32(block), trailer);
+    qToLittleEndian<quint32>(static_cast<quint32>(block.size()), trailer + 4);
+    member.append(reinterpret_cast<const char *>(trailer), sizeof(trailer));
+    return member;
+}
+
+/**
+ * @brief The compression pool shared by every streamer, one thread per core.
+ */
+QThreadPool *compressionPool()
+{
+    static QThreadPool *pool = []()
+    {
+        QThreadPool *p = new QThreadPool;
+        p->setObjectName("SaturnGzip");
+        p->setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+        return p;
+    }();
+    return pool;
+}
+}
+
+/**
+ * @brief Constructs a streamer for a local file.
+ * @param filePath The file to compress.
+ * @param parent The parent QObject.
+ */
+GzipStreamer::GzipStreamer(const QString &filePath, QObject *parent)
+    : QObject(parent), m_filePath(filePath), m_guard(std::make_shared<BlockGuard>())
+{
+    m_guard->owner = this;
+    m_maxAhead = 2 * compressionPool()->maxThreadCount();
+}
+
+/**
+ * @brief Detaches the streamer from blocks that may still be queued or running.
+ */
+GzipStreamer::~GzipStreamer()
+{
+    QMutexLocker locker(&m_guard->mutex);
+    m_guard->owner = nullptr;
+}
+
+/**
+ * @brief Reads the file size and schedules the first blocks.
+ * @return False if the file cannot be opened.
+ */
+bool GzipStreamer::start()
+{
+    QFile f(m_filePath);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+
+    m_inputSize = f.size();
+    m_blockCount = static_cast<int>((m_inputSize + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    schedule();
+    return true;
+}
+
+/**
+ * @brief Takes the next member in file order and lets the compressors move ahead.
+ * @param member Receives the compressed member.
+ * @return True if a member was returned.
+ */
+bool GzipStreamer::read(QByteArray &member)
+{
+    auto it = m_ready.find(m_nextToDeliver);
+    if (it == m_ready.end())
+        return false;
+
+    member = it.value();
+    m_ready.erase(it);
+    m_outputSize += member.size();
+    m_nextToDeliver++;
+    schedule();
+    return true;
+}
+
+/**
+ * @brief Hands blocks to the pool while staying within m_maxAhead of the consumer.
+ * Each worker opens the file itself, so reads run in parallel too.
+ */
+void GzipStreamer::schedule()
+{
+    while (m_nextToSchedule < m_blockCount && m_nextToSchedule - m_nextToDeliver < m_maxAhead)
+    {
+        const int index = m_nextToSchedule++;
+        const QString path = m_filePath;
+        std::shared_ptr<BlockGuard> guard = m_guard;
+        compressionPool()->start([guard, index, path]()
+                                 {
+            {
+                QMutexLocker locker(&guard->mutex);
+                if (!guard->owner)
+                    return; // The upload was abandoned before this block's turn
+            }
+
+            QByteArray member;
+            QFile f(path);
+            if (f.open(QIODevice::ReadOnly) && f.seek(index * BLOCK_SIZE))
+            {
+                QByteArray block = f.read(BLOCK_SIZE);
+                if (!block.isEmpty())
+                    member = makeGzipMember(block);
+            }
+
+            // Deliver on the streamer's thread, if it still exists
+            QMutexLocker locker(&guard->mutex);
+            if (GzipStreamer *owner = guard->owner)
+            {
+                QMetaObject::invokeMethod(owner, [owner, index, member]()
+                                          { owner->onBlockDone(index, member); }, Qt::QueuedConnection);
+            } });
+    }
+}
+
+/**
+ * @brief Stores a finished member and signals the consumer if it is the next one.
+ * @param index The block number.
+ * @param member The gzip member, or an empty array if the block could not be read.
+ */
+void GzipStreamer::onBlockDone(int index, const QByteArray &member)
+{
+    if (member.isEmpty())
+    {
+        emit failed(QString(tr("Could not read block %1 of %2")).arg(index).arg(m_filePath));
+        return;
+    }
+
+    m_ready.insert(index, member);
+    if (index == m_nextToDeliver)
+        emit dataReady();
+}
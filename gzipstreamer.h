@@ -0,0 +1,104 @@
+#ifndef GZIPSTREAMER_H
+#define GZIPSTREAMER_H
+
+#include <QObject>
+#include <QMap>
+#include <QMutex>
+#include <memory>
+
+/**
+ * @class GzipStreamer
+ * @brief Compresses a file into a gzip stream using every core, while it is being sent.
+ *
+ * The file is split into fixed-size blocks that are compressed in parallel on a thread
+ * pool shared by every streamer, so concurrent uploads do not oversubscribe the cores.
+ * Each block becomes an independent gzip member; a sequence of members is a valid gzip
+ * stream (RFC 1952, section 2.2), the same trick used by bgzip and pigz. Members are
+ * handed out strictly in order, and compression never runs more than a few blocks
+ * ahead of the consumer, so memory use stays bounded for any file size.
+ */
+class GzipStreamer : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs a streamer for a local file. Call start() to begin compressing.
+     * @param filePath The file to compress.
+     * @param parent The parent QObject.
+     */
+    explicit GzipStreamer(const QString &filePath, QObject *parent = nullptr);
+
+    /**
+     * @brief Detaches the streamer from its blocks; queued ones are skipped and running
+     * ones discard their result.
+     */
+    ~GzipStreamer() override;
+
+    /**
+     * @brief Starts compressing the first blocks.
+     * @return False if the file cannot be opened.
+     */
+    bool start();
+
+    /**
+     * @brief Takes the next gzip member, if it is ready.
+     * @param member Receives the compressed member.
+     * @return True if a member was returned.
+     */
+    bool read(QByteArray &member);
+
+    /**
+     * @brief Returns true once every member has been handed out.
+     */
+    bool atEnd() const { return m_nextToDeliver >= m_blockCount; }
+
+    /**
+     * @brief Total size of the uncompressed file.
+     */
+    qint64 inputSize() const { return m_inputSize; }
+
+    /**
+     * @brief Total size of the members handed out so far.
+     */
+    qint64 outputSize() const { return m_outputSize; }
+
+signals:
+    /**
+     * @brief Emitted when the next member in order becomes available.
+     */
+    void dataReady();
+
+    /**
+     * @brief Emitted if a block of the file could not be read.
+     * @param error A description of the problem.
+     */
+    void failed(QString error);
+
+private:
+    /**
+     * @brief Lets compression tasks reach the streamer only while it exists.
+     * The destructor clears owner under the mutex, so a task either posts its result
+     * before that (and the event is discarded with the object) or sees nullptr.
+     */
+    struct BlockGuard
+    {
+        QMutex mutex;
+        GzipStreamer *owner = nullptr;
+    };
+
+    void schedule();
+    void onBlockDone(int index, const QByteArray &member);
+
+    QString m_filePath;            ///< The file being compressed.
+    qint64 m_inputSize = 0;        ///< Size of the file.
+    qint64 m_outputSize = 0;       ///< Compressed bytes delivered so far.
+    int m_blockCount = 0;          ///< Number of blocks (and members) in the file.
+    int m_nextToSchedule = 0;      ///< Next block to hand to the pool.
+    int m_nextToDeliver = 0;       ///< Next block the consumer will receive.
+    int m_maxAhead = 0;            ///< Blocks allowed between the consumer and the compressors.
+    QMap<int, QByteArray> m_ready; ///< Finished members waiting for their turn.
+    std::shared_ptr<BlockGuard> m_guard; ///< Shared with the queued and running blocks.
+};
+
+#endif // GZIPSTREAMER_H
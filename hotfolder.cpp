@@ -0,0 +1,132 @@
+#include "hotfolder.h"
+#include "filedigest.h"
+#include "sliceheader.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+/**
+ * @brief Constructs an idle hot folder.
+ * @param parent The parent QObject.
+ */
+HotFolder::HotFolder(QObject *parent) : QObject(parent)
+{
+    m_clock.start();
+    m_pool.setMaxThreadCount(1); // One file at a time keeps the disk reading sequentially
+    m_settleTimer.setInterval(static_cast<int>(SETTLE_INTERVAL_MS / 2));
+
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &HotFolder::scan);
+    connect(&m_settleTimer, &QTimer::timeout, this, &HotFolder::scan);
+}
+
+/**
+ * @brief Drops queued files and waits for the one being hashed.
+ */
+HotFolder::~HotFolder()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+/**
+ * @brief Starts watching a folder and takes the files already in it.
+ * @param path The folder to watch, or an empty string to stop watching.
+ */
+void HotFolder::setFolder(const QString &path)
+{
+    if (!m_watcher.directories().isEmpty())
+        m_watcher.removePaths(m_watcher.directories());
+    m_pending.clear();
+    m_rejected.clear();
+    m_settleTimer.stop();
+    m_folder = path;
+
+    if (m_folder.isEmpty())
+        return;
+
+    m_watcher.addPath(m_folder);
+    scan();
+}
+
+/**
+ * @brief Tracks the size of every sliced file in the folder and takes those that settled.
+ * A file counts as complete when its size has not changed for SETTLE_INTERVAL_MS.
+ */
+void HotFolder::scan()
+{
+    if (m_folder.isEmpty())
+        return;
+
+    const qint64 now = m_clock.elapsed();
+    const QFileInfoList files = QDir(m_folder).entryInfoList({"*.goo", "*.ctb"}, QDir::Files);
+    QMap<QString, PendingFile> stillPending;
+
+    for (const QFileInfo &fi : files)
+    {
+        const QString path = fi.absoluteFilePath();
+        if (m_rejected.contains(path))
+            continue;
+
+        PendingFile pending = m_pending.value(path);
+        if (pending.size != fi.size())
+        {
+            pending.size = fi.size();
+            pending.sinceMs = now;
+        }
+
+        if (pending.size > 0 && now - pending.sinceMs >= SETTLE_INTERVAL_MS)
+            ingest(path);
+        else
+            stillPending.insert(path, pending);
+    }
+
+    m_pending = stillPending;
+    if (m_pending.isEmpty())
+        m_settleTimer.stop();
+    else if (!m_settleTimer.isActive())
+        m_settleTimer.start();
+}
+
+/**
+ * @brief Moves a complete file out of the watched folder, then hashes and parses it in the background.
+ * @param filePath The file in the watched folder.
+ */
+void HotFolder::ingest(const QString &filePath)
+{
+    const QString target = ingestedPath(QFileInfo(filePath).fileName());
+    QDir().mkpath(QFileInfo(target).absolutePath());
+    if (!QFile::rename(filePath, target))
+    {
+        m_rejected.insert(filePath);
+        emit ingestFailed(filePath, tr("Could not move the file to %1").arg(target));
+        return;
+    }
+
+    m_pool.start([this, target]()
+                 {
+        QString md5 = FileDigest::md5(target); // Cached for the upload
+        QString machineName = SliceFileInfo::read(target).machineName;
+
+        // Report on the hot folder's thread; the destructor waits for us, so 'this' is valid
+        QMetaObject::invokeMethod(this, [this, target, machineName, md5]()
+                                  {
+            if (md5.isEmpty())
+                emit ingestFailed(target, tr("Could not read the file"));
+            else
+                emit fileIngested(target, machineName, md5); }, Qt::QueuedConnection); });
+}
+
+/**
+ * @brief Returns a free path for a file in the "ingested" subfolder.
+ * A number is appended if a file with the same name was ingested before.
+ * @param fileName The file name.
+ */
+QString HotFolder::ingestedPath(const QString &fileName) const
+{
+    QDir dir(m_folder + "/ingested");
+    QString candidate = dir.filePath(fileName);
+    QFileInfo fi(fileName);
+    for (int n = 1; QFileInfo::exists(candidate); ++n)
+        candidate = dir.filePath(QString("%1-%2.%3").arg(fi.completeBaseName()).arg(n).arg(fi.suffix()));
+    return candidate;
+}
@@ -0,0 +1,96 @@
+#ifndef HOTFOLDER_H
+#define HOTFOLDER_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QMap>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QTimer>
+
+/**
+ * @class HotFolder
+ * @brief Watches a folder for new .goo/.ctb files and prepares them for printing.
+ *
+ * New files are noticed through QFileSystemWatcher (inotify on Linux). A slicer or a
+ * network share may still be writing them, so a file is only taken once its size has
+ * stayed the same for a full check interval. It is then moved into an "ingested"
+ * subfolder (so it is never picked up twice, even after a restart), hashed and parsed
+ * on a worker thread, and announced with fileIngested(). Its MD5 ends up in the
+ * FileDigest cache, so the upload does not have to compute it.
+ */
+class HotFolder : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs an idle hot folder.
+     * @param parent The parent QObject.
+     */
+    explicit HotFolder(QObject *parent = nullptr);
+
+    /**
+     * @brief Waits for workers that are still hashing.
+     */
+    ~HotFolder() override;
+
+    /**
+     * @brief Starts watching a folder; files already in it are taken as well.
+     * @param path The folder to watch, or an empty string to stop watching.
+     */
+    void setFolder(const QString &path);
+
+    /**
+     * @brief Returns the folder being watched, or an empty string.
+     */
+    QString folder() const { return m_folder; }
+
+signals:
+    /**
+     * @brief Emitted when a file has been hashed and parsed and is ready to be queued.
+     * @param filePath The file's path inside the "ingested" subfolder.
+     * @param machineName The printer model from the file header (empty if unknown).
+     * @param md5 The MD5 of the file.
+     */
+    void fileIngested(QString filePath, QString machineName, QString md5);
+
+    /**
+     * @brief Emitted when a file could not be taken.
+     * @param filePath The file's path.
+     * @param error A description of the problem.
+     */
+    void ingestFailed(QString filePath, QString error);
+
+private slots:
+    /**
+     * @brief Looks for new files and takes the ones whose size has settled.
+     */
+    void scan();
+
+private:
+    /**
+     * @brief A file that is still being written.
+     */
+    struct PendingFile
+    {
+        qint64 size = -1;    ///< Size at the last check.
+        qint64 sinceMs = 0;  ///< Monotonic time the size last changed.
+    };
+
+    void ingest(const QString &filePath);
+    QString ingestedPath(const QString &fileName) const;
+
+    QString m_folder;                ///< The folder being watched.
+    QFileSystemWatcher m_watcher;    ///< Wakes us up when the folder changes.
+    QTimer m_settleTimer;            ///< Re-checks growing files until their size settles.
+    QMap<QString, PendingFile> m_pending; ///< Files seen but not settled yet.
+    QSet<QString> m_rejected;        ///< Files that could not be moved; not retried.
+    QElapsedTimer m_clock;           ///< Monotonic clock for the settle interval.
+    QThreadPool m_pool;              ///< Hashing and header parsing, off the UI thread.
+
+    const qint64 SETTLE_INTERVAL_MS = 2000; ///< A file is complete once its size holds this long.
+};
+
+#endif // HOTFOLDER_H
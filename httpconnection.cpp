@@ -0,0 +1,401 @@
+#include "httpconnection.h"
+#include "bandwidthshaper.h"
+#include "brokershards.h"
+#include "connectiongate.h"
+#include "gzipstreamer.h"
+#include "trafficrecorder.h"
+#include <QFileInfo>
+#include <QHostAddress>
+
+/**
+ * @brief Constructs a connection for an accepted socket.
+ * @param descriptor The native socket descriptor accepted by the server.
+ * @param uploads The uploads that may be requested.
+ * @param recorder Receives the request header.
+ * @param shaper Paces the response body.
+ * @param gate Caps the number of open connections.
+ */
+HttpConnection::HttpConnection(qintptr descriptor, const UploadTable *uploads, TrafficRecorder *recorder, BandwidthShaper *shaper, ConnectionGate *gate)
+    : QObject(nullptr), descriptor(descriptor), uploads(uploads), recorder(recorder), shaper(shaper), gate(gate)
+{
+}
+
+/**
+ * @brief Releases the connection's share of the bandwidth and its slot in the gate.
+ */
+HttpConnection::~HttpConnection()
+{
+    if (shaperId)
+        shaper->removeConnection(shaperId);
+    if (admitted)
+        gate->release(peerIp);
+}
+
+/**
+ * @brief Creates the socket on the worker thread. The object goes away with the socket.
+ */
+void HttpConnection::start()
+{
+    socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(descriptor))
+    {
+        ShardedTcpServer::closeDescriptor(descriptor);
+        deleteLater();
+        return;
+    }
+
+    socket->setSocketOption(QAbstractSocket::TypeOfServiceOption, 0x20); // DSCP CS1: bulk data, behind the control traffic
+    connect(socket, &QTcpSocket::readyRead, this, &HttpConnection::onReadyRead);
+    connect(socket, &QTcpSocket::bytesWritten, this, &HttpConnection::pump);
+    connect(socket, &QTcpSocket::disconnected, this, [this]()
+            {
+        if (tuner.isInBody())
+            emit logMessage(tuner.report()); // The printer hung up in the middle of a body
+        deleteLater(); });
+    peerIp = socket->peerAddress().toString();
+    if (peerIp.startsWith("::ffff:")) // Handle IPv6-mapped IPv4 addresses
+        peerIp = peerIp.mid(7);
+    emit logMessage(QString(tr("Incoming HTTP connection from: %1")).arg(socket->peerAddress().toString()));
+
+    paceTimer = new QTimer(this);
+    paceTimer->setSingleShot(true);
+    connect(paceTimer, &QTimer::timeout, this, &HttpConnection::pump);
+
+    idleTimer = new QTimer(this);
+    idleTimer->setSingleShot(true);
+    idleTimer->setInterval(IDLE_TIMEOUT_MS);
+    connect(idleTimer, &QTimer::timeout, this, &HttpConnection::onIdleTimeout);
+
+    admitted = gate->tryAcquire(peerIp);
+    if (!admitted)
+    {
+        fail("HTTP/1.1 503 Service Unavailable", QString(tr("Error: Too many HTTP connections; refusing %1.")).arg(peerIp));
+        return;
+    }
+    idleTimer->start();
+}
+
+/**
+ * @brief Buffers received bytes, and parses them unless a response is being sent.
+ */
+void HttpConnection::onReadyRead()
+{
+    pending.append(socket->readAll());
+    if (!responding)
+    {
+        processPending();
+    }
+    else if (pending.size() > MAX_PENDING)
+    {
+        emit logMessage(tr("Error: Too much pipelined HTTP data."));
+        socket->abort();
+    }
+}
+
+/**
+ * @brief Closes a connection that sent no complete request in time. This covers both
+ * idle keep-alive connections and clients that send their headers too slowly.
+ */
+void HttpConnection::onIdleTimeout()
+{
+    emit logMessage(QString(tr("Closing idle HTTP connection from %1.")).arg(peerIp));
+    socket->disconnectFromHost();
+}
+
+/**
+ * @brief Feeds the buffered bytes to the parser and answers a request once its head is complete.
+ */
+void HttpConnection::processPending()
+{
+    switch (parser.feed(pending))
+    {
+    case HttpRequestParser::Incomplete:
+        return; // Wait for the rest of the header
+    case HttpRequestParser::Invalid:
+        fail(parser.errorStatus(), tr("Error: Malformed HTTP request."));
+        return;
+    case HttpRequestParser::Complete:
+        idleTimer->stop();
+        handleRequest(parser.request());
+        return;
+    }
+}
+
+/**
+ * @brief Answers a complete request.
+ * @param req The parsed request head.
+ */
+void HttpConnection::handleRequest(const HttpRequest &req)
+{
+    responding = true;
+    keepAlive = req.keepAlive();
+    recorder->record(TrafficRecord::HttpRequest, peerIp, req.raw);
+    emit logMessage(QString(tr("HTTP REQUEST:\n%1")).arg(QString::fromUtf8(req.raw.trimmed())));
+
+    if (req.method != "GET" && req.method != "HEAD")
+    {
+        fail("HTTP/1.1 405 Method Not Allowed", QString(tr("Error: Unsupported HTTP method %1.")).arg(QString::fromLatin1(req.method)));
+        return;
+    }
+
+    QString path = QString::fromUtf8(req.target); // "/xxxx.goo"
+    QString requestedId = path.startsWith("/") ? path.mid(1) : path;
+
+    UploadTicket ticket;
+    if (!uploads->find(requestedId, ticket))
+    {
+        fail("HTTP/1.1 404 Not Found", QString(tr("Error 404: Requested %1 but no upload uses that ID")).arg(requestedId));
+        return;
+    }
+
+    // Compression is negotiated per request: only if the printer says it can decode it
+    bool acceptsGzip = req.header("Accept-Encoding").toLower().contains("gzip");
+    bool http11 = req.version == "HTTP/1.1"; // Chunked encoding needs HTTP/1.1
+    bool sendBody = req.method == "GET";
+    QString method = QString::fromLatin1(req.method);
+
+    if (ticket.gzipAllowed && acceptsGzip && http11 && QFileInfo(ticket.filePath).size() > 0)
+    {
+        emit logMessage(QString(tr("Request for %1 accepted. Printer accepts gzip; compressing on the fly...")).arg(method));
+        if (sendBody)
+            emit transferStarted(ticket.ip, requestedId, true);
+        serveCompressed(ticket, sendBody);
+    }
+    else
+    {
+        emit logMessage(QString(tr("Request for %1 accepted. Sending headers...")).arg(method));
+        if (sendBody)
+            emit transferStarted(ticket.ip, requestedId, false);
+        serveIdentity(ticket, sendBody);
+    }
+}
+
+/**
+ * @brief The Connection header of a response, ending the header block.
+ */
+QByteArray HttpConnection::connectionHeader() const
+{
+    if (keepAlive)
+        return "Connection: keep-alive\r\nKeep-Alive: timeout=" + QByteArray::number(IDLE_TIMEOUT_MS / 1000) + "\r\n\r\n";
+    return "Connection: close\r\n\r\n";
+}
+
+/**
+ * @brief Registers the connection with the shaper and the tuner on its first body, and
+ * starts measuring this one.
+ */
+void HttpConnection::startBody()
+{
+    if (!shaperId)
+        shaperId = shaper->addConnection();
+    if (!tuner.isStarted())
+        tuner.start(socket);
+    tuner.beginBody();
+}
+
+/**
+ * @brief Ends a response: waits for the next request on a kept-alive connection, or
+ * closes it. disconnectFromHost() lets the backlog drain before the socket really closes.
+ */
+void HttpConnection::finishResponse()
+{
+    if (tuner.isInBody())
+    {
+        emit logMessage(tuner.report());
+        tuner.endBody();
+    }
+
+    if (!keepAlive)
+    {
+        socket->disconnectFromHost();
+        return;
+    }
+
+    responding = false;
+    parser.reset();
+    idleTimer->start();
+    if (!pending.isEmpty())
+        processPending(); // A pipelined request
+}
+
+/**
+ * @brief Resumes whichever body is being sent.
+ */
+void HttpConnection::pump()
+{
+    if (streamer)
+        pumpCompressed();
+    else if (file.isOpen())
+        pumpIdentity();
+}
+
+/**
+ * @brief Sends the file as-is, with its length known up front.
+ * @param ticket The upload to send.
+ * @param sendBody False for HEAD requests.
+ */
+void HttpConnection::serveIdentity(const UploadTicket &ticket, bool sendBody)
+{
+    file.setFileName(ticket.filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        fail("HTTP/1.1 500 Internal Server Error", tr("Error: Could not open local file."));
+        return;
+    }
+
+    // Send HTTP response headers
+    QByteArray header = "HTTP/1.1 200 OK\r\n";
+    header += "Content-Type: text/plain; charset=utf-8\r\n";
+    header += "Etag: " + ticket.md5.toUtf8() + "\r\n";
+    header += "Content-Length: " + QByteArray::number(file.size()) + "\r\n";
+    header += connectionHeader();
+    socket->write(header);
+
+    if (!sendBody)
+    {
+        file.close();
+        finishResponse();
+        return;
+    }
+
+    startBody();
+    pumpIdentity();
+}
+
+/**
+ * @brief Tops up the socket's backlog from the file; ends the response once everything is queued.
+ */
+void HttpConnection::pumpIdentity()
+{
+    while (!file.atEnd() && mayWrite())
+    {
+        QByteArray chunk = file.read(tuner.chunkSize());
+        if (chunk.isEmpty())
+        {
+            emit logMessage(tr("Error: Could not read local file."));
+            socket->abort();
+            return;
+        }
+        socket->write(chunk);
+        shaper->consume(shaperId, chunk.size());
+        tuner.written(chunk.size());
+    }
+
+    if (file.atEnd() && file.isOpen())
+    {
+        file.close();
+        emit logMessage(tr("File body sent completely."));
+        finishResponse();
+    }
+}
+
+/**
+ * @brief Sends the file gzip-encoded. The compressed size is unknown in advance, so the
+ * body is sent with chunked transfer encoding, one HTTP chunk per gzip member, and
+ * compression is paced by the socket's write backlog.
+ * @param ticket The upload to send.
+ * @param sendBody False for HEAD requests.
+ */
+void HttpConnection::serveCompressed(const UploadTicket &ticket, bool sendBody)
+{
+    QByteArray header = "HTTP/1.1 200 OK\r\n";
+    header += "Content-Type: text/plain; charset=utf-8\r\n";
+    header += "Content-Encoding: gzip\r\n";
+    header += "Transfer-Encoding: chunked\r\n";
+    header += "Etag: " + ticket.md5.toUtf8() + "\r\n";
+    header += connectionHeader();
+    socket->write(header);
+
+    if (!sendBody)
+    {
+        finishResponse();
+        return;
+    }
+
+    streamer = new GzipStreamer(ticket.filePath, this);
+    if (!streamer->start())
+    {
+        emit logMessage(tr("Error: Could not open local file."));
+        socket->abort();
+        return;
+    }
+
+    startBody();
+    connect(streamer, &GzipStreamer::dataReady, this, &HttpConnection::pumpCompressed);
+    connect(streamer, &GzipStreamer::failed, this, [this](QString error)
+            {
+        emit logMessage(tr("Error: ") + error);
+        socket->abort(); });
+}
+
+/**
+ * @brief Writes the compressed members that are ready, as HTTP chunks.
+ */
+void HttpConnection::pumpCompressed()
+{
+    if (!streamer)
+        return;
+
+    QByteArray member;
+    while (!streamer->atEnd() && mayWrite() && streamer->read(member))
+    {
+        QByteArray size = QByteArray::number(member.size(), 16) + "\r\n";
+        socket->write(size);
+        socket->write(member);
+        socket->write("\r\n");
+        shaper->consume(shaperId, member.size());
+        tuner.written(size.size() + member.size() + 2);
+    }
+
+    if (streamer->atEnd())
+    {
+        socket->write("0\r\n\r\n"); // Last chunk
+        emit logMessage(QString(tr("Compressed body sent: %1 bytes as %2 bytes.")).arg(streamer->inputSize()).arg(streamer->outputSize()));
+        streamer->disconnect(this);
+        streamer->deleteLater();
+        streamer = nullptr;
+        finishResponse();
+    }
+}
+
+/**
+ * @brief Decides whether the body may be topped up now. The socket's backlog must be
+ * below the high-water mark (else bytesWritten resumes us, and the shaper learns the
+ * link is full), and the shaper must have tokens (else the pacing timer resumes us).
+ * @return True if the next block may be written.
+ */
+bool HttpConnection::mayWrite()
+{
+    if (paceTimer->isActive())
+        return false; // Already waiting for tokens
+
+    tuner.sample();
+    if (socket->bytesToWrite() >= tuner.highWater())
+    {
+        shaper->reportLinkBound();
+        return false;
+    }
+
+    qint64 delayMs = shaper->delayFor(shaperId);
+    if (delayMs > 0)
+    {
+        paceTimer->start(static_cast<int>(delayMs));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Answers with an error status and closes the connection.
+ * @param statusLine The HTTP status line.
+ * @param message The message for the log.
+ */
+void HttpConnection::fail(const QByteArray &statusLine, const QString &message)
+{
+    responding = true;
+    keepAlive = false;
+    idleTimer->stop();
+    emit logMessage(message);
+    socket->write(statusLine + "\r\nContent-Length: 0\r\n" + connectionHeader());
+    socket->disconnectFromHost();
+}
@@ -0,0 +1,117 @@
+#ifndef HTTPCONNECTION_H
+#define HTTPCONNECTION_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QFile>
+#include <QTcpSocket>
+#include <QTimer>
+#include "uploadtable.h"
+#include "transfertuner.h"
+#include "httprequestparser.h"
+
+class BandwidthShaper;
+class ConnectionGate;
+class GzipStreamer;
+class TrafficRecorder;
+
+/**
+ * @class HttpConnection
+ * @brief Serves a printer's downloads from our HTTP server, on a broker worker thread.
+ *
+ * The printer fetches the "magic URL" sent with the upload command. The connection
+ * looks the file ID up in the UploadTable and streams the file without blocking the
+ * worker: the next block is only written once the socket's backlog has drained, so
+ * other printers on the same worker keep being served. Writes are also paced by the
+ * BandwidthShaper, so bulk data leaves room for the printers' MQTT traffic, and the
+ * write size and socket buffers follow the link (see TransferTuner).
+ *
+ * Requests are parsed incrementally (see HttpRequestParser), and HTTP/1.1 connections
+ * are kept alive, so a printer's HEAD probe and its GET share one connection. A
+ * connection that sends no complete request within the idle timeout is closed, and
+ * the ConnectionGate refuses connections beyond the caps with a 503. The object
+ * deletes itself when the socket closes.
+ */
+class HttpConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs a connection for an accepted socket. Call start() on the worker thread.
+     * @param descriptor The native socket descriptor accepted by the server.
+     * @param uploads The uploads that may be requested. Must outlive the connection.
+     * @param recorder Receives the request header. Must outlive the connection.
+     * @param shaper Paces the response body. Must outlive the connection.
+     * @param gate Caps the number of open connections. Must outlive the connection.
+     */
+    HttpConnection(qintptr descriptor, const UploadTable *uploads, TrafficRecorder *recorder, BandwidthShaper *shaper, ConnectionGate *gate);
+
+    /**
+     * @brief Releases the connection's share of the bandwidth and its slot in the gate.
+     */
+    ~HttpConnection() override;
+
+public slots:
+    /**
+     * @brief Creates the socket on the current thread and waits for the first request.
+     */
+    void start();
+
+signals:
+    /**
+     * @brief Emitted with messages for the application log.
+     * @param message The message.
+     */
+    void logMessage(QString message);
+
+    /**
+     * @brief Emitted when a registered upload starts being served.
+     * @param ip The printer the upload belongs to.
+     * @param fileId The file ID from the URL.
+     * @param compressed True if the body is sent gzip-encoded.
+     */
+    void transferStarted(QString ip, QString fileId, bool compressed);
+
+private slots:
+    void onReadyRead();
+    void onIdleTimeout();
+    void pump();
+    void pumpIdentity();
+    void pumpCompressed();
+
+private:
+    void processPending();
+    void handleRequest(const HttpRequest &req);
+    QByteArray connectionHeader() const;
+    void startBody();
+    void finishResponse();
+    void serveIdentity(const UploadTicket &ticket, bool sendBody);
+    void serveCompressed(const UploadTicket &ticket, bool sendBody);
+    void fail(const QByteArray &statusLine, const QString &message);
+    bool mayWrite();
+
+    qintptr descriptor;                ///< Descriptor to adopt in start().
+    const UploadTable *uploads;        ///< Registered uploads.
+    TrafficRecorder *recorder;         ///< Capture of the traffic, when enabled.
+    BandwidthShaper *shaper;           ///< Rate limits shared by every download.
+    ConnectionGate *gate;              ///< Caps on open connections.
+    bool admitted = false;             ///< We hold a slot in the gate.
+    int shaperId = 0;                  ///< Our bucket in the shaper; 0 until the body starts.
+    QTimer *paceTimer = nullptr;       ///< Resumes the body once the shaper allows it.
+    TransferTuner tuner;               ///< Write size and buffers for this link.
+    QString peerIp;                    ///< The printer's address.
+    QTcpSocket *socket = nullptr;      ///< The printer's socket.
+    HttpRequestParser parser;          ///< Parses the current request head.
+    QByteArray pending;                ///< Received bytes not parsed yet.
+    bool responding = false;           ///< A response is being sent; further input waits in pending.
+    bool keepAlive = false;            ///< Keep the connection open after the current response.
+    QTimer *idleTimer = nullptr;       ///< Closes connections that send no complete request in time.
+    QFile file;                        ///< File being sent as-is.
+    GzipStreamer *streamer = nullptr;  ///< Compressor for gzip responses.
+
+    const int IDLE_TIMEOUT_MS = 15000;               ///< Time allowed for each request, and between requests.
+    const int MAX_PENDING = 64 * 1024;               ///< Most pipelined bytes buffered during a response.
+};
+
+#endif // HTTPCONNECTION_H
@@ -0,0 +1,126 @@
+#include "httprequestparser.h"
+
+/**
+ * @brief Returns the value of the first header with that name, case-insensitively.
+ */
+QByteArray HttpRequest::header(const QByteArray &name) const
+{
+    for (const auto &field : headers)
+    {
+        if (field.first.compare(name, Qt::CaseInsensitive) == 0)
+            return field.second;
+    }
+    return QByteArray();
+}
+
+/**
+ * @brief True if the connection should stay open after the response.
+ */
+bool HttpRequest::keepAlive() const
+{
+    const QByteArray connection = header("Connection").toLower();
+    if (version == "HTTP/1.1")
+        return !connection.contains("close");
+    return connection.contains("keep-alive");
+}
+
+/**
+ * @brief Consumes complete lines from the front of the buffer.
+ */
+HttpRequestParser::State HttpRequestParser::feed(QByteArray &buffer)
+{
+    while (state == Incomplete)
+    {
+        // A line is too long whether or not its end has arrived in the same read
+        int end = buffer.indexOf('\n');
+        if ((end < 0 ? buffer.size() : end) > MAX_LINE)
+            return fail(inHeaders ? "HTTP/1.1 431 Request Header Fields Too Large" : "HTTP/1.1 414 URI Too Long");
+        if (end < 0)
+            break;
+
+        QByteArray line = buffer.left(end);
+        if (line.endsWith('\r'))
+            line.chop(1);
+        if (inHeaders || !line.isEmpty())
+            current.raw.append(buffer.constData(), end + 1);
+        buffer.remove(0, end + 1);
+
+        if (current.raw.size() > MAX_HEAD)
+            return fail("HTTP/1.1 431 Request Header Fields Too Large");
+
+        if (!inHeaders)
+        {
+            if (!line.isEmpty()) // Empty lines before a request are ignored (RFC 9112, 2.2)
+                parseRequestLine(line);
+        }
+        else if (line.isEmpty())
+        {
+            // End of the head. Bodies are not expected by a file server
+            if (!current.header("Transfer-Encoding").isEmpty() || current.header("Content-Length").toLongLong() > 0)
+                return fail("HTTP/1.1 413 Payload Too Large");
+            state = Complete;
+        }
+        else
+        {
+            parseHeaderLine(line);
+        }
+    }
+    return state;
+}
+
+/**
+ * @brief Forgets the request to parse the next one.
+ */
+void HttpRequestParser::reset()
+{
+    current = HttpRequest();
+    inHeaders = false;
+    state = Incomplete;
+    error.clear();
+}
+
+/**
+ * @brief Marks the request invalid.
+ */
+HttpRequestParser::State HttpRequestParser::fail(const QByteArray &status)
+{
+    error = status;
+    state = Invalid;
+    return state;
+}
+
+/**
+ * @brief Parses "METHOD target HTTP/1.x".
+ */
+HttpRequestParser::State HttpRequestParser::parseRequestLine(const QByteArray &line)
+{
+    const QList<QByteArray> parts = line.split(' ');
+    if (parts.size() != 3 || parts[0].isEmpty() || parts[1].isEmpty())
+        return fail("HTTP/1.1 400 Bad Request");
+    if (parts[2] != "HTTP/1.1" && parts[2] != "HTTP/1.0")
+        return fail("HTTP/1.1 505 HTTP Version Not Supported");
+
+    current.method = parts[0];
+    current.target = parts[1];
+    current.version = parts[2];
+    inHeaders = true;
+    return state;
+}
+
+/**
+ * @brief Parses "Name: value".
+ */
+HttpRequestParser::State HttpRequestParser::parseHeaderLine(const QByteArray &line)
+{
+    if (line.startsWith(' ') || line.startsWith('\t'))
+        return fail("HTTP/1.1 400 Bad Request"); // Obsolete line folding (RFC 9112, 5.2)
+
+    int colon = line.indexOf(':');
+    if (colon <= 0 || line[colon - 1] == ' ' || line[colon - 1] == '\t')
+        return fail("HTTP/1.1 400 Bad Request");
+    if (current.headers.size() >= MAX_HEADERS)
+        return fail("HTTP/1.1 431 Request Header Fields Too Large");
+
+    current.headers.append({line.left(colon), line.mid(colon + 1).trimmed()});
+    return state;
+}
@@ -0,0 +1,93 @@
+#ifndef HTTPREQUESTPARSER_H
+#define HTTPREQUESTPARSER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+
+/**
+ * @brief A parsed HTTP request head.
+ */
+struct HttpRequest
+{
+    QByteArray method;   ///< E.g. "GET".
+    QByteArray target;   ///< E.g. "/0123abcd.goo".
+    QByteArray version;  ///< "HTTP/1.0" or "HTTP/1.1".
+    QList<QPair<QByteArray, QByteArray>> headers; ///< Names as sent, values trimmed.
+    QByteArray raw;      ///< The request head as received, for the log and captures.
+
+    /**
+     * @brief Returns the value of a header, or an empty array if it is missing.
+     * @param name The header name; compared case-insensitively.
+     */
+    QByteArray header(const QByteArray &name) const;
+
+    /**
+     * @brief True if the client wants the connection kept open after the response:
+     * the default for HTTP/1.1 unless it sent "Connection: close", and only on request
+     * ("Connection: keep-alive") for HTTP/1.0.
+     */
+    bool keepAlive() const;
+};
+
+/**
+ * @class HttpRequestParser
+ * @brief Incremental parser for HTTP/1.x request heads.
+ *
+ * Bytes are fed as they arrive; the parser consumes complete lines from the front of
+ * the buffer and keeps its state between calls, so a head split over any number of
+ * reads costs one pass over each byte. Whatever follows a complete head (a pipelined
+ * request) is left in the buffer. Line length, header count and head size are bounded,
+ * and requests with a body are refused, since the file server only serves GET and HEAD.
+ */
+class HttpRequestParser
+{
+public:
+    /**
+     * @brief Result of feed().
+     */
+    enum State
+    {
+        Incomplete, ///< More bytes are needed.
+        Complete,   ///< request() holds a whole request head.
+        Invalid     ///< The request is malformed or too large; see errorStatus().
+    };
+
+    /**
+     * @brief Consumes bytes from the front of the buffer.
+     * @param buffer Received bytes; consumed lines are removed from it.
+     * @return The parser's state.
+     */
+    State feed(QByteArray &buffer);
+
+    /**
+     * @brief The parsed request, once feed() returned Complete.
+     */
+    const HttpRequest &request() const { return current; }
+
+    /**
+     * @brief The status line to answer an invalid request with.
+     */
+    QByteArray errorStatus() const { return error; }
+
+    /**
+     * @brief Forgets the request to parse the next one on the same connection.
+     */
+    void reset();
+
+private:
+    State fail(const QByteArray &status);
+    State parseRequestLine(const QByteArray &line);
+    State parseHeaderLine(const QByteArray &line);
+
+    HttpRequest current;          ///< Request being parsed.
+    bool inHeaders = false;       ///< The request line has been parsed.
+    State state = Incomplete;     ///< Sticky once Complete or Invalid, until reset().
+    QByteArray error;             ///< Status line for Invalid.
+
+    const int MAX_LINE = 8 * 1024;       ///< Longest request or header line.
+    const int MAX_HEAD = 16 * 1024;      ///< Largest request head.
+    const int MAX_HEADERS = 64;          ///< Most header fields.
+};
+
+#endif // HTTPREQUESTPARSER_H
@@ -0,0 +1,159 @@
+#include "jobtracer.h"
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+/**
+ * @brief Enables tracing and sets the file the trace is written to.
+ */
+void JobTracer::setOutputFile(const QString &path)
+{
+    outputPath = path;
+    if (!clock.isValid())
+        clock.start();
+}
+
+/**
+ * @brief Starts a job on a printer, ending any job still open there.
+ */
+void JobTracer::beginJob(const QString &ip, const QString &jobKey, const QString &label)
+{
+    if (!isEnabled())
+        return;
+    if (jobs.contains(ip))
+        endJob(ip, "superseded");
+
+    OpenJob job;
+    job.key = jobKey;
+    job.label = label;
+    job.startUs = nowUs();
+    jobs.insert(ip, job);
+    trackFor(ip);
+}
+
+/**
+ * @brief Changes the key of the printer's current job.
+ */
+void JobTracer::rekeyJob(const QString &ip, const QString &jobKey)
+{
+    auto it = jobs.find(ip);
+    if (it != jobs.end())
+        it->key = jobKey;
+}
+
+/**
+ * @brief Opens a stage of the printer's current job.
+ */
+void JobTracer::begin(const QString &ip, const QString &stage)
+{
+    auto it = jobs.find(ip);
+    if (it != jobs.end())
+        it->stages.insert(stage, nowUs());
+}
+
+/**
+ * @brief Closes a stage of the printer's current job, if it is open.
+ */
+void JobTracer::end(const QString &ip, const QString &stage)
+{
+    auto it = jobs.find(ip);
+    if (it == jobs.end() || !it->stages.contains(stage))
+        return;
+
+    qint64 startUs = it->stages.take(stage);
+    spans.append({stage, ip, it->key, QString(), startUs, nowUs() - startUs});
+    if (spans.size() > MAX_SPANS)
+        spans.removeFirst();
+}
+
+/**
+ * @brief True if the printer's current job has the stage open.
+ */
+bool JobTracer::isOpen(const QString &ip, const QString &stage) const
+{
+    auto it = jobs.constFind(ip);
+    return it != jobs.cend() && it->stages.contains(stage);
+}
+
+/**
+ * @brief Closes every open stage and the job itself, then writes the trace file.
+ */
+void JobTracer::endJob(const QString &ip, const QString &result)
+{
+    auto it = jobs.find(ip);
+    if (it == jobs.end())
+        return;
+
+    const QStringList open = it->stages.keys();
+    for (const QString &stage : open)
+        end(ip, stage);
+
+    OpenJob job = jobs.take(ip);
+    spans.append({"job: " + job.label, ip, job.key, result, job.startUs, nowUs() - job.startUs});
+    if (spans.size() > MAX_SPANS)
+        spans.removeFirst();
+    write();
+}
+
+/**
+ * @brief Returns the trace track of a printer, assigning one on first use.
+ */
+int JobTracer::trackFor(const QString &ip)
+{
+    auto it = tracks.constFind(ip);
+    if (it != tracks.cend())
+        return it.value();
+    int track = tracks.size() + 1;
+    tracks.insert(ip, track);
+    return track;
+}
+
+/**
+ * @brief Writes every finished span as Chrome trace JSON ("X" events, one track per
+ * printer, named after its IP with an "M" event).
+ */
+void JobTracer::write() const
+{
+    QJsonArray events;
+    for (auto it = tracks.cbegin(); it != tracks.cend(); ++it)
+    {
+        QJsonObject meta;
+        meta["ph"] = "M";
+        meta["name"] = "thread_name";
+        meta["pid"] = 1;
+        meta["tid"] = it.value();
+        meta["args"] = QJsonObject{{"name", it.key()}};
+        events.append(meta);
+    }
+
+    for (const Span &span : spans)
+    {
+        QJsonObject args{{"printer", span.ip}, {"job", span.jobKey}};
+        if (!span.detail.isEmpty())
+            args["result"] = span.detail;
+
+        QJsonObject event;
+        event["ph"] = "X";
+        event["cat"] = "job";
+        event["name"] = span.name;
+        event["pid"] = 1;
+        event["tid"] = tracks.value(span.ip);
+        event["ts"] = span.startUs;
+        event["dur"] = span.durationUs;
+        event["args"] = args;
+        events.append(event);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ms";
+
+    // Written atomically, so a viewer never opens a half-written trace
+    QSaveFile file(outputPath);
+    if (file.open(QIODevice::WriteOnly))
+    {
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
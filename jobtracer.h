@@ -0,0 +1,115 @@
+#ifndef JOBTRACER_H
+#define JOBTRACER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+/**
+ * @class JobTracer
+ * @brief Records the stages of each upload-to-first-layer pipeline as trace spans.
+ *
+ * Every printer gets its own track, and each job opens a "job" span on it with the
+ * stages nested inside (hashing, waiting for the printer's GET, the transfer, waiting
+ * for the print command, the printer preparing the first layer). Spans carry the job's
+ * file ID so the stages of one job can be picked out. When a job ends, the whole
+ * history is written as Chrome trace JSON, which chrome://tracing and Perfetto open.
+ *
+ * The tracer is disabled until setOutputFile() is called; every call is then a no-op.
+ * Printer-side stages are only as precise as the printer's status period.
+ */
+class JobTracer
+{
+public:
+    /**
+     * @brief Enables tracing and sets the file the trace is written to.
+     * @param path The trace file; empty disables tracing.
+     */
+    void setOutputFile(const QString &path);
+
+    /**
+     * @brief True while tracing is enabled.
+     */
+    bool isEnabled() const { return !outputPath.isEmpty(); }
+
+    /**
+     * @brief Starts a job on a printer, ending any job still open there.
+     * @param ip The printer.
+     * @param jobKey Identifies the job in the span arguments (e.g. the upload's file ID).
+     * @param label A readable description, such as the file name.
+     */
+    void beginJob(const QString &ip, const QString &jobKey, const QString &label);
+
+    /**
+     * @brief Changes the key of the printer's current job, e.g. once the file ID is known.
+     * @param ip The printer.
+     * @param jobKey The new key.
+     */
+    void rekeyJob(const QString &ip, const QString &jobKey);
+
+    /**
+     * @brief Opens a stage of the printer's current job. Ignored if no job is open.
+     * @param ip The printer.
+     * @param stage The stage name.
+     */
+    void begin(const QString &ip, const QString &stage);
+
+    /**
+     * @brief Closes a stage of the printer's current job, if it is open.
+     * @param ip The printer.
+     * @param stage The stage name.
+     */
+    void end(const QString &ip, const QString &stage);
+
+    /**
+     * @brief True if the printer's current job has the stage open.
+     */
+    bool isOpen(const QString &ip, const QString &stage) const;
+
+    /**
+     * @brief Closes every open stage and the job itself, then writes the trace file.
+     * @param ip The printer.
+     * @param result How the job ended, e.g. "printing" or "transfer failed".
+     */
+    void endJob(const QString &ip, const QString &result);
+
+private:
+    /**
+     * @brief A finished span.
+     */
+    struct Span
+    {
+        QString name;
+        QString ip;
+        QString jobKey;
+        QString detail;   ///< Job label or result, shown in the span's arguments.
+        qint64 startUs;
+        qint64 durationUs;
+    };
+
+    /**
+     * @brief A printer's job in progress.
+     */
+    struct OpenJob
+    {
+        QString key;
+        QString label;
+        qint64 startUs = 0;
+        QHash<QString, qint64> stages; ///< Open stages and their start times.
+    };
+
+    qint64 nowUs() const { return clock.nsecsElapsed() / 1000; }
+    int trackFor(const QString &ip);
+    void write() const;
+
+    QString outputPath;                ///< Trace file; empty while disabled.
+    QElapsedTimer clock;               ///< Timestamps are relative to setOutputFile().
+    QHash<QString, OpenJob> jobs;      ///< Current job of each printer.
+    QHash<QString, int> tracks;        ///< Track (trace "thread") of each printer.
+    QList<Span> spans;                 ///< Finished spans, oldest first.
+
+    const int MAX_SPANS = 20000;       ///< Older spans are dropped beyond this.
+};
+
+#endif // JOBTRACER_H
@@ -0,0 +1,141 @@
+#include "knownprinters.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+
+/**
+ * @brief Loads the cache saved by a previous run, dropping stale entries.
+ */
+void KnownPrinters::load()
+{
+    QFile f(storagePath());
+    if (!f.open(QIODevice::ReadOnly))
+        return;
+
+    const QDateTime oldest = QDateTime::currentDateTimeUtc().addDays(-MAX_AGE_DAYS);
+    const QJsonArray array = QJsonDocument::fromJson(f.readAll()).array();
+    for (const QJsonValue &value : array)
+    {
+        QJsonObject obj = value.toObject();
+        KnownPrinter printer;
+        printer.ip = obj["IP"].toString();
+        printer.uuid = obj["Id"].toString();
+        printer.mainboardId = obj["MainboardID"].toString();
+        printer.name = obj["Name"].toString();
+        printer.model = obj["MachineName"].toString();
+        printer.localAddress = obj["LocalAddress"].toString();
+        printer.lastSeen = QDateTime::fromString(obj["LastSeen"].toString(), Qt::ISODate);
+        if (!printer.ip.isEmpty() && printer.lastSeen.isValid() && printer.lastSeen >= oldest)
+            entries.insert(printer.ip, printer);
+    }
+}
+
+/**
+ * @brief Returns every known printer, most recently seen first.
+ */
+QList<KnownPrinter> KnownPrinters::printers() const
+{
+    QList<KnownPrinter> list = entries.values();
+    std::sort(list.begin(), list.end(), [](const KnownPrinter &a, const KnownPrinter &b)
+              { return a.lastSeen > b.lastSeen; });
+    return list;
+}
+
+/**
+ * @brief Records a discovery reply, and saves the cache.
+ */
+void KnownPrinters::recordDiscovery(const QString &ip, const QString &uuid, const QString &name, const QString &model, const QString &localAddress)
+{
+    KnownPrinter &printer = entryFor(ip, uuid, QString());
+    if (!uuid.isEmpty())
+        printer.uuid = uuid;
+    if (!name.isEmpty())
+        printer.name = name;
+    if (!model.isEmpty())
+        printer.model = model;
+    printer.localAddress = localAddress;
+    printer.lastSeen = QDateTime::currentDateTimeUtc();
+    save();
+}
+
+/**
+ * @brief Records a printer that connected to our broker, and saves the cache.
+ */
+void KnownPrinters::recordConnection(const QString &ip, const QString &mainboardId, const QString &model, const QString &localAddress)
+{
+    KnownPrinter &printer = entryFor(ip, QString(), mainboardId);
+    if (!mainboardId.isEmpty())
+        printer.mainboardId = mainboardId;
+    if (!model.isEmpty())
+        printer.model = model;
+    printer.localAddress = localAddress;
+    printer.lastSeen = QDateTime::currentDateTimeUtc();
+    save();
+}
+
+/**
+ * @brief Returns the entry of a printer, moving it if the same printer was known under
+ * another address, and creating it if it is new.
+ */
+KnownPrinter &KnownPrinters::entryFor(const QString &ip, const QString &uuid, const QString &mainboardId)
+{
+    for (auto it = entries.begin(); it != entries.end(); ++it)
+    {
+        bool samePrinter = (!uuid.isEmpty() && it->uuid == uuid) || (!mainboardId.isEmpty() && it->mainboardId == mainboardId);
+        if (samePrinter && it.key() != ip)
+        {
+            KnownPrinter moved = it.value();
+            entries.erase(it);
+            moved.ip = ip;
+            entries.insert(ip, moved); // Replaces whatever was known at the new address
+            break;
+        }
+    }
+
+    KnownPrinter &printer = entries[ip];
+    printer.ip = ip;
+    return printer;
+}
+
+/**
+ * @brief Saves the cache atomically, so a crash never leaves it half-written.
+ */
+void KnownPrinters::save() const
+{
+    QJsonArray array;
+    for (const KnownPrinter &printer : entries)
+    {
+        QJsonObject obj;
+        obj["IP"] = printer.ip;
+        obj["Id"] = printer.uuid;
+        obj["MainboardID"] = printer.mainboardId;
+        obj["Name"] = printer.name;
+        obj["MachineName"] = printer.model;
+        obj["LocalAddress"] = printer.localAddress;
+        obj["LastSeen"] = printer.lastSeen.toString(Qt::ISODate);
+        array.append(obj);
+    }
+
+    QString path = storagePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile f(path);
+    if (f.open(QIODevice::WriteOnly))
+    {
+        f.write(QJsonDocument(array).toJson(QJsonDocument::Compact));
+        f.commit();
+    }
+}
+
+/**
+ * @brief Returns the file the cache is saved to.
+ */
+QString KnownPrinters::storagePath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/printers.json";
+}
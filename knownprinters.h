@@ -0,0 +1,74 @@
+#ifndef KNOWNPRINTERS_H
+#define KNOWNPRINTERS_H
+
+#include <QDateTime>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+/**
+ * @brief What we remember about a printer between runs.
+ */
+struct KnownPrinter
+{
+    QString ip;            ///< Last address the printer answered from.
+    QString uuid;          ///< The "Id" of its discovery reply.
+    QString mainboardId;   ///< Mainboard ID from its status topic.
+    QString name;          ///< Name the user gave it.
+    QString model;         ///< Machine name, e.g. "ELEGOO Saturn 4 Ultra".
+    QString localAddress;  ///< Our address on the printer's network when last seen.
+    QDateTime lastSeen;    ///< Last discovery reply or connection, in UTC.
+};
+
+/**
+ * @class KnownPrinters
+ * @brief Persistent cache of the printers seen in previous runs, so they can be invited
+ * at startup without waiting for a discovery broadcast.
+ *
+ * Entries are keyed by IP and saved as JSON in the application data folder. A printer
+ * that shows up at a new address (a new DHCP lease) replaces its old entry, matched by
+ * UUID or mainboard ID. Entries not seen for MAX_AGE_DAYS are dropped when loading.
+ */
+class KnownPrinters
+{
+public:
+    /**
+     * @brief Loads the cache saved by a previous run.
+     */
+    void load();
+
+    /**
+     * @brief Returns every known printer, most recently seen first.
+     */
+    QList<KnownPrinter> printers() const;
+
+    /**
+     * @brief Records a discovery reply, and saves the cache.
+     * @param ip The printer's address.
+     * @param uuid The "Id" of the reply; may be empty.
+     * @param name The printer's name.
+     * @param model The machine name.
+     * @param localAddress Our address on the printer's network.
+     */
+    void recordDiscovery(const QString &ip, const QString &uuid, const QString &name, const QString &model, const QString &localAddress);
+
+    /**
+     * @brief Records a printer that connected to our broker, and saves the cache.
+     * @param ip The printer's address.
+     * @param mainboardId Its mainboard ID, if already known.
+     * @param model Its machine name, if already known.
+     * @param localAddress Our address on the printer's network.
+     */
+    void recordConnection(const QString &ip, const QString &mainboardId, const QString &model, const QString &localAddress);
+
+private:
+    KnownPrinter &entryFor(const QString &ip, const QString &uuid, const QString &mainboardId);
+    void save() const;
+    QString storagePath() const;
+
+    QMap<QString, KnownPrinter> entries; ///< Known printers, keyed by IP.
+
+    const int MAX_AGE_DAYS = 90;         ///< Printers not seen for longer are forgotten.
+};
+
+#endif // KNOWNPRINTERS_H
@@ -1,5 +1,6 @@
 #include <QApplication>
 #include "mainwindow.h"
+#include "startupprofiler.h"
 
 /**
  * @file main.cpp
@@ -10,14 +11,27 @@
 
 /**
  * @brief The main entry point for the application.
+ * Pass --profile-startup (or set SATURN_PROFILE_STARTUP) to log the time to first frame.
  * @param argc The number of command-line arguments.
  * @param argv The array of command-line arguments.
  * @return The exit code of the application.
  */
 int main(int argc, char *argv[])
 {
+    bool profileStartup = qEnvironmentVariableIsSet("SATURN_PROFILE_STARTUP");
+    for (int i = 1; i < argc; ++i)
+    {
+        if (qstrcmp(argv[i], "--profile-startup") == 0)
+            profileStartup = true;
+    }
+    if (profileStartup)
+        StartupProfiler::start();
+
     QApplication app(argc, argv);
+    StartupProfiler::mark("QApplication");
     MainWindow w;
+    StartupProfiler::mark("MainWindow");
     w.show();
+    StartupProfiler::reportAtFirstFrame(&w);
     return app.exec();
 }
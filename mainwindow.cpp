@@ -7,60 +7,147 @@
 #include <QApplication>
 #include <QDir>
 #include <QLocale>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QTime>
+#include <QHeaderView>
+#include <QImageReader>
+#include <QPixmapCache>
+#include "sliceheader.h"
+#include "farmdelegate.h"
+#include "startupprofiler.h"
 
 /**
  * @brief Constructs the MainWindow, initializes the backend, and sets up UI connections.
+ * The backend and the scheduler run on their own thread, so MQTT acknowledgements are
+ * never delayed by dialogs or repaints. Their signals reach the UI as queued calls, and
+ * the UI calls into them with QMetaObject::invokeMethod.
  * @param parent The parent widget.
  */
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent)
 {
-    backend = new SaturnBackend(this);
+    ioThread = new QThread(this);
+    ioThread->setObjectName("SaturnIO");
+    backend = new SaturnBackend;
+    scheduler = new FarmScheduler(backend);
+    backend->moveToThread(ioThread);
+    scheduler->moveToThread(ioThread);
+    connect(ioThread, &QThread::finished, scheduler, &QObject::deleteLater);
+    connect(ioThread, &QThread::finished, backend, &QObject::deleteLater);
+    ioThread->start();
+    StartupProfiler::mark("backend thread");
+
+    hotFolder = new HotFolder(this);
+    farmModel = new FarmModel(this);
     setupUi();
+    StartupProfiler::mark("setupUi");
 
     retranslateUi();
 
     // --- UI Signal/Slot Connections ---
-    connect(backend, &SaturnBackend::modelDetected, [this](QString model)
+    connect(backend, &SaturnBackend::modelDetected, this, [this](QString model)
             {
         QString ip = ipInput->text();
         if (!ip.isEmpty()) {
             ipToModel.insert(ip, model);
         }
-        QString imagePath = getIconPathForModel(model);
-        QPixmap pixmap(imagePath);
-        if (!pixmap.isNull()) {
-            imgLabel->setPixmap(pixmap.scaled(300, 300, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-        } });
-
-    connect(backend, &SaturnBackend::connectionReady, [this]()
-            { qobject_cast<QStackedWidget *>(centralWidget())->setCurrentWidget(controlPage); });
-
-    connect(backend, &SaturnBackend::statusUpdate, this, &MainWindow::updateStatus);
-    connect(backend, &SaturnBackend::remainingTimeUpdate, this, &MainWindow::updateRemainingTime);
+        showModelImage(model); });
 
-    connect(backend, &SaturnBackend::statusUpdate, [this](QString status, int, int, QString)
+    connect(backend, &SaturnBackend::connectionReady, this, [this]()
             {
-        if (status.contains(tr("Printing")) || status.contains(tr("Exposing")) || status.contains(tr("Lowering"))) {
-            btnPrintLast->setVisible(false);
-        } });
+        ensureControlPage();
+        qobject_cast<QStackedWidget *>(centralWidget())->setCurrentWidget(controlPage); });
 
-    connect(backend, &SaturnBackend::uploadProgress, progressBar, &QProgressBar::setValue);
+    connect(backend, &SaturnBackend::statusChanged, this, &MainWindow::updateStatus);
+    connect(backend, &SaturnBackend::printerFound, farmModel, &FarmModel::onPrinterFound);
+    connect(backend, &SaturnBackend::printerFound, this, [this](QString ip, QString, QString model)
+            {
+        if (!model.isEmpty())
+            ipToModel.insert(ip, model); });
+    connect(backend, &SaturnBackend::printerConnected, farmModel, [this](QString ip, qint64)
+            { farmModel->onPrinterConnected(ip); });
+    connect(backend, &SaturnBackend::printerStatusChanged, farmModel, &FarmModel::onPrinterStatusChanged);
     connect(backend, &SaturnBackend::fileReadyToPrint, this, &MainWindow::showPrintButton);
-    connect(backend, &SaturnBackend::logMessage, [](QString msg)
+    connect(backend, &SaturnBackend::fleetCommandFinished, this, [this](int, int acknowledged, int total, qint64 worstLatencyMs)
+            {
+        fleetAcknowledged = acknowledged;
+        fleetTotal = total;
+        fleetWorstMs = worstLatencyMs;
+        if (farmPage)
+            retranslateFarmPage(); });
+    connect(backend, &SaturnBackend::logMessage, this, [](QString msg)
             { qDebug() << "LOG:" << msg; });
-
-    // Set initial language based on system locale
+    connect(scheduler, &FarmScheduler::jobDispatched, this, [](QString jobId, QString ip)
+            { qDebug() << "FARM: job" << jobId << "sent to" << ip; });
+    connect(scheduler, &FarmScheduler::jobStaged, this, [](QString jobId, QString ip)
+            { qDebug() << "FARM: job" << jobId << "staged on" << ip; });
+    connect(scheduler, &FarmScheduler::jobStarted, this, [](QString jobId, QString ip)
+            { qDebug() << "FARM: job" << jobId << "printing on" << ip; });
+    connect(scheduler, &FarmScheduler::jobFailed, this, [this](QString jobId, QString filePath, QString reason)
+            {
+        qDebug() << "FARM: job" << jobId << "failed:" << reason;
+        QString entry = QString("%1  %2: %3").arg(QTime::currentTime().toString("HH:mm"), QFileInfo(filePath).fileName(), reason);
+        farmFailures.prepend(entry);
+        if (farmFailures.size() > MAX_FARM_FAILURES)
+            farmFailures.removeLast();
+        if (farmFailureList)
+        {
+            farmFailureList->insertItem(0, entry);
+            delete farmFailureList->takeItem(MAX_FARM_FAILURES);
+        } });
+    connect(scheduler, &FarmScheduler::queueChanged, this, [this](int queued, int dispatched)
+            {
+        farmQueued = queued;
+        farmDispatched = dispatched;
+        if (farmPage)
+            retranslateFarmPage(); });
+    connect(hotFolder, &HotFolder::fileIngested, scheduler, [this](QString filePath, QString machineName, QString md5)
+            {
+        qDebug() << "HOT FOLDER:" << filePath << machineName << md5;
+        scheduler->enqueue(filePath, machineName); });
+    connect(hotFolder, &HotFolder::ingestFailed, this, [](QString filePath, QString error)
+            { qDebug() << "HOT FOLDER:" << filePath << "skipped:" << error; });
+    QMetaObject::invokeMethod(scheduler, &FarmScheduler::load);
+
+    // Printers from previous runs are invited right away; discovery revalidates them
+    QMetaObject::invokeMethod(backend, &SaturnBackend::warmStart);
+
+    // Opt-in traffic capture (for the replay tool) and job tracing (for chrome://tracing)
+    QString capturePath = qEnvironmentVariable("SATURN_CAPTURE");
+    if (!capturePath.isEmpty())
+        QMetaObject::invokeMethod(backend, [this, capturePath]()
+                                  { backend->startCapture(capturePath); });
+    QString tracePath = qEnvironmentVariable("SATURN_TRACE");
+    if (!tracePath.isEmpty())
+        QMetaObject::invokeMethod(backend, [this, tracePath]()
+                                  { backend->setTraceFile(tracePath); });
+
+    // Upload limits, as "total KB/s[,per-printer KB/s[,adaptive 0/1]]"
+    bool limitsOk = false;
+    BandwidthLimits limits = BandwidthLimits::fromString(qEnvironmentVariable("SATURN_BANDWIDTH"), limitsOk);
+    if (qEnvironmentVariableIsSet("SATURN_BANDWIDTH") && limitsOk)
+        QMetaObject::invokeMethod(backend, [this, limits]()
+                                  { backend->setBandwidthLimits(limits); });
+
+    // Set initial language based on system locale. Signals are blocked so the
+    // translation is loaded once, by the explicit call below.
     QString defaultLocale = QLocale::system().name().section('_', 0, 0);
     int index = languageComboBox->findData(defaultLocale);
-    if (index != -1)
-    {
-        languageComboBox->setCurrentIndex(index);
-    }
-    else
-    {
-        languageComboBox->setCurrentIndex(0); // Default to English
-    }
+    languageComboBox->blockSignals(true);
+    languageComboBox->setCurrentIndex(index != -1 ? index : 0); // Default to English
+    languageComboBox->blockSignals(false);
     onLanguageChanged(languageComboBox->currentIndex());
+    StartupProfiler::mark("translations");
+}
+
+/**
+ * @brief Stops the network thread. Its event loop ends, then the backend and the
+ * scheduler are deleted on that thread before wait() returns.
+ */
+MainWindow::~MainWindow()
+{
+    ioThread->quit();
+    ioThread->wait();
 }
 
 /**
@@ -78,6 +165,10 @@ void MainWindow::setupUi()
     btnScan = new QPushButton();
     ipInput = new QLineEdit;
     btnConnect = new QPushButton();
+    btnConnectAll = new QPushButton();
+    btnQueueFarm = new QPushButton();
+    btnWatchFolder = new QPushButton();
+    btnDashboard = new QPushButton();
     scanPageLabel = new QLabel();
 
     languageComboBox = new QComboBox();
@@ -90,21 +181,41 @@ void MainWindow::setupUi()
     layout1->addWidget(btnScan);
     layout1->addWidget(ipInput);
     layout1->addWidget(btnConnect);
+    layout1->addWidget(btnConnectAll);
+    layout1->addWidget(btnQueueFarm);
+    layout1->addWidget(btnWatchFolder);
+    layout1->addWidget(btnDashboard);
 
     connect(btnScan, &QPushButton::clicked, this, &MainWindow::onScanClicked);
     connect(btnConnect, &QPushButton::clicked, this, &MainWindow::onConnectClicked);
+    connect(btnConnectAll, &QPushButton::clicked, this, &MainWindow::onConnectAllClicked);
+    connect(btnQueueFarm, &QPushButton::clicked, this, &MainWindow::onQueueFarmClicked);
+    connect(btnWatchFolder, &QPushButton::clicked, this, &MainWindow::onWatchFolderClicked);
+    connect(btnDashboard, &QPushButton::clicked, this, [this]()
+            {
+        ensureFarmPage();
+        qobject_cast<QStackedWidget *>(centralWidget())->setCurrentWidget(farmPage); });
     connect(languageComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &MainWindow::onLanguageChanged);
 
-    // --- PAGE 2: CONTROL ---
+    stack->addWidget(scanPage);
+
+    setCentralWidget(stack);
+    resize(400, 600);
+}
+
+/**
+ * @brief Builds the control page the first time it is needed. Most sessions start on the
+ * scanner, so startup does not pay for these widgets or for decoding the printer image.
+ */
+void MainWindow::ensureControlPage()
+{
+    if (controlPage)
+        return;
+
     controlPage = new QWidget;
     QVBoxLayout *layout2 = new QVBoxLayout(controlPage);
 
     imgLabel = new QLabel();
-    QPixmap pixmap(":/resources/images/default.png");
-    if (!pixmap.isNull())
-    {
-        imgLabel->setPixmap(pixmap.scaled(300, 300, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-    }
     imgLabel->setAlignment(Qt::AlignCenter);
 
     lblStatus = new QLabel();
@@ -127,11 +238,86 @@ void MainWindow::setupUi()
     connect(btnUpload, &QPushButton::clicked, this, &MainWindow::onUploadClicked);
     connect(btnPrintLast, &QPushButton::clicked, this, &MainWindow::onPrintLastClicked);
 
-    stack->addWidget(scanPage);
-    stack->addWidget(controlPage);
+    qobject_cast<QStackedWidget *>(centralWidget())->addWidget(controlPage);
+    showModelImage(shownModel);
+    retranslateControlPage();
+}
 
-    setCentralWidget(stack);
-    resize(400, 600);
+/**
+ * @brief Builds the farm dashboard the first time it is opened.
+ */
+void MainWindow::ensureFarmPage()
+{
+    if (farmPage)
+        return;
+
+    farmPage = new QWidget;
+    QVBoxLayout *layout3 = new QVBoxLayout(farmPage);
+
+    farmView = new QTableView;
+    farmView->setModel(farmModel);
+    farmView->setItemDelegate(new FarmDelegate(farmView));
+    farmView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    farmView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    farmView->verticalHeader()->setVisible(false);
+    // Fixed row heights: the view never measures rows, whatever the number of printers
+    farmView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    farmView->verticalHeader()->setDefaultSectionSize(24);
+    farmView->horizontalHeader()->setStretchLastSection(true);
+    farmView->setColumnWidth(FarmModel::PrinterColumn, 160);
+    farmView->setColumnWidth(FarmModel::StatusColumn, 140);
+    farmView->setColumnWidth(FarmModel::ProgressColumn, 220);
+    btnPauseAll = new QPushButton();
+    btnResumeAll = new QPushButton();
+    btnStopAll = new QPushButton();
+    lblFleetResult = new QLabel();
+    lblFarmQueue = new QLabel();
+    lblFarmFailures = new QLabel();
+    farmFailureList = new QListWidget();
+    farmFailureList->addItems(farmFailures);
+    farmFailureList->setMaximumHeight(120);
+    btnDashboardBack = new QPushButton();
+
+    QHBoxLayout *fleetLayout = new QHBoxLayout();
+    fleetLayout->addWidget(btnPauseAll);
+    fleetLayout->addWidget(btnResumeAll);
+    fleetLayout->addWidget(btnStopAll);
+    fleetLayout->addWidget(lblFleetResult, 1);
+
+    layout3->addWidget(farmView);
+    layout3->addLayout(fleetLayout);
+    layout3->addWidget(lblFarmQueue);
+    layout3->addWidget(lblFarmFailures);
+    layout3->addWidget(farmFailureList);
+    layout3->addWidget(btnDashboardBack);
+
+    connect(farmView, &QTableView::doubleClicked, this, &MainWindow::onDashboardActivated);
+    connect(btnPauseAll, &QPushButton::clicked, this, [this]()
+            { sendFleetCommand(SaturnBackend::FleetAction::Pause); });
+    connect(btnResumeAll, &QPushButton::clicked, this, [this]()
+            { sendFleetCommand(SaturnBackend::FleetAction::Resume); });
+    connect(btnStopAll, &QPushButton::clicked, this, [this]()
+            {
+        QMessageBox::StandardButton reply = QMessageBox::question(this, tr("Stop All"), tr("Stop the print on every connected printer?"),
+                                                                  QMessageBox::Yes | QMessageBox::No);
+        if (reply == QMessageBox::Yes)
+            sendFleetCommand(SaturnBackend::FleetAction::Stop); });
+    connect(btnDashboardBack, &QPushButton::clicked, this, [this]()
+            { qobject_cast<QStackedWidget *>(centralWidget())->setCurrentWidget(scanPage); });
+
+    qobject_cast<QStackedWidget *>(centralWidget())->addWidget(farmPage);
+    retranslateFarmPage();
+}
+
+/**
+ * @brief Sends a command to every connected printer. The result shows up on the
+ * dashboard when fleetCommandFinished() arrives.
+ */
+void MainWindow::sendFleetCommand(SaturnBackend::FleetAction action)
+{
+    lblFleetResult->setText(tr("Waiting for the printers..."));
+    QMetaObject::invokeMethod(backend, [this, action]()
+                              { backend->fleetCommand(action); });
 }
 
 /**
@@ -157,12 +343,52 @@ void MainWindow::retranslateUi()
     btnScan->setText(tr("Scan for Printers"));
     ipInput->setPlaceholderText(tr("Manual IP (e.g., 192.168.1.50)"));
     btnConnect->setText(tr("Connect"));
-    imgLabel->setText(tr("[Image not found]"));
+    btnConnectAll->setText(tr("Connect All Discovered"));
+    btnQueueFarm->setText(tr("Queue Files for Farm..."));
+    btnWatchFolder->setText(tr("Watch Folder..."));
+    btnDashboard->setText(tr("Farm Dashboard"));
+    if (farmPage)
+        retranslateFarmPage();
+    if (controlPage)
+        retranslateControlPage();
+    farmModel->retranslate();
+}
+
+/**
+ * @brief Re-translates the control page and re-renders the status shown on it.
+ */
+void MainWindow::retranslateControlPage()
+{
+    if (imgLabel->pixmap().isNull())
+        imgLabel->setText(tr("[Image not found]"));
     lblStatus->setText(tr("Status: DISCONNECTED"));
     lblFile->setText(tr("File: -"));
     lblRemainingTime->setText(tr("Remaining time: Calculating..."));
     btnUpload->setText(tr("Upload .goo File"));
     btnPrintLast->setText(tr("Print Last Uploaded File"));
+
+    if (shownStatus.state != PrinterStatus::State::Unknown)
+        updateStatus(shownStatus, PrinterStatus::AllFields);
+}
+
+/**
+ * @brief Re-translates the farm dashboard and re-renders the last farm-wide result.
+ */
+void MainWindow::retranslateFarmPage()
+{
+    btnPauseAll->setText(tr("Pause All"));
+    btnResumeAll->setText(tr("Resume All"));
+    btnStopAll->setText(tr("Stop All"));
+    btnDashboardBack->setText(tr("Back"));
+    lblFarmQueue->setText(QString(tr("Job queue: %1 waiting, %2 being sent")).arg(farmQueued).arg(farmDispatched));
+    lblFarmFailures->setText(tr("Failed jobs:"));
+
+    if (fleetAcknowledged < 0)
+        lblFleetResult->clear();
+    else if (fleetWorstMs < 0)
+        lblFleetResult->setText(QString(tr("%1 of %2 printers acknowledged")).arg(fleetAcknowledged).arg(fleetTotal));
+    else
+        lblFleetResult->setText(QString(tr("%1 of %2 printers acknowledged in %3 ms")).arg(fleetAcknowledged).arg(fleetTotal).arg(fleetWorstMs));
 }
 
 /**
@@ -172,6 +398,9 @@ void MainWindow::retranslateUi()
 void MainWindow::onLanguageChanged(int index)
 {
     QString langCode = languageComboBox->itemData(index).toString();
+    if (langCode == loadedLanguage)
+        return;
+    loadedLanguage = langCode;
 
     qApp->removeTranslator(&translator);
 
@@ -192,7 +421,7 @@ void MainWindow::onLanguageChanged(int index)
 void MainWindow::onScanClicked()
 {
     printerList->clear();
-    backend->startDiscovery();
+    QMetaObject::invokeMethod(backend, &SaturnBackend::startDiscovery);
 }
 
 /**
@@ -204,15 +433,57 @@ void MainWindow::onConnectClicked()
     if (ip.isEmpty())
         return;
 
-    QString model = ipToModel.value(ip, "Unknown");
-    QString imagePath = getIconPathForModel(model);
-    QPixmap pixmap(imagePath);
-    if (!pixmap.isNull())
-    {
-        imgLabel->setPixmap(pixmap.scaled(300, 300, Qt::KeepAspectRatio, Qt::SmoothTransformation));
-    }
+    showModelImage(ipToModel.value(ip, "Unknown"));
+
+    QMetaObject::invokeMethod(backend, [this, ip]()
+                              { backend->connectToPrinter(ip); });
+}
+
+/**
+ * @brief Slot triggered by the 'Connect All' button. Invites every discovered printer in parallel.
+ * The printers connect in the background; selecting one with 'Connect' then switches to it instantly.
+ */
+void MainWindow::onConnectAllClicked()
+{
+    QMetaObject::invokeMethod(backend, &SaturnBackend::connectToAllDiscovered);
+}
 
-    backend->connectToPrinter(ip);
+/**
+ * @brief Slot triggered by the 'Queue Files for Farm' button. Each selected file becomes a job
+ * that is printed on the first idle printer of the model it was sliced for.
+ */
+void MainWindow::onQueueFarmClicked()
+{
+    const QStringList files = QFileDialog::getOpenFileNames(this, tr("Open File"), "", tr("Goo Files (*.goo *.ctb)"));
+    QMetaObject::invokeMethod(scheduler, [this, files]()
+                              {
+        for (const QString &file : files)
+            scheduler->enqueue(file); });
+}
+
+/**
+ * @brief Slot triggered by the 'Watch Folder' button. Files dropped into the chosen folder
+ * are moved to its "ingested" subfolder, hashed, and queued for the farm.
+ */
+void MainWindow::onWatchFolderClicked()
+{
+    QString folder = QFileDialog::getExistingDirectory(this, tr("Select Hot Folder"), hotFolder->folder());
+    if (!folder.isEmpty())
+        hotFolder->setFolder(folder);
+}
+
+/**
+ * @brief Slot triggered by a double-click on the farm dashboard. Makes that printer the
+ * active one, as if its IP had been typed in and 'Connect' clicked.
+ */
+void MainWindow::onDashboardActivated(const QModelIndex &index)
+{
+    QString ip = index.data(FarmModel::IpRole).toString();
+    if (ip.isEmpty())
+        return;
+
+    ipInput->setText(ip);
+    onConnectClicked();
 }
 
 /**
@@ -223,9 +494,21 @@ void MainWindow::onUploadClicked()
     QString fileName = QFileDialog::getOpenFileName(this, tr("Open File"), "", tr("Goo Files (*.goo *.ctb)"));
     if (!fileName.isEmpty())
     {
-        QMessageBox::StandardButton reply;
-        reply = QMessageBox::question(this, tr("Print"), tr("Start printing immediately after upload?"),
-                                      QMessageBox::Yes | QMessageBox::No);
+        // Show what is about to be printed, straight from the file header
+        QMessageBox box(QMessageBox::Question, tr("Print"), tr("Start printing immediately after upload?"),
+                        QMessageBox::Yes | QMessageBox::No, this);
+        SliceFileInfo info = SliceFileInfo::read(fileName);
+        if (info.valid)
+        {
+            box.setInformativeText(tr("Layers: %1\nEstimated print time: %2h %3m\nResin: %4 ml")
+                                       .arg(info.layerCount)
+                                       .arg(info.printTimeSeconds / 3600)
+                                       .arg((info.printTimeSeconds % 3600) / 60)
+                                       .arg(info.volumeMl, 0, 'f', 1));
+            if (!info.preview.isNull())
+                box.setIconPixmap(QPixmap::fromImage(info.preview).scaled(128, 128, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        }
+        bool autoStart = box.exec() == QMessageBox::Yes;
         btnPrintLast->setVisible(false);
 
         lblStatus->setText(tr("Status: PREPARING UPLOAD..."));
@@ -233,56 +516,70 @@ void MainWindow::onUploadClicked()
         progressBar->setFormat(tr("Calculating MD5..."));
         QApplication::processEvents();
 
-        backend->uploadAndPrint(fileName, reply == QMessageBox::Yes);
+        QMetaObject::invokeMethod(backend, [this, fileName, autoStart]()
+                                  { backend->uploadAndPrint(fileName, autoStart); });
     }
 }
 
 /**
  * @brief Updates the UI with the latest status from the printer.
  */
-void MainWindow::updateStatus(QString status, int layer, int total, QString file)
+void MainWindow::updateStatus(const PrinterStatus &status, PrinterStatus::Fields changed)
 {
-    if (status.contains(tr("RECEIVING")) || status.contains(tr("Uploading")))
-    {
-        lblStatus->setText(tr("Status: ") + status);
-        lblStatus->setStyleSheet("font-weight: bold; color: orange;");
-        lblFile->setText(tr("File: ") + file);
-    }
-    else if (total > 0)
-    {
-        lblStatus->setText(tr("Status: ") + status);
-        lblStatus->setStyleSheet("font-weight: bold; color: green;");
-        lblFile->setText(QString(tr("File: %1 (Layer %2/%3)")).arg(file).arg(layer).arg(total));
-        progressBar->setValue((layer * 100) / total);
-        progressBar->setFormat(tr("%p% (Printing)"));
-    }
-    else
+    shownStatus = status;
+    if (!controlPage)
+        return; // Rendered when the page is built
+
+    if (changed & (PrinterStatus::StateField | PrinterStatus::LayerField | PrinterStatus::FileField | PrinterStatus::TransferField))
     {
-        lblStatus->setText(tr("Status: ") + status);
-        lblStatus->setStyleSheet("color: black;");
-        lblFile->setText(tr("File: ") + file);
-        if (status.contains(tr("Ready")))
+        lblStatus->setText(tr("Status: ") + FarmModel::statusText(status));
+        if (status.state == PrinterStatus::State::Receiving)
         {
-            progressBar->setValue(0);
-            progressBar->setFormat("%p%");
+            lblStatus->setStyleSheet("font-weight: bold; color: orange;");
+            lblFile->setText(tr("File: ") + status.filename);
+            progressBar->setValue(status.transferPercent);
+        }
+        else if (status.totalLayers > 0)
+        {
+            lblStatus->setStyleSheet("font-weight: bold; color: green;");
+            lblFile->setText(QString(tr("File: %1 (Layer %2/%3)")).arg(status.filename).arg(status.layer).arg(status.totalLayers));
+            progressBar->setValue((status.layer * 100) / status.totalLayers);
+            progressBar->setFormat(tr("%p% (Printing)"));
+        }
+        else
+        {
+            lblStatus->setStyleSheet("color: black;");
+            lblFile->setText(tr("File: ") + status.filename);
+            if (status.state == PrinterStatus::State::Ready)
+            {
+                progressBar->setValue(0);
+                progressBar->setFormat("%p%");
+            }
         }
     }
-}
 
-/**
- * @brief Slot to update the estimated remaining time display.
- * @param time The estimated time as a formatted string.
- */
-void MainWindow::updateRemainingTime(const QString &time)
-{
-    if (time.isEmpty())
-    {
-        lblRemainingTime->setVisible(false);
-    }
-    else
+    if ((changed & PrinterStatus::StateField) && status.isPrinting())
+        btnPrintLast->setVisible(false);
+
+    if (changed & (PrinterStatus::StateField | PrinterStatus::EtaField))
     {
-        lblRemainingTime->setText(tr("Remaining time: ") + time);
-        lblRemainingTime->setVisible(true);
+        if (!status.isPrinting())
+        {
+            lblRemainingTime->setVisible(false);
+        }
+        else if (status.remainingSeconds < 0)
+        {
+            lblRemainingTime->setText(tr("Remaining time: Calculating..."));
+            lblRemainingTime->setVisible(true);
+        }
+        else
+        {
+            int seconds = status.remainingSeconds;
+            QDateTime finishTime = QDateTime::currentDateTime().addSecs(seconds);
+            QString remainingStr = QString("%1h %2m").arg(seconds / 3600).arg((seconds % 3600) / 60);
+            lblRemainingTime->setText(tr("Remaining time: ") + tr("~%1 remaining (finishes at %2)").arg(remainingStr).arg(finishTime.toString("h:mm ap")));
+            lblRemainingTime->setVisible(true);
+        }
     }
 }
 
@@ -292,6 +589,7 @@ void MainWindow::updateRemainingTime(const QString &time)
 void MainWindow::showPrintButton(QString filename)
 {
     lastReadyFile = filename;
+    ensureControlPage();
     btnPrintLast->setText(tr("Print: ") + filename);
     btnPrintLast->setVisible(true);
 }
@@ -312,10 +610,59 @@ void MainWindow::onPrintLastClicked()
     if (reply == QMessageBox::Yes)
     {
         btnPrintLast->setVisible(false);
-        backend->printExistingFile(lastReadyFile);
+        QString fileName = lastReadyFile;
+        QMetaObject::invokeMethod(backend, [this, fileName]()
+                                  { backend->printExistingFile(fileName); });
     }
 }
 
+/**
+ * @brief Shows a printer model's image on the control page, or remembers it until the
+ * page is built.
+ */
+void MainWindow::showModelImage(const QString &modelName)
+{
+    shownModel = modelName;
+    if (!imgLabel)
+        return;
+
+    QPixmap pixmap = modelPixmap(modelName);
+    if (!pixmap.isNull())
+        imgLabel->setPixmap(pixmap);
+}
+
+/**
+ * @brief Returns a printer model's image, scaled to 300x300 logical pixels for the
+ * window's device pixel ratio. Scaled images are kept in QPixmapCache, keyed by image
+ * and ratio; the full-size decode is dropped as soon as it has been scaled.
+ */
+QPixmap MainWindow::modelPixmap(const QString &modelName)
+{
+    const qreal dpr = devicePixelRatioF();
+    const QString path = getIconPathForModel(modelName);
+    const QString key = QString("model:%1@%2").arg(path).arg(dpr);
+
+    QPixmap pixmap;
+    if (QPixmapCache::find(key, &pixmap))
+        return pixmap;
+
+    QImageReader reader(path);
+    QSize target = reader.size().scaled(QSize(300, 300) * dpr, Qt::KeepAspectRatio);
+    if (target.isValid() && reader.supportsOption(QImageIOHandler::ScaledSize))
+        reader.setScaledSize(target); // Decode straight to the target size when the format allows it
+
+    QImage image = reader.read();
+    if (image.isNull())
+        return QPixmap();
+    if (target.isValid() && image.size() != target)
+        image = image.scaled(target, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    pixmap = QPixmap::fromImage(std::move(image));
+    pixmap.setDevicePixelRatio(dpr);
+    QPixmapCache::insert(key, pixmap);
+    return pixmap;
+}
+
 /**
  * @brief Returns the resource path for a printer's icon based on its model name.
  */
@@ -7,9 +7,14 @@
 #include <QPushButton>
 #include <QLineEdit>
 #include <QListWidget>
+#include <QTableView>
 #include <QComboBox>
 #include <QTranslator>
+#include <QThread>
 #include "backend.h"
+#include "farmscheduler.h"
+#include "hotfolder.h"
+#include "farmmodel.h"
 
 /**
  * @class MainWindow
@@ -30,6 +35,11 @@ public:
      */
     explicit MainWindow(QWidget *parent = nullptr);
 
+    /**
+     * @brief Stops the network thread, which deletes the backend and the scheduler.
+     */
+    ~MainWindow() override;
+
 protected:
     /**
      * @brief Handles language change events to re-translate the UI.
@@ -49,24 +59,38 @@ private slots:
     void onConnectClicked();
 
     /**
-     * @brief Slot triggered when the 'Upload and Print' button is clicked.
+     * @brief Slot triggered when the 'Connect All' button is clicked.
      */
-    void onUploadClicked();
+    void onConnectAllClicked();
+
+    /**
+     * @brief Slot triggered when the 'Queue Files for Farm' button is clicked.
+     */
+    void onQueueFarmClicked();
+
+    /**
+     * @brief Slot triggered when the 'Watch Folder' button is clicked.
+     */
+    void onWatchFolderClicked();
 
     /**
-     * @brief Slot to update the status display in the UI.
-     * @param status A string describing the printer's current status.
-     * @param layer The current printing layer.
-     * @param total The total number of layers in the print job.
-     * @param file The name of the file being printed.
+     * @brief Slot triggered when a printer is double-clicked on the farm dashboard.
+     * @param index The clicked cell.
+     */
+    void onDashboardActivated(const QModelIndex &index);
+
+    /**
+     * @brief Slot triggered when the 'Upload and Print' button is clicked.
      */
-    void updateStatus(QString status, int layer, int total, QString file);
+    void onUploadClicked();
 
     /**
-     * @brief Slot to update the estimated remaining time display.
-     * @param time The estimated time as a formatted string.
+     * @brief Slot to update the status display in the UI. Only the widgets that depend
+     * on a changed field are re-rendered.
+     * @param status The active printer's status snapshot.
+     * @param changed The fields that changed since the previous snapshot.
      */
-    void updateRemainingTime(const QString &time);
+    void updateStatus(const PrinterStatus &status, PrinterStatus::Fields changed);
 
     /**
      * @brief Slot triggered when the 'Print Last Uploaded' button is clicked.
@@ -91,11 +115,50 @@ private:
      */
     void setupUi();
 
+    /**
+     * @brief Builds the control page on first use.
+     */
+    void ensureControlPage();
+
+    /**
+     * @brief Builds the farm dashboard on first use.
+     */
+    void ensureFarmPage();
+
     /**
      * @brief Re-translates all UI elements to the currently loaded language.
      */
     void retranslateUi();
 
+    /**
+     * @brief Re-translates the control page, once it exists.
+     */
+    void retranslateControlPage();
+
+    /**
+     * @brief Re-translates the farm dashboard, once it exists.
+     */
+    void retranslateFarmPage();
+
+    /**
+     * @brief Sends a command to every connected printer from the farm dashboard.
+     * @param action The command.
+     */
+    void sendFleetCommand(SaturnBackend::FleetAction action);
+
+    /**
+     * @brief Shows a printer model's image on the control page.
+     * @param modelName The name of the printer model.
+     */
+    void showModelImage(const QString &modelName);
+
+    /**
+     * @brief Returns a printer model's image, scaled for the control page and cached.
+     * @param modelName The name of the printer model.
+     * @return The scaled image, or a null pixmap if it could not be loaded.
+     */
+    QPixmap modelPixmap(const QString &modelName);
+
     /**
      * @brief Helper function to get the correct icon path based on the printer model.
      * @param modelName The name of the printer model.
@@ -103,31 +166,59 @@ private:
      */
     QString getIconPathForModel(const QString &modelName);
 
-    SaturnBackend *backend; ///< The backend logic handler.
+    QThread *ioThread;      ///< Event loop for the backend and the scheduler, away from UI work.
+    SaturnBackend *backend; ///< The backend logic handler. Lives on ioThread: call it through invokeMethod.
+    FarmScheduler *scheduler; ///< Dispatches queued jobs to idle printers. Lives on ioThread.
+    HotFolder *hotFolder;     ///< Queues files dropped into a watched folder.
+    FarmModel *farmModel;     ///< One row per printer, shown on the farm dashboard.
     QTranslator translator; ///< The translator for i18n.
 
     // UI Elements
     QWidget *scanPage;      ///< The widget acting as the first page for printer discovery.
-    QWidget *controlPage;   ///< The widget acting as the main control page after connection.
+    QWidget *controlPage = nullptr; ///< The widget acting as the main control page after connection.
+    QWidget *farmPage = nullptr;    ///< The farm dashboard, with every known printer.
 
     QListWidget *printerList; ///< List to display discovered printers.
     QLineEdit *ipInput;       ///< Manual IP input field (fallback).
-
-    QLabel *lblStatus;        ///< Label to display the printer's current status.
-    QLabel *lblFile;          ///< Label to display the name of the current file.
-    QLabel *lblRemainingTime; ///< Label to display the estimated remaining print time.
-    QProgressBar *progressBar;///< Progress bar for file uploads and print progress.
-    QPushButton *btnUpload;   ///< Button to initiate file upload.
-    QPushButton *btnPrintLast;///< Button to print the last successfully uploaded file.
+    QTableView *farmView = nullptr; ///< Table of every printer on the farm dashboard.
+
+    QLabel *lblStatus = nullptr;        ///< Label to display the printer's current status.
+    QLabel *lblFile = nullptr;          ///< Label to display the name of the current file.
+    QLabel *lblRemainingTime = nullptr; ///< Label to display the estimated remaining print time.
+    QProgressBar *progressBar = nullptr; ///< Progress bar for file uploads and print progress.
+    QPushButton *btnUpload = nullptr;   ///< Button to initiate file upload.
+    QPushButton *btnPrintLast = nullptr; ///< Button to print the last successfully uploaded file.
     QPushButton *btnScan;     ///< Button to scan for printers.
     QPushButton *btnConnect;  ///< Button to connect to a printer.
+    QPushButton *btnConnectAll; ///< Button to connect to every discovered printer at once.
+    QPushButton *btnQueueFarm; ///< Button to add files to the farm job queue.
+    QPushButton *btnWatchFolder; ///< Button to choose the hot folder.
+    QPushButton *btnDashboard; ///< Button to open the farm dashboard.
+    QPushButton *btnDashboardBack = nullptr; ///< Button to return from the farm dashboard to the scanner.
+    QPushButton *btnPauseAll = nullptr;  ///< Button to pause every print on the farm.
+    QPushButton *btnResumeAll = nullptr; ///< Button to resume every paused print on the farm.
+    QPushButton *btnStopAll = nullptr;   ///< Button to stop every print on the farm.
+    QLabel *lblFleetResult = nullptr;    ///< Outcome of the last farm-wide command.
+    QLabel *lblFarmQueue = nullptr;      ///< Jobs waiting and being sent.
+    QLabel *lblFarmFailures = nullptr;   ///< Title of the failed jobs list.
+    QListWidget *farmFailureList = nullptr; ///< Jobs the scheduler gave up on, newest first.
     QLabel *scanPageLabel;    ///< Label for the scan page.
-    QLabel *imgLabel;         ///< Label used to display the printer's image.
+    QLabel *imgLabel = nullptr;         ///< Label used to display the printer's image.
     QComboBox *languageComboBox; ///< Combo box for language selection.
 
     // State
     QString lastReadyFile;    ///< Stores the filename of the last file that was made ready to print.
+    PrinterStatus shownStatus; ///< Last status snapshot shown, re-rendered when the language changes.
+    QString shownModel;       ///< Model whose image the control page shows (or will show once built).
+    QString loadedLanguage;   ///< Language code of the installed translation.
     QMap<QString, QString> ipToModel; ///< Maps a printer's IP to its discovered model name.
+    int fleetAcknowledged = -1; ///< Printers that acknowledged the last farm-wide command (-1 = none sent).
+    int fleetTotal = 0;         ///< Printers the last farm-wide command was sent to.
+    qint64 fleetWorstMs = -1;   ///< Slowest acknowledgment of the last farm-wide command.
+    int farmQueued = 0;         ///< Jobs waiting for a printer.
+    int farmDispatched = 0;     ///< Jobs sent to a printer that has not started them yet.
+    QStringList farmFailures;   ///< Failed jobs, newest first, also for a dashboard built later.
+    const int MAX_FARM_FAILURES = 50; ///< Failed jobs listed on the dashboard.
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file
@@ -0,0 +1,341 @@
+#include "mqttconnection.h"
+#include "brokershards.h"
+#include "protocol.h"
+#include "trafficrecorder.h"
+#include <QHostAddress>
+#include <QJsonDocument>
+#include <QThread>
+#include <QThreadPool>
+
+namespace
+{
+/**
+ * @brief The decode pool shared by every connection, one thread per core.
+ */
+QThreadPool *decodePool()
+{
+    static QThreadPool *pool = []()
+    {
+        QThreadPool *p = new QThreadPool;
+        p->setObjectName("SaturnDecode");
+        p->setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+        return p;
+    }();
+    return pool;
+}
+}
+
+/**
+ * @brief Constructs a connection for an accepted socket.
+ * @param descriptor The native socket descriptor accepted by the server.
+ * @param recorder Receives every frame in both directions.
+ */
+MqttConnection::MqttConnection(qintptr descriptor, TrafficRecorder *recorder)
+    : QObject(nullptr), descriptor(descriptor), recorder(recorder), guard(std::make_shared<DecodeGuard>())
+{
+    guard->owner = this;
+}
+
+/**
+ * @brief Detaches the connection from a decode that may still be running.
+ */
+MqttConnection::~MqttConnection()
+{
+    QMutexLocker locker(&guard->mutex);
+    guard->owner = nullptr;
+}
+
+/**
+ * @brief Creates the socket on the worker thread and reports the printer's address.
+ */
+void MqttConnection::start()
+{
+    socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(descriptor))
+    {
+        ShardedTcpServer::closeDescriptor(descriptor);
+        emit closed();
+        return;
+    }
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1); // Acknowledgements are tiny; don't let Nagle hold them
+    socket->setSocketOption(QAbstractSocket::TypeOfServiceOption, 0xB8); // DSCP EF: Wi-Fi (WMM) queues it ahead of file data
+
+    connect(socket, &QTcpSocket::readyRead, this, &MqttConnection::onReadyRead);
+    connect(socket, &QTcpSocket::disconnected, this, &MqttConnection::closed);
+
+    QString ip = socket->peerAddress().toString();
+    if (ip.startsWith("::ffff:")) // Handle IPv6-mapped IPv4 addresses
+        ip = ip.mid(7);
+    peerIp = ip;
+    emit opened(ip);
+}
+
+/**
+ * @brief Reassembles MQTT frames from the stream and handles every complete one.
+ * A frame split across reads stays in the buffer until the rest arrives.
+ */
+void MqttConnection::onReadyRead()
+{
+    buffer.append(socket->readAll());
+
+    int ptr = 0;
+    while (buffer.size() - ptr >= 2)
+    {
+        uint8_t header = (uint8_t)buffer[ptr];
+        int headerSize = 0;
+        int length = frameLength(buffer, ptr, headerSize);
+        if (length == -2)
+        {
+            socket->abort(); // Malformed length
+            return;
+        }
+        if (length < 0)
+            break; // Length not fully received yet
+
+        int pos = ptr + headerSize;
+        if (pos + length > buffer.size())
+            break; // Incomplete packet
+
+        recorder->record(TrafficRecord::MqttIn, peerIp, buffer.mid(ptr, headerSize + length));
+        handlePacket(header >> 4, header & 0x0F, buffer.mid(pos, length));
+        ptr = pos + length;
+    }
+
+    buffer.remove(0, ptr);
+    if (buffer.size() > MAX_BUFFERED)
+        socket->abort();
+}
+
+/**
+ * @brief Reads the fixed header of the MQTT frame that starts at an offset.
+ */
+int MqttConnection::frameLength(const QByteArray &buffer, int offset, int &headerSize)
+{
+    int pos = offset + 1;
+
+    // Decode MQTT's variable-length integer for message length (at most 4 bytes)
+    int multiplier = 1;
+    int length = 0;
+    int digits = 0;
+    while (pos < buffer.size() && digits < 4)
+    {
+        uint8_t digit = (uint8_t)buffer[pos++];
+        length += (digit & 127) * multiplier;
+        multiplier *= 128;
+        digits++;
+        if ((digit & 128) == 0)
+        {
+            headerSize = pos - offset;
+            return length;
+        }
+    }
+    return digits == 4 ? -2 : -1;
+}
+
+/**
+ * @brief Splits the variable header and payload of a PUBLISH packet.
+ */
+bool MqttConnection::splitPublish(int flags, const QByteArray &payload, QString &topic, int &packetId, QByteArray &json)
+{
+    if (payload.size() < 2)
+        return false;
+
+    // Parse the topic and payload from the publish message
+    int qos = (flags >> 1) & 0x03;
+    int topicLen = (uint8_t)payload[0] << 8 | (uint8_t)payload[1];
+    topic = QString::fromUtf8(payload.mid(2, topicLen));
+    int payloadOffset = 2 + topicLen;
+
+    // QoS 1 messages include a Packet ID that must be acknowledged
+    packetId = 0;
+    if (qos > 0 && payload.size() >= payloadOffset + 2)
+    {
+        packetId = (uint8_t)payload[payloadOffset] << 8 | (uint8_t)payload[payloadOffset + 1];
+        payloadOffset += 2; // Move pointer past the packet ID
+    }
+
+    json = payload.mid(payloadOffset);
+    return true;
+}
+
+/**
+ * @brief Answers a complete MQTT packet and forwards what the backend needs.
+ * @param type The MQTT message type.
+ * @param flags The flags of the fixed header.
+ * @param payload The variable header and payload.
+ */
+void MqttConnection::handlePacket(int type, int flags, const QByteArray &payload)
+{
+    if (type == MQTT_CONNECT)
+    {
+        // Respond to a connection request with a connection acknowledgment
+        send(MQTT_CONNACK, 0, QByteArray::fromHex("0000"));
+    }
+    else if (type == MQTT_SUBSCRIBE && payload.size() >= 2)
+    {
+        // Respond to a subscription request with a subscription acknowledgment
+        int packetId = (uint8_t)payload[0] << 8 | (uint8_t)payload[1];
+        QByteArray response;
+        response.append((char)0x00); // Success code
+        send(MQTT_SUBACK, 0, response, packetId);
+        emit subscribed();
+    }
+    else if (type == MQTT_PUBLISH)
+    {
+        QString topic;
+        int packetId = 0;
+        QByteArray json;
+        if (!splitPublish(flags, payload, topic, packetId, json))
+            return;
+
+        // IMPORTANT: Acknowledge receipt so the printer doesn't get stuck waiting
+        if (packetId > 0)
+            send(MQTT_PUBACK, 0, QByteArray(), packetId);
+
+        enqueueDecode(topic, json);
+    }
+}
+
+/**
+ * @brief Queues an acknowledged message for decoding.
+ * Status reports are full snapshots, so when the backlog is full the oldest one is
+ * dropped; responses and attributes are always kept.
+ * @param topic The topic the message was published on.
+ * @param json The raw JSON payload.
+ */
+void MqttConnection::enqueueDecode(const QString &topic, const QByteArray &json)
+{
+    if (decodeQueue.size() >= MAX_DECODE_BACKLOG)
+    {
+        for (int i = 0; i < decodeQueue.size(); ++i)
+        {
+            if (decodeQueue[i].topic.contains("/sdcp/status/"))
+            {
+                decodeQueue.removeAt(i);
+                break;
+            }
+        }
+    }
+
+    decodeQueue.append({topic, json});
+    startNextDecode();
+}
+
+/**
+ * @brief Sends the oldest queued message to the decode pool, unless one is already there.
+ */
+void MqttConnection::startNextDecode()
+{
+    if (decoding || decodeQueue.isEmpty())
+        return;
+
+    RawMessage message = decodeQueue.takeFirst();
+    decoding = true;
+
+    std::shared_ptr<DecodeGuard> taskGuard = guard;
+    decodePool()->start([taskGuard, message]()
+                        {
+        QJsonObject root = QJsonDocument::fromJson(message.json).object();
+
+        QMutexLocker locker(&taskGuard->mutex);
+        if (MqttConnection *owner = taskGuard->owner)
+        {
+            QString topic = message.topic;
+            QMetaObject::invokeMethod(owner, [owner, topic, root]()
+                                      { owner->onDecoded(topic, root); }, Qt::QueuedConnection);
+        } });
+}
+
+/**
+ * @brief Forwards a decoded message and starts decoding the next one.
+ */
+void MqttConnection::onDecoded(const QString &topic, const QJsonObject &root)
+{
+    decoding = false;
+    emit published(topic, root);
+    startNextDecode();
+}
+
+/**
+ * @brief Sends a QoS 1 PUBLISH packet with the next packet ID.
+ */
+void MqttConnection::publish(const QString &topic, const QByteArray &payload)
+{
+    if (!socket || socket->state() != QAbstractSocket::ConnectedState)
+        return;
+
+    QByteArray topicBytes = topic.toUtf8();
+    QByteArray packet;
+    packet.append((char)(topicBytes.size() >> 8));   // Topic Length MSB
+    packet.append((char)(topicBytes.size() & 0xFF)); // Topic Length LSB
+    packet.append(topicBytes);                       // Topic Name
+
+    // Add Packet ID for QoS 1
+    int pid = nextPacketId;
+    nextPacketId = nextPacketId % 0xFFFF + 1; // Packet IDs are 1..65535
+    packet.append((char)(pid >> 8));
+    packet.append((char)(pid & 0xFF));
+
+    packet.append(payload); // JSON payload
+
+    // Send as MQTT_PUBLISH with QoS 1 (flags = 2)
+    send(MQTT_PUBLISH, 2, packet, 0); // Packet ID is inside the packet already
+}
+
+/**
+ * @brief Drops the connection; closed() follows.
+ */
+void MqttConnection::close()
+{
+    if (socket)
+        socket->abort();
+}
+
+/**
+ * @brief Constructs and sends a low-level MQTT message.
+ * @param type The MQTT message type (e.g., MQTT_PUBLISH).
+ * @param flags The MQTT message flags.
+ * @param payload The message payload.
+ * @param packetId The packet identifier, used for QoS > 0 messages.
+ */
+void MqttConnection::send(int type, int flags, const QByteArray &payload, int packetId)
+{
+    QByteArray header;
+    header.append((char)((type << 4) | flags));
+
+    int len = payload.size();
+    if (packetId > 0 || type == MQTT_PUBACK || type == MQTT_SUBACK)
+        len += 2; // Add 2 bytes for the packet ID
+
+    header.append(encodeLength(len));
+
+    if (packetId > 0 || type == MQTT_PUBACK || type == MQTT_SUBACK)
+    {
+        header.append((char)(packetId >> 8));   // MSB
+        header.append((char)(packetId & 0xFF)); // LSB
+    }
+
+    QByteArray frame = header + payload;
+    recorder->record(TrafficRecord::MqttOut, peerIp, frame);
+    socket->write(frame);
+    socket->flush();
+}
+
+/**
+ * @brief Encodes an integer into the MQTT variable-length integer format.
+ * @param length The integer to encode.
+ * @return A QByteArray containing the encoded length.
+ */
+QByteArray MqttConnection::encodeLength(int length)
+{
+    QByteArray encoded;
+    do
+    {
+        int digit = length % 128;
+        length /= 128;
+        if (length > 0)
+            digit |= 0x80; // Set the continuation bit
+        encoded.append((char)digit);
+    } while (length > 0);
+    return encoded;
+}
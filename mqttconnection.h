@@ -0,0 +1,153 @@
+#ifndef MQTTCONNECTION_H
+#define MQTTCONNECTION_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QTcpSocket>
+#include <QList>
+#include <QMutex>
+#include <memory>
+
+class TrafficRecorder;
+
+/**
+ * @class MqttConnection
+ * @brief One printer's connection to our MQTT broker, running on a broker worker thread.
+ *
+ * The connection does everything that does not need the backend's state: it reassembles
+ * MQTT frames from the TCP stream and answers CONNECT, SUBSCRIBE and QoS 1 PUBLISH packets
+ * as soon as they are framed. JSON decoding runs on a shared, bounded decode pool, so a
+ * slow decode or a burst never delays acknowledgements or the reading of later frames.
+ * Each connection has at most one decode in flight, which keeps its messages in order.
+ * Decoded messages are handed to the backend through queued signals (QJsonObject is
+ * implicitly shared, so the handoff copies nothing).
+ *
+ * The backend owns the object: it is never deleted by itself, only with deleteLater().
+ */
+class MqttConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs a connection for an accepted socket. Call start() on the worker thread.
+     * @param descriptor The native socket descriptor accepted by the server.
+     * @param recorder Receives every frame in both directions. Must outlive the connection.
+     */
+    MqttConnection(qintptr descriptor, TrafficRecorder *recorder);
+
+    /**
+     * @brief Detaches the connection from decodes still running on the pool.
+     */
+    ~MqttConnection() override;
+
+    /**
+     * @brief Reads the fixed header of the MQTT frame that starts at an offset.
+     * @param buffer Received bytes.
+     * @param offset Where the frame starts.
+     * @param headerSize Receives the size of the fixed header (type byte and length).
+     * @return The length of the rest of the frame, -1 if the header is incomplete, or
+     * -2 if the length field is malformed.
+     */
+    static int frameLength(const QByteArray &buffer, int offset, int &headerSize);
+
+    /**
+     * @brief Splits the variable header and payload of a PUBLISH packet.
+     * @param flags The flags of the fixed header.
+     * @param payload The variable header and payload.
+     * @param topic Receives the topic.
+     * @param packetId Receives the packet ID, or 0 for QoS 0.
+     * @param json Receives the message payload.
+     * @return False if the packet is too short.
+     */
+    static bool splitPublish(int flags, const QByteArray &payload, QString &topic, int &packetId, QByteArray &json);
+
+public slots:
+    /**
+     * @brief Creates the socket on the current thread and starts reading.
+     */
+    void start();
+
+    /**
+     * @brief Sends a QoS 1 PUBLISH packet.
+     * @param topic The topic to publish on.
+     * @param payload The message payload.
+     */
+    void publish(const QString &topic, const QByteArray &payload);
+
+    /**
+     * @brief Drops the connection at once.
+     */
+    void close();
+
+signals:
+    /**
+     * @brief Emitted once the socket is set up.
+     * @param ip The printer's IP address.
+     */
+    void opened(QString ip);
+
+    /**
+     * @brief Emitted when the printer has subscribed and can receive commands.
+     */
+    void subscribed();
+
+    /**
+     * @brief Emitted for every message the printer publishes.
+     * @param topic The topic the message was published on.
+     * @param root The decoded JSON payload.
+     */
+    void published(QString topic, QJsonObject root);
+
+    /**
+     * @brief Emitted when the socket closes, whoever closed it.
+     */
+    void closed();
+
+private slots:
+    void onReadyRead();
+
+private:
+    /**
+     * @brief Lets decode tasks reach the connection only while it exists.
+     * The destructor clears owner under the mutex, so a task either posts its result
+     * before that (and the event is discarded with the object) or sees nullptr.
+     */
+    struct DecodeGuard
+    {
+        QMutex mutex;
+        MqttConnection *owner = nullptr;
+    };
+
+    /**
+     * @brief A message waiting to be decoded.
+     */
+    struct RawMessage
+    {
+        QString topic;
+        QByteArray json;
+    };
+
+    void handlePacket(int type, int flags, const QByteArray &payload);
+    void enqueueDecode(const QString &topic, const QByteArray &json);
+    void startNextDecode();
+    void onDecoded(const QString &topic, const QJsonObject &root);
+    void send(int type, int flags, const QByteArray &payload, int packetId = 0);
+    static QByteArray encodeLength(int length);
+
+    qintptr descriptor;             ///< Descriptor to adopt in start().
+    TrafficRecorder *recorder;      ///< Capture of the traffic, when enabled.
+    QString peerIp;                 ///< The printer's address.
+    QTcpSocket *socket = nullptr;   ///< The printer's socket, created on the worker thread.
+    QByteArray buffer;              ///< Bytes received but not framed yet.
+    int nextPacketId = 1;           ///< Counter for the packet IDs of our publishes.
+    QList<RawMessage> decodeQueue;  ///< Messages acknowledged but not decoded yet, in arrival order.
+    bool decoding = false;          ///< A decode of this connection is running on the pool.
+    std::shared_ptr<DecodeGuard> guard; ///< Shared with the running decode task.
+
+    const int MAX_BUFFERED = 1024 * 1024; ///< A frame larger than this is treated as garbage.
+    const int MAX_DECODE_BACKLOG = 32;    ///< Queued messages before old status reports are dropped.
+};
+
+#endif // MQTTCONNECTION_H
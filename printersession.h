@@ -0,0 +1,70 @@
+#ifndef PRINTERSESSION_H
+#define PRINTERSESSION_H
+
+#include <QString>
+#include <QList>
+#include <QDateTime>
+#include <QByteArray>
+#include <QPair>
+#include <QHash>
+#include "etaestimator.h"
+#include "remoteinventory.h"
+#include "printerstatus.h"
+
+class MqttConnection;
+
+/**
+ * @brief Expected layer durations read from the header of an uploaded file.
+ */
+struct EtaPrior
+{
+    int bottomLayers = 0;           ///< Number of bottom layers.
+    double bottomLayerSeconds = 0;  ///< Expected duration of a bottom layer.
+    double normalLayerSeconds = 0;  ///< Expected duration of a normal layer.
+};
+
+/**
+ * @brief Holds everything the backend knows about one printer.
+ *
+ * A session is created the first time we invite a printer (or it connects to our
+ * broker) and lives for as long as the application runs. Only one session is the
+ * "active" one shown in the UI; the others keep running in the background.
+ */
+struct PrinterSession
+{
+    QString ip;                   ///< IP address of the printer.
+    MqttConnection *connection = nullptr; ///< The printer's MQTT connection (on a broker worker), if connected.
+    QString mainboardId;          ///< The mainboard ID received from the printer.
+    QString printerId;            ///< The UUID of the printer (from discovery or MQTT).
+    QString model;                ///< The machine name reported by the printer.
+
+    // Supervision
+    bool supervised = false;      ///< Set once the printer has subscribed; drops trigger a reconnect.
+    qint64 lastStatusMs = -1;     ///< Monotonic time of the last status report (-1 while disconnected).
+    QList<QPair<int, QByteArray>> pendingCommands; ///< Control commands issued while reconnecting (ID, serialized data).
+    PrinterStatus status;         ///< Last interpreted status report.
+
+    // Upload
+    QString currentFileId;        ///< A random ID generated for each HTTP upload session.
+    QString uploadFilePath;       ///< Local path of the file being uploaded.
+    QString currentFileMd5;       ///< MD5 checksum of the file being uploaded.
+    QString uploadedFilename;     ///< Name of the last successfully uploaded file.
+    bool shouldAutoPrint = false; ///< Flag to indicate if printing should start after upload.
+    bool compressedTransfer = false;  ///< The current upload is being served gzip-encoded.
+    bool compressionSuspect = false;  ///< The last gzip transfer failed; the next upload is sent plain to find out why.
+    bool compressionRejected = false; ///< A gzip transfer failed where a plain one succeeded; always send plain files.
+    bool transferActive = false;  ///< The printer has started downloading the current upload.
+    qint64 uploadFileSize = 0;    ///< Size of the file being uploaded.
+    qint64 transferStartedMs = 0; ///< Monotonic time the printer requested the current upload.
+    QString lastPrintFilename;    ///< File named in the last print command (128).
+
+    // Storage
+    RemoteInventory inventory;    ///< Files on the printer, used to skip uploading content it already has.
+
+    // Time Estimation
+    EtaEstimator eta;             ///< Remaining-time model fed with the printer's layer reports.
+    QString etaPriorFile;         ///< File whose header (or the printer's history) seeded the estimator's prior.
+    QHash<QString, EtaPrior> etaPriors; ///< Header priors of the files sent to this printer, by filename.
+};
+
+#endif // PRINTERSESSION_H
@@ -0,0 +1,90 @@
+#ifndef PRINTERSTATUS_H
+#define PRINTERSTATUS_H
+
+#include <QString>
+#include <QFlags>
+#include <QMetaType>
+
+/**
+ * @brief A compact, language-neutral snapshot of what the active printer is doing.
+ *
+ * The backend publishes one of these whenever a field changes, together with flags that
+ * say which fields did. Turning the snapshot into text is left to the view, so the
+ * backend never formats or compares translated strings.
+ */
+struct PrinterStatus
+{
+    /**
+     * @brief What the printer is doing, as far as the UI is concerned.
+     */
+    enum class State
+    {
+        Unknown,       ///< No status report interpreted yet.
+        Disconnected,  ///< The connection was lost; a reconnection is in progress.
+        Ready,         ///< Idle and ready for a new job.
+        Receiving,     ///< Downloading a file from us (see transferPercent).
+        Processing,    ///< Busy with a file after the download (e.g. verifying it).
+        Exposing,      ///< Printing: a layer is being exposed.
+        Retracting,    ///< Printing: the build plate is retracting.
+        Lowering,      ///< Printing: the build plate is lowering.
+        Printing,      ///< Printing, in a phase we have no name for (see printCode).
+        Paused,        ///< Print complete or paused; the printer reports both the same way.
+        TransferError  ///< Idle after a failed transfer.
+    };
+
+    /**
+     * @brief The fields of the snapshot, used as change flags.
+     */
+    enum Field
+    {
+        StateField = 0x01,     ///< state or printCode.
+        LayerField = 0x02,     ///< layer or totalLayers.
+        FileField = 0x04,      ///< filename.
+        TransferField = 0x08,  ///< transferPercent.
+        EtaField = 0x10,       ///< remainingSeconds.
+        AllFields = 0x1F
+    };
+    Q_DECLARE_FLAGS(Fields, Field)
+
+    State state = State::Unknown;
+    int printCode = 0;          ///< Raw PrintInfo.Status, only meaningful for State::Printing.
+    int layer = 0;              ///< Current layer while printing, 0 otherwise.
+    int totalLayers = 0;        ///< Layers in the job while printing, 0 otherwise.
+    QString filename;           ///< File being printed or received; empty when idle.
+    int transferPercent = 0;    ///< Download progress while receiving, 0 otherwise.
+    int remainingSeconds = -1;  ///< Estimated time left while printing; -1 if unknown or not printing.
+
+    /**
+     * @brief True for the states in which the printer is running a job.
+     */
+    bool isPrinting() const
+    {
+        return state == State::Exposing || state == State::Retracting || state == State::Lowering || state == State::Printing;
+    }
+
+    /**
+     * @brief Compares two snapshots field by field.
+     * @param other The previous snapshot.
+     * @return The fields that differ.
+     */
+    Fields changedFields(const PrinterStatus &other) const
+    {
+        Fields changed;
+        if (state != other.state || printCode != other.printCode)
+            changed |= StateField;
+        if (layer != other.layer || totalLayers != other.totalLayers)
+            changed |= LayerField;
+        if (filename != other.filename)
+            changed |= FileField;
+        if (transferPercent != other.transferPercent)
+            changed |= TransferField;
+        if (remainingSeconds != other.remainingSeconds)
+            changed |= EtaField;
+        return changed;
+    }
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(PrinterStatus::Fields)
+Q_DECLARE_METATYPE(PrinterStatus)
+
+#endif // PRINTERSTATUS_H
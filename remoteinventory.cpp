@@ -0,0 +1,137 @@
+#include "remoteinventory.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+
+/**
+ * @brief Loads the checksums recorded for a mainboard in a previous run.
+ * They only count once the printer's file list confirms the files are still there.
+ * @param mainboardId The printer's mainboard ID.
+ */
+void RemoteInventory::load(const QString &mainboardId)
+{
+    if (mainboardId.isEmpty() || mainboardId == mainboard)
+        return;
+    mainboard = mainboardId;
+
+    QFile f(storagePath());
+    if (!f.open(QIODevice::ReadOnly))
+        return;
+
+    const QJsonObject root = QJsonDocument::fromJson(f.readAll()).object();
+    for (auto it = root.begin(); it != root.end(); ++it)
+    {
+        QJsonObject obj = it.value().toObject();
+        if (entries.contains(it.key()))
+            continue; // Newer than what was saved
+
+        Entry entry;
+        entry.name = it.key();
+        entry.size = obj["Size"].toInteger(-1);
+        entry.md5 = obj["MD5"].toString();
+        entries.insert(entry.name, entry);
+    }
+}
+
+/**
+ * @brief Replaces the cached names and sizes with the printer's file list.
+ * Checksums are kept for files whose size did not change.
+ * @param fileList The "FileList" array of a command 258 response.
+ */
+void RemoteInventory::applyFileList(const QJsonArray &fileList)
+{
+    QMap<QString, Entry> updated;
+    for (const QJsonValue &value : fileList)
+    {
+        QJsonObject obj = value.toObject();
+        if (obj.contains("type") && obj["type"].toInt() == 0)
+            continue; // Folder
+
+        Entry entry;
+        entry.name = QFileInfo(obj["name"].toString()).fileName(); // Strip "/local/"
+        entry.size = obj.contains("usedSize") ? obj["usedSize"].toInteger(-1) : obj["totalSize"].toInteger(-1);
+        if (entry.name.isEmpty())
+            continue;
+
+        auto known = entries.constFind(entry.name);
+        if (known != entries.cend() && (entry.size < 0 || known->size == entry.size))
+            entry.md5 = known->md5;
+        updated.insert(entry.name, entry);
+    }
+
+    entries = updated;
+    listed = true;
+    save();
+}
+
+/**
+ * @brief Records a file we have just uploaded successfully.
+ */
+void RemoteInventory::recordUpload(const QString &name, qint64 size, const QString &md5)
+{
+    Entry entry;
+    entry.name = name;
+    entry.size = size;
+    entry.md5 = md5;
+    entries.insert(name, entry);
+    save();
+}
+
+/**
+ * @brief Forgets a file.
+ */
+void RemoteInventory::remove(const QString &name)
+{
+    if (entries.remove(name) > 0)
+        save();
+}
+
+/**
+ * @brief Returns true if the printer holds a file with this name and exactly this content.
+ * Nothing matches before the printer's file list has confirmed what is on its storage.
+ */
+bool RemoteInventory::contains(const QString &name, qint64 size, const QString &md5) const
+{
+    if (!listed || md5.isEmpty())
+        return false;
+
+    auto it = entries.constFind(name);
+    return it != entries.cend() && it->size == size && it->md5.compare(md5, Qt::CaseInsensitive) == 0;
+}
+
+/**
+ * @brief Returns the file the checksums of this mainboard are saved to.
+ */
+QString RemoteInventory::storagePath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/inventory/" + mainboard + ".json";
+}
+
+/**
+ * @brief Saves the files whose checksum we know; the rest is re-read from the printer.
+ */
+void RemoteInventory::save() const
+{
+    if (mainboard.isEmpty())
+        return;
+
+    QJsonObject root;
+    for (const Entry &entry : entries)
+    {
+        if (entry.md5.isEmpty())
+            continue;
+        QJsonObject obj;
+        obj["Size"] = entry.size;
+        obj["MD5"] = entry.md5;
+        root[entry.name] = obj;
+    }
+
+    QString path = storagePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QFile f(path);
+    if (f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        f.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+}
@@ -0,0 +1,83 @@
+#ifndef REMOTEINVENTORY_H
+#define REMOTEINVENTORY_H
+
+#include <QString>
+#include <QMap>
+#include <QJsonArray>
+
+/**
+ * @class RemoteInventory
+ * @brief Cached list of the files stored on one printer.
+ *
+ * Names and sizes come from the printer's file list (command 258). The printer does not
+ * report checksums, so the MD5 of a file is only known when we uploaded it ourselves;
+ * those checksums are saved to disk per mainboard, so they survive restarts. A file whose
+ * size changed since we recorded it loses its checksum, since it was replaced by something else.
+ */
+class RemoteInventory
+{
+public:
+    /**
+     * @brief A file on the printer's storage.
+     */
+    struct Entry
+    {
+        QString name;   ///< File name, without the storage prefix.
+        qint64 size = -1; ///< Size in bytes (-1 if unknown).
+        QString md5;    ///< MD5 of the content, if we uploaded it.
+    };
+
+    /**
+     * @brief Loads the checksums recorded for a mainboard in a previous run.
+     * @param mainboardId The printer's mainboard ID.
+     */
+    void load(const QString &mainboardId);
+
+    /**
+     * @brief Returns true once the printer's file list has been received.
+     */
+    bool isLoaded() const { return listed; }
+
+    /**
+     * @brief Replaces the cached names and sizes with the printer's file list.
+     * @param fileList The "FileList" array of a command 258 response.
+     */
+    void applyFileList(const QJsonArray &fileList);
+
+    /**
+     * @brief Records a file we have just uploaded successfully.
+     * @param name The file name.
+     * @param size The file size in bytes.
+     * @param md5 The MD5 of the content.
+     */
+    void recordUpload(const QString &name, qint64 size, const QString &md5);
+
+    /**
+     * @brief Forgets a file (failed transfer, or the printer could not open it).
+     * @param name The file name.
+     */
+    void remove(const QString &name);
+
+    /**
+     * @brief Returns true if the printer holds a file with this name and exactly this content.
+     * @param name The file name.
+     * @param size The file size in bytes.
+     * @param md5 The MD5 of the content.
+     */
+    bool contains(const QString &name, qint64 size, const QString &md5) const;
+
+    /**
+     * @brief Returns the cached files, keyed by name.
+     */
+    QMap<QString, Entry> files() const { return entries; }
+
+private:
+    void save() const;
+    QString storagePath() const;
+
+    QString mainboard;             ///< Mainboard the checksums are saved for.
+    QMap<QString, Entry> entries;  ///< Files on the printer, keyed by name.
+    bool listed = false;           ///< The printer's file list has been received.
+};
+
+#endif // REMOTEINVENTORY_H
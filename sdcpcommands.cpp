@@ -0,0 +1,58 @@
+#include "sdcpcommands.h"
+
+namespace Sdcp
+{
+/**
+ * @brief Appends a JSON string, escaped the way QJsonDocument does: quotes, backslashes
+ * and control characters are escaped, everything else is written as UTF-8.
+ */
+void JsonWriter::appendString(const QString &value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    out.append('"');
+    for (char c : utf8)
+    {
+        switch (c)
+        {
+        case '"': out.append("\\\"", 2); break;
+        case '\\': out.append("\\\\", 2); break;
+        case '\b': out.append("\\b", 2); break;
+        case '\f': out.append("\\f", 2); break;
+        case '\n': out.append("\\n", 2); break;
+        case '\r': out.append("\\r", 2); break;
+        case '\t': out.append("\\t", 2); break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                out.append("\\u00").append("0123456789abcdef"[(c >> 4) & 0xF]).append("0123456789abcdef"[c & 0xF]);
+            else
+                out.append(c);
+        }
+    }
+    out.append('"');
+}
+
+/**
+ * @brief Wraps a serialized "Data" member in the SDCP request envelope.
+ */
+QByteArray envelope(int cmdId, const QByteArray &data, const QString &mainboardId, const QString &requestId, qint64 timestampMs, const QString &id)
+{
+    QByteArray inner;
+    inner.reserve(160 + data.size());
+    JsonWriter request(inner);
+    request.field("Cmd", cmdId);
+    request.rawField("Data", data);
+    request.field("From", 0);
+    request.field("MainboardID", mainboardId);
+    request.field("RequestID", requestId);
+    request.field("TimeStamp", timestampMs);
+    request.finish();
+
+    QByteArray out;
+    out.reserve(inner.size() + 64);
+    JsonWriter message(out);
+    message.rawField("Data", inner);
+    message.field("Id", id);
+    message.finish();
+    return out;
+}
+}
@@ -0,0 +1,317 @@
+#ifndef SDCPCOMMANDS_H
+#define SDCPCOMMANDS_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <cstddef>
+#include <type_traits>
+
+/**
+ * @file sdcpcommands.h
+ * @brief The SDCP commands we send, as typed payloads in a compile-time registry.
+ *
+ * Each command is a struct with its ID, a name for the log and a write() that emits
+ * its "Data" object through a JsonWriter. Keys are string literals whose length is
+ * known at compile time, so a payload is appended straight into the output buffer
+ * without building a JSON tree. Field order follows the sorted keys QJsonDocument
+ * used to produce, so the bytes on the wire are unchanged.
+ */
+namespace Sdcp
+{
+/**
+ * @class JsonWriter
+ * @brief Appends the members of one JSON object to a buffer.
+ */
+class JsonWriter
+{
+public:
+    /**
+     * @brief Starts an object in the buffer; finish() closes it.
+     * @param out The buffer to append to.
+     */
+    explicit JsonWriter(QByteArray &out) : out(out) { out.append('{'); }
+
+    /**
+     * @brief Appends an integer member.
+     */
+    template <std::size_t N, typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    void field(const char (&key)[N], T value)
+    {
+        appendKey(key);
+        out.append(QByteArray::number(static_cast<qint64>(value)));
+    }
+
+    /**
+     * @brief Appends a string member.
+     */
+    template <std::size_t N>
+    void field(const char (&key)[N], const QString &value)
+    {
+        appendKey(key);
+        appendString(value);
+    }
+
+    /**
+     * @brief Appends an array-of-strings member.
+     */
+    template <std::size_t N>
+    void field(const char (&key)[N], const QStringList &values)
+    {
+        appendKey(key);
+        out.append('[');
+        for (int i = 0; i < values.size(); ++i)
+        {
+            if (i > 0)
+                out.append(',');
+            appendString(values[i]);
+        }
+        out.append(']');
+    }
+
+    /**
+     * @brief Appends a member whose value is already serialized JSON.
+     */
+    template <std::size_t N>
+    void rawField(const char (&key)[N], const QByteArray &json)
+    {
+        appendKey(key);
+        out.append(json);
+    }
+
+    /**
+     * @brief Closes the object.
+     */
+    void finish() { out.append('}'); }
+
+private:
+    template <std::size_t N>
+    void appendKey(const char (&key)[N])
+    {
+        if (!first)
+            out.append(',');
+        first = false;
+        out.append('"').append(key, N - 1).append("\":", 2);
+    }
+
+    void appendString(const QString &value);
+
+    QByteArray &out;   ///< The buffer.
+    bool first = true; ///< No member written yet.
+};
+
+/**
+ * @brief Base of the commands whose "Data" is null.
+ */
+struct NoData
+{
+    static constexpr bool NullData = true;
+    void write(JsonWriter &) const {}
+};
+
+/**
+ * @brief Base of the commands with a "Data" object (possibly empty).
+ */
+struct WithData
+{
+    static constexpr bool NullData = false;
+};
+
+/** @brief Command 0: the printer publishes its attributes. */
+struct GetAttributes : NoData
+{
+    static constexpr int Id = 0;
+    static constexpr const char *Name = "GET_ATTRIBUTES";
+};
+
+/** @brief Command 1: the printer publishes its status. */
+struct GetStatus : NoData
+{
+    static constexpr int Id = 1;
+    static constexpr const char *Name = "GET_STATUS";
+};
+
+/** @brief Command 128: prints a file from the printer's storage. */
+struct StartPrint : WithData
+{
+    static constexpr int Id = 128;
+    static constexpr const char *Name = "START_PRINT";
+    QString filename;
+    int startLayer = 0;
+
+    void write(JsonWriter &w) const
+    {
+        w.field("Filename", filename);
+        w.field("StartLayer", startLayer);
+    }
+};
+
+/** @brief Command 129: pauses the print. */
+struct PausePrint : WithData
+{
+    static constexpr int Id = 129;
+    static constexpr const char *Name = "PAUSE_PRINT";
+    void write(JsonWriter &) const {}
+};
+
+/** @brief Command 130: stops the print. */
+struct StopPrint : WithData
+{
+    static constexpr int Id = 130;
+    static constexpr const char *Name = "STOP_PRINT";
+    void write(JsonWriter &) const {}
+};
+
+/** @brief Command 131: resumes a paused print. */
+struct ResumePrint : WithData
+{
+    static constexpr int Id = 131;
+    static constexpr const char *Name = "RESUME_PRINT";
+    void write(JsonWriter &) const {}
+};
+
+/** @brief Command 256: the printer downloads a file from our HTTP server. */
+struct UploadFile : WithData
+{
+    static constexpr int Id = 256;
+    static constexpr const char *Name = "UPLOAD_FILE";
+    int check = 0;
+    int cleanCache = 1;
+    int compress = 0;
+    qint64 fileSize = 0;
+    QString filename;
+    QString md5;
+    QString url;
+
+    void write(JsonWriter &w) const
+    {
+        w.field("Check", check);
+        w.field("CleanCache", cleanCache);
+        w.field("Compress", compress);
+        w.field("FileSize", fileSize);
+        w.field("Filename", filename);
+        w.field("MD5", md5);
+        w.field("URL", url);
+    }
+};
+
+/** @brief Command 258: the printer publishes the files in a folder. */
+struct GetFileList : WithData
+{
+    static constexpr int Id = 258;
+    static constexpr const char *Name = "GET_FILE_LIST";
+    QString url = "/local";
+
+    void write(JsonWriter &w) const { w.field("Url", url); }
+};
+
+/** @brief Command 259: deletes files and folders from the printer's storage. */
+struct DeleteFiles : WithData
+{
+    static constexpr int Id = 259;
+    static constexpr const char *Name = "DELETE_FILES";
+    QStringList fileList;   ///< Full paths, e.g. "/local/part.goo".
+    QStringList folderList; ///< Full paths of folders.
+
+    void write(JsonWriter &w) const
+    {
+        w.field("FileList", fileList);
+        w.field("FolderList", folderList);
+    }
+};
+
+/** @brief Command 512: sets the period of the status reports. */
+struct SetStatusPeriod : WithData
+{
+    static constexpr int Id = 512;
+    static constexpr const char *Name = "SET_STATUS_PERIOD";
+    int timePeriodMs = 5000;
+
+    void write(JsonWriter &w) const { w.field("TimePeriod", timePeriodMs); }
+};
+
+/**
+ * @brief A set of commands, checked and searched at compile time.
+ */
+template <typename... Commands>
+struct CommandTable
+{
+    static constexpr int Ids[] = {Commands::Id...};
+    static constexpr const char *Names[] = {Commands::Name...};
+
+    /**
+     * @brief True if no two commands share an ID.
+     */
+    static constexpr bool unique()
+    {
+        for (std::size_t i = 0; i < sizeof...(Commands); ++i)
+            for (std::size_t j = i + 1; j < sizeof...(Commands); ++j)
+                if (Ids[i] == Ids[j])
+                    return false;
+        return true;
+    }
+
+    /**
+     * @brief The log name of a command ID, or nullptr if it is not in the table.
+     */
+    static constexpr const char *nameOf(int id)
+    {
+        for (std::size_t i = 0; i < sizeof...(Commands); ++i)
+            if (Ids[i] == id)
+                return Names[i];
+        return nullptr;
+    }
+
+    /**
+     * @brief True if the type is one of the commands.
+     */
+    template <typename Command>
+    static constexpr bool contains() { return (std::is_same_v<Command, Commands> || ...); }
+};
+
+/**
+ * @brief Every command the application sends.
+ */
+using Registry = CommandTable<GetAttributes, GetStatus, StartPrint, PausePrint, StopPrint, ResumePrint,
+                              UploadFile, GetFileList, DeleteFiles, SetStatusPeriod>;
+static_assert(Registry::unique(), "Two SDCP commands share an ID");
+static_assert(Registry::nameOf(StartPrint::Id) != nullptr, "The registry lookup is broken");
+
+/**
+ * @brief Serializes the "Data" member of a command.
+ * @param command The typed payload.
+ * @return The JSON of its data ("null" for commands without data).
+ */
+template <typename Command>
+QByteArray serializeData(const Command &command)
+{
+    static_assert(Registry::contains<Command>(), "Add the command to Sdcp::Registry");
+    if constexpr (Command::NullData)
+    {
+        return QByteArrayLiteral("null");
+    }
+    else
+    {
+        QByteArray out;
+        out.reserve(128);
+        JsonWriter writer(out);
+        command.write(writer);
+        writer.finish();
+        return out;
+    }
+}
+
+/**
+ * @brief Wraps a serialized "Data" member in the SDCP request envelope.
+ * @param cmdId The command ID.
+ * @param data The command's data, from serializeData().
+ * @param mainboardId The printer's mainboard ID.
+ * @param requestId A fresh random request ID.
+ * @param timestampMs Milliseconds since the epoch.
+ * @param id The printer's UUID (or its mainboard ID if the UUID is unknown).
+ * @return The payload of the PUBLISH to "/sdcp/request/<mainboard ID>".
+ */
+QByteArray envelope(int cmdId, const QByteArray &data, const QString &mainboardId, const QString &requestId, qint64 timestampMs, const QString &id);
+}
+
+#endif // SDCPCOMMANDS_H
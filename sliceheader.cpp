@@ -0,0 +1,390 @@
+#include "sliceheader.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QCoreApplication>
+#include <QtEndian>
+#include <cstring>
+
+namespace
+{
+// .goo layout (big endian): fixed header with two RGB565 previews before the print settings
+const qint64 GOO_HEADER_SIZE = 195477;
+const int GOO_SMALL_PREVIEW_SIZE = 116;
+const int GOO_BIG_PREVIEW_SIZE = 290;
+const uchar GOO_MAGIC[8] = {0x07, 0x00, 0x00, 0x00, 0x44, 0x4C, 0x50, 0x00};
+
+// .ctb / .cbddlp layout (little endian): small header pointing at the other sections
+const qint64 CTB_HEADER_SIZE = 112;
+const qint64 CTB_PRINT_PARAMETERS_SIZE = 32;
+const qint64 CTB_PREVIEW_HEADER_SIZE = 32;
+const qint64 CTB_SLICER_INFO_SIZE = 36;
+const quint32 CTB_MAGIC_CBDDLP = 0x12FD0019;
+const quint32 CTB_MAGIC_CTB = 0x12FD0086;
+const quint32 CTB_MAGIC_ENCRYPTED = 0x12FD0107;
+const quint16 CTB_RLE_REPEAT = 0x0020;
+const int MAX_PREVIEW_SIDE = 4096;
+
+/**
+ * @brief Sequential, bounds-checked reader over a memory-mapped header.
+ */
+class HeaderCursor
+{
+public:
+    HeaderCursor(const uchar *data, qint64 size, bool bigEndian)
+        : m_data(data), m_size(size), m_bigEndian(bigEndian) {}
+
+    bool ok() const { return m_ok; }
+
+    const uchar *take(qint64 length)
+    {
+        if (!m_ok || length < 0 || m_pos + length > m_size)
+        {
+            m_ok = false;
+            return nullptr;
+        }
+        const uchar *p = m_data + m_pos;
+        m_pos += length;
+        return p;
+    }
+
+    void skip(qint64 length) { take(length); }
+
+    quint8 u8()
+    {
+        const uchar *p = take(1);
+        return p ? *p : 0;
+    }
+
+    quint16 u16()
+    {
+        const uchar *p = take(2);
+        if (!p) return 0;
+        return m_bigEndian ? qFromBigEndian<quint16>(p) : qFromLittleEndian<quint16>(p);
+    }
+
+    quint32 u32()
+    {
+        const uchar *p = take(4);
+        if (!p) return 0;
+        return m_bigEndian ? qFromBigEndian<quint32>(p) : qFromLittleEndian<quint32>(p);
+    }
+
+    float f32()
+    {
+        quint32 bits = u32();
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    QString str(qint64 length)
+    {
+        const uchar *p = take(length);
+        if (!p) return QString();
+        const char *text = reinterpret_cast<const char *>(p);
+        return QString::fromUtf8(text, qstrnlen(text, length)).trimmed();
+    }
+
+private:
+    const uchar *m_data;
+    qint64 m_size;
+    qint64 m_pos = 0;
+    bool m_bigEndian;
+    bool m_ok = true;
+};
+
+/**
+ * @brief Maps a byte range of the file, checking it lies inside the file.
+ * @return The mapped memory, or nullptr if the range is invalid or mapping failed.
+ */
+uchar *mapRange(QFile &file, qint64 offset, qint64 size)
+{
+    if (offset < 0 || size <= 0 || offset + size > file.size())
+        return nullptr;
+    return file.map(offset, size);
+}
+
+/**
+ * @brief Decodes a raw big-endian RGB565 preview (.goo).
+ */
+QImage decodeRgb565(const uchar *data, int width, int height)
+{
+    QImage image(width, height, QImage::Format_RGB32);
+    for (int y = 0; y < height; ++y)
+    {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < width; ++x)
+        {
+            quint16 dot = qFromBigEndian<quint16>(data + 2 * (y * width + x));
+            line[x] = qRgb(((dot >> 11) & 0x1F) << 3, ((dot >> 5) & 0x3F) << 2, (dot & 0x1F) << 3);
+        }
+    }
+    return image;
+}
+
+/**
+ * @brief Decodes a run-length encoded RGB15 preview (.ctb).
+ * A set 0x0020 bit means the next 16-bit word holds a repeat count in its low 12 bits.
+ */
+QImage decodeCtbRle(const uchar *data, qint64 length, int width, int height)
+{
+    QImage image(width, height, QImage::Format_RGB32);
+    image.fill(Qt::black);
+    QRgb *pixels = reinterpret_cast<QRgb *>(image.bits());
+    const qint64 total = qint64(width) * height;
+
+    qint64 pixel = 0;
+    qint64 i = 0;
+    while (i + 1 < length && pixel < total)
+    {
+        quint16 dot = qFromLittleEndian<quint16>(data + i);
+        i += 2;
+        int repeat = 1;
+        if (dot & CTB_RLE_REPEAT)
+        {
+            if (i + 1 >= length) break;
+            repeat += qFromLittleEndian<quint16>(data + i) & 0x0FFF;
+            i += 2;
+        }
+
+        QRgb color = qRgb(((dot >> 11) & 0x1F) << 3, ((dot >> 6) & 0x1F) << 3, (dot & 0x1F) << 3);
+        for (int r = 0; r < repeat && pixel < total; ++r)
+            pixels[pixel++] = color;
+    }
+    return image;
+}
+
+/**
+ * @brief Parses an Elegoo .goo header (one contiguous block at the start of the file).
+ */
+SliceFileInfo readGoo(QFile &file)
+{
+    SliceFileInfo info;
+    info.format = "GOO";
+
+    uchar *data = mapRange(file, 0, GOO_HEADER_SIZE);
+    if (!data)
+    {
+        info.error = QCoreApplication::translate("SliceFileInfo", "File too small for a .goo header");
+        return info;
+    }
+
+    HeaderCursor c(data, GOO_HEADER_SIZE, true);
+    c.skip(4); // Version
+    const uchar *magic = c.take(sizeof(GOO_MAGIC));
+    if (!magic || std::memcmp(magic, GOO_MAGIC, sizeof(GOO_MAGIC)) != 0)
+    {
+        file.unmap(data);
+        info.error = QCoreApplication::translate("SliceFileInfo", "Not a .goo file");
+        return info;
+    }
+
+    c.skip(32 + 24 + 24);           // Software name, version, creation time
+    info.machineName = c.str(32);
+    c.skip(32 + 32);                // Machine type, resin profile
+    c.skip(3 * 2);                  // Anti-aliasing, grey and blur levels
+    c.skip(GOO_SMALL_PREVIEW_SIZE * GOO_SMALL_PREVIEW_SIZE * 2 + 2);
+    const uchar *bigPreview = c.take(GOO_BIG_PREVIEW_SIZE * GOO_BIG_PREVIEW_SIZE * 2);
+    c.skip(2);                      // Preview delimiter
+
+    info.layerCount = c.u32();
+    c.skip(2 + 2 + 1 + 1);          // Resolution and mirroring
+    c.skip(3 * 4);                  // Display width/height, machine Z
+    info.layerHeightMm = c.f32();
+    info.exposureSeconds = c.f32();
+    c.skip(1);                      // Delay mode
+    c.skip(7 * 4);                  // Light-off delay and wait times
+    info.bottomExposureSeconds = c.f32();
+    info.bottomLayerCount = c.u32();
+    c.skip(16 * 4);                 // Lift and retract heights/speeds
+    c.skip(2 + 2 + 1);              // Light PWM values, per-layer settings flag
+    info.printTimeSeconds = c.u32();
+    info.volumeMl = c.f32();
+    info.weightGrams = c.f32();
+
+    if (c.ok())
+    {
+        info.preview = decodeRgb565(bigPreview, GOO_BIG_PREVIEW_SIZE, GOO_BIG_PREVIEW_SIZE);
+        info.valid = true;
+    }
+    else
+    {
+        info.error = QCoreApplication::translate("SliceFileInfo", "Truncated .goo header");
+    }
+
+    file.unmap(data);
+    return info;
+}
+
+/**
+ * @brief Parses a Chitubox .ctb/.cbddlp header and the sections it points at.
+ */
+SliceFileInfo readCtb(QFile &file)
+{
+    SliceFileInfo info;
+    info.format = "CTB";
+
+    uchar *data = mapRange(file, 0, CTB_HEADER_SIZE);
+    if (!data)
+    {
+        info.error = QCoreApplication::translate("SliceFileInfo", "File too small for a .ctb header");
+        return info;
+    }
+
+    HeaderCursor c(data, CTB_HEADER_SIZE, false);
+    quint32 magic = c.u32();
+    if (magic == CTB_MAGIC_ENCRYPTED)
+    {
+        file.unmap(data);
+        info.error = QCoreApplication::translate("SliceFileInfo", "Encrypted .ctb files are not supported");
+        return info;
+    }
+    if (magic != CTB_MAGIC_CTB && magic != CTB_MAGIC_CBDDLP)
+    {
+        file.unmap(data);
+        info.error = QCoreApplication::translate("SliceFileInfo", "Not a .ctb file");
+        return info;
+    }
+
+    quint32 version = c.u32();
+    c.skip(3 * 4 + 2 * 4 + 4);      // Bed size, reserved, total height
+    info.layerHeightMm = c.f32();
+    info.exposureSeconds = c.f32();
+    info.bottomExposureSeconds = c.f32();
+    c.skip(4);                      // Light-off delay
+    info.bottomLayerCount = c.u32();
+    c.skip(2 * 4);                  // Resolution
+    quint32 previewOffset = c.u32();
+    c.skip(4);                      // Layer table offset
+    info.layerCount = c.u32();
+    c.skip(4);                      // Small preview offset
+    info.printTimeSeconds = c.u32();
+    c.skip(4);                      // Projector type
+    quint32 parametersOffset = c.u32();
+    quint32 parametersSize = c.u32();
+    c.skip(4 + 2 + 2 + 4);          // Anti-aliasing, PWM values, encryption key
+    quint32 slicerOffset = c.u32();
+    quint32 slicerSize = c.u32();
+    file.unmap(data);
+
+    if (!c.ok())
+    {
+        info.error = QCoreApplication::translate("SliceFileInfo", "Truncated .ctb header");
+        return info;
+    }
+    info.valid = true;
+
+    // Print parameters: resin volume and weight (version 2 and later)
+    if (version >= 2 && parametersSize >= CTB_PRINT_PARAMETERS_SIZE)
+    {
+        if (uchar *params = mapRange(file, parametersOffset, CTB_PRINT_PARAMETERS_SIZE))
+        {
+            HeaderCursor p(params, CTB_PRINT_PARAMETERS_SIZE, false);
+            p.skip(5 * 4);          // Bottom/normal lift heights and speeds, retract speed
+            info.volumeMl = p.f32();
+            info.weightGrams = p.f32();
+            file.unmap(params);
+        }
+    }
+
+    // Slicer info: machine name (version 3 and later)
+    if (version >= 3 && slicerSize >= CTB_SLICER_INFO_SIZE)
+    {
+        if (uchar *slicer = mapRange(file, slicerOffset, CTB_SLICER_INFO_SIZE))
+        {
+            HeaderCursor s(slicer, CTB_SLICER_INFO_SIZE, false);
+            s.skip(7 * 4);          // Second-stage lift/retract settings, rest time
+            quint32 nameOffset = s.u32();
+            quint32 nameSize = s.u32();
+            file.unmap(slicer);
+
+            if (nameSize > 0 && nameSize <= 256)
+            {
+                if (uchar *name = mapRange(file, nameOffset, nameSize))
+                {
+                    info.machineName = HeaderCursor(name, nameSize, false).str(nameSize);
+                    file.unmap(name);
+                }
+            }
+        }
+    }
+
+    // Large preview: a small header followed by RLE image data
+    if (uchar *previewHeader = mapRange(file, previewOffset, CTB_PREVIEW_HEADER_SIZE))
+    {
+        HeaderCursor h(previewHeader, CTB_PREVIEW_HEADER_SIZE, false);
+        quint32 width = h.u32();
+        quint32 height = h.u32();
+        quint32 imageOffset = h.u32();
+        quint32 imageLength = h.u32();
+        file.unmap(previewHeader);
+
+        if (width > 0 && height > 0 && width <= MAX_PREVIEW_SIDE && height <= MAX_PREVIEW_SIDE)
+        {
+            if (uchar *image = mapRange(file, imageOffset, imageLength))
+            {
+                info.preview = decodeCtbRle(image, imageLength, width, height);
+                file.unmap(image);
+            }
+        }
+    }
+
+    return info;
+}
+}
+
+/**
+ * @brief Reads the header of a .goo or .ctb file, choosing the parser by extension.
+ * @param filePath The local path of the file.
+ * @return The parsed metadata; `valid` is false if the file is not recognised.
+ */
+SliceFileInfo SliceFileInfo::read(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        SliceFileInfo info;
+        info.error = QCoreApplication::translate("SliceFileInfo", "Cannot open file for reading.");
+        return info;
+    }
+
+    QString suffix = QFileInfo(filePath).suffix().toLower();
+    if (suffix == "goo")
+        return readGoo(file);
+    if (suffix == "ctb" || suffix == "cbddlp")
+        return readCtb(file);
+
+    SliceFileInfo info;
+    info.error = QCoreApplication::translate("SliceFileInfo", "Unsupported file type");
+    return info;
+}
+
+/**
+ * @brief Motion overhead per layer: the slicer's total time minus all exposure time,
+ * spread over every layer. Zero if the header does not contain a total time.
+ */
+double SliceFileInfo::layerOverheadSeconds() const
+{
+    if (!valid || layerCount <= 0 || printTimeSeconds <= 0)
+        return 0;
+
+    int bottom = qMin(bottomLayerCount, layerCount);
+    double exposure = bottom * bottomExposureSeconds + (layerCount - bottom) * exposureSeconds;
+    return qMax(0.0, (printTimeSeconds - exposure) / layerCount);
+}
+
+/**
+ * @brief Expected duration of a bottom layer (exposure plus motion overhead).
+ */
+double SliceFileInfo::bottomLayerSeconds() const
+{
+    return valid && bottomExposureSeconds > 0 ? bottomExposureSeconds + layerOverheadSeconds() : 0;
+}
+
+/**
+ * @brief Expected duration of a normal layer (exposure plus motion overhead).
+ */
+double SliceFileInfo::normalLayerSeconds() const
+{
+    return valid && exposureSeconds > 0 ? exposureSeconds + layerOverheadSeconds() : 0;
+}
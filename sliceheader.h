@@ -0,0 +1,51 @@
+#ifndef SLICEHEADER_H
+#define SLICEHEADER_H
+
+#include <QString>
+#include <QImage>
+
+/**
+ * @brief Metadata read from the header of a sliced .goo or .ctb file.
+ *
+ * Only the header, print parameters and preview image are read (memory-mapped), never
+ * the layer data, so parsing is instant even for multi-GB files.
+ */
+struct SliceFileInfo
+{
+    bool valid = false;             ///< True if the header was recognised and parsed.
+    QString error;                  ///< Why parsing failed, if it did.
+    QString format;                 ///< "GOO" or "CTB".
+    QString machineName;            ///< Printer model the file was sliced for.
+    int layerCount = 0;             ///< Total number of layers.
+    int bottomLayerCount = 0;       ///< Number of bottom layers.
+    double layerHeightMm = 0;       ///< Layer thickness in millimetres.
+    double exposureSeconds = 0;     ///< Exposure time of a normal layer.
+    double bottomExposureSeconds = 0; ///< Exposure time of a bottom layer.
+    int printTimeSeconds = 0;       ///< Print time estimated by the slicer.
+    double volumeMl = 0;            ///< Resin volume in millilitres.
+    double weightGrams = 0;         ///< Resin weight in grams.
+    QImage preview;                 ///< The large preview image, if present.
+
+    /**
+     * @brief Reads the header of a .goo or .ctb file.
+     * @param filePath The local path of the file.
+     * @return The parsed metadata; check `valid` before using it.
+     */
+    static SliceFileInfo read(const QString &filePath);
+
+    /**
+     * @brief Expected duration of a bottom layer, derived from the slicer's total time.
+     * The per-layer motion overhead is the total time minus all exposures, spread evenly.
+     */
+    double bottomLayerSeconds() const;
+
+    /**
+     * @brief Expected duration of a normal layer, derived from the slicer's total time.
+     */
+    double normalLayerSeconds() const;
+
+private:
+    double layerOverheadSeconds() const;
+};
+
+#endif // SLICEHEADER_H
@@ -0,0 +1,84 @@
+#include "startupprofiler.h"
+#include <QEvent>
+#include <QFile>
+#include <QTimer>
+#include <QWidget>
+#include <QWindow>
+#include <QDebug>
+
+StartupProfiler *StartupProfiler::instance = nullptr;
+
+/**
+ * @brief Enables profiling and starts the clock.
+ */
+void StartupProfiler::start()
+{
+    if (instance)
+        return;
+    instance = new StartupProfiler;
+    instance->clock.start();
+}
+
+/**
+ * @brief Records the end of a startup phase. Does nothing unless profiling is enabled.
+ */
+void StartupProfiler::mark(const QString &phase)
+{
+    if (instance)
+        instance->marks.append({phase, instance->clock.elapsed()});
+}
+
+/**
+ * @brief Watches the window's first expose event. The widgets are painted while that
+ * event is handled, so a zero-delay timer queued from it fires after the first frame.
+ */
+void StartupProfiler::reportAtFirstFrame(QWidget *window)
+{
+    if (!instance || !window->windowHandle())
+        return;
+    window->windowHandle()->installEventFilter(instance);
+}
+
+/**
+ * @brief Catches the first expose event of the watched window.
+ */
+bool StartupProfiler::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::Expose)
+    {
+        watched->removeEventFilter(this);
+        QTimer::singleShot(0, this, &StartupProfiler::report);
+    }
+    return false;
+}
+
+/**
+ * @brief Writes the timeline to the log and stops profiling.
+ */
+void StartupProfiler::report()
+{
+    mark("first frame");
+
+    qint64 previous = 0;
+    for (const auto &phase : marks)
+    {
+        qInfo().noquote() << QString("STARTUP: %1 %2 ms (+%3 ms)").arg(phase.first, -16).arg(phase.second, 5).arg(phase.second - previous);
+        previous = phase.second;
+    }
+
+#ifdef Q_OS_LINUX
+    // Resident and peak memory, as reported by the kernel
+    QFile status("/proc/self/status");
+    if (status.open(QIODevice::ReadOnly))
+    {
+        for (const QByteArray &line : status.readAll().split('\n'))
+        {
+            if (line.startsWith("VmRSS:") || line.startsWith("VmHWM:"))
+                qInfo().noquote() << "STARTUP:" << QString::fromLatin1(line.simplified());
+        }
+    }
+#endif
+
+    instance = nullptr;
+    deleteLater();
+}
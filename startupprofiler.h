@@ -0,0 +1,55 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+class QWidget;
+
+/**
+ * @class StartupProfiler
+ * @brief Measures how long the application takes to show its first frame.
+ *
+ * Disabled unless start() is called (main() does so for --profile-startup or when
+ * SATURN_PROFILE_STARTUP is set); every other call is then a no-op. Phases are marked
+ * with mark(), and once the watched window has been painted for the first time the
+ * timeline is written to the log, with the process memory on Linux.
+ */
+class StartupProfiler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Enables profiling and starts the clock. Call as early as possible in main().
+     */
+    static void start();
+
+    /**
+     * @brief Records the end of a startup phase.
+     * @param phase A short name for the phase.
+     */
+    static void mark(const QString &phase);
+
+    /**
+     * @brief Writes the report once the window has been painted for the first time.
+     * @param window The top-level window, already shown.
+     */
+    static void reportAtFirstFrame(QWidget *window);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    StartupProfiler() = default;
+    void report();
+
+    static StartupProfiler *instance;        ///< Non-null while profiling is enabled.
+    QElapsedTimer clock;                     ///< Started in start().
+    QList<QPair<QString, qint64>> marks;     ///< Phase names and their end times in ms.
+};
+
+#endif // STARTUPPROFILER_H
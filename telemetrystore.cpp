@@ -0,0 +1,370 @@
+#include "telemetrystore.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+static_assert(sizeof(TelemetryRecord) == 32 && std::is_trivially_copyable_v<TelemetryRecord>, "TelemetryRecord is stored as raw bytes");
+static_assert(sizeof(TelemetryRollup) == 48 && std::is_trivially_copyable_v<TelemetryRollup>, "TelemetryRollup is stored as raw bytes");
+
+/**
+ * @brief Unmaps and closes the file. The kernel writes the mapped pages back.
+ */
+MappedTable::~MappedTable()
+{
+    if (map)
+        file.unmap(map);
+}
+
+/**
+ * @brief Opens (or creates) the file and maps it.
+ */
+bool MappedTable::open(const QString &path)
+{
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+
+    Header existing{};
+    bool valid = file.size() >= HEADER_SIZE && file.read(reinterpret_cast<char *>(&existing), sizeof(existing)) == sizeof(existing) &&
+                 existing.magic == MAGIC && existing.version == VERSION && existing.recordSize == recordSize;
+    if (!valid)
+    {
+        // New file, or one we cannot read: start over
+        file.resize(0);
+        existing = Header{MAGIC, VERSION, static_cast<quint16>(recordSize), 0};
+        file.seek(0);
+        file.write(reinterpret_cast<const char *>(&existing), sizeof(existing));
+        file.flush(); // The header must be in the file before it is mapped
+    }
+
+    qint64 records = qMax<qint64>((file.size() - HEADER_SIZE) / recordSize, GROW_RECORDS);
+    if (!remap(records))
+        return false;
+    header->count = qMin<quint64>(header->count, capacity); // A truncated file loses its tail, not its head
+    return true;
+}
+
+/**
+ * @brief Appends a record, growing the file if needed.
+ */
+bool MappedTable::append(const void *record)
+{
+    if (!header)
+        return false;
+    if (qint64(header->count) >= capacity && !remap(capacity + GROW_RECORDS))
+        return false;
+
+    // The record is complete before the count makes it visible
+    std::memcpy(slot(header->count), record, recordSize);
+    header->count++;
+    return true;
+}
+
+/**
+ * @brief Removes the oldest records by moving the others to the front.
+ */
+void MappedTable::dropFront(qint64 n)
+{
+    if (!header || n <= 0)
+        return;
+    n = qMin<qint64>(n, header->count);
+    std::memmove(slot(0), slot(n), (header->count - n) * recordSize);
+    header->count -= n;
+}
+
+/**
+ * @brief Resizes the file to hold a number of records and maps it again.
+ */
+bool MappedTable::remap(qint64 records)
+{
+    if (map)
+    {
+        file.unmap(map);
+        map = nullptr;
+        header = nullptr;
+    }
+
+    const qint64 size = HEADER_SIZE + records * recordSize;
+    if (file.size() < size && !file.resize(size))
+        return false;
+    map = file.map(0, size);
+    if (!map)
+        return false;
+    header = reinterpret_cast<Header *>(map);
+    capacity = records;
+    return true;
+}
+
+/**
+ * @brief Closes every series.
+ */
+TelemetryStore::~TelemetryStore()
+{
+    qDeleteAll(series);
+}
+
+/**
+ * @brief Changes the folder of the files and closes the open series.
+ */
+void TelemetryStore::setDirectory(const QString &path)
+{
+    qDeleteAll(series);
+    series.clear();
+    directory = path;
+}
+
+/**
+ * @brief Records a layer report.
+ */
+void TelemetryStore::recordLayer(const QString &printer, qint64 nowMs, int layer, int totalLayers)
+{
+    Series *s = seriesFor(printer);
+    if (!s || layer == s->lastLayer)
+        return;
+
+    TelemetryRecord record;
+    record.timestampMs = nowMs;
+    record.kind = TelemetryRecord::Layer;
+    record.value = layer;
+    record.extra = totalLayers;
+    if (s->lastLayer >= 0 && layer > s->lastLayer)
+    {
+        // Skipped reports are covered by one sample spanning several layers
+        record.count = static_cast<quint16>(qMin(layer - s->lastLayer, 0xFFFF));
+        record.durationMs = qMax<qint64>(0, nowMs - s->lastLayerMs);
+    }
+    s->lastLayer = layer;
+    s->lastLayerMs = nowMs;
+    append(*s, record);
+}
+
+/**
+ * @brief Records a change of state.
+ */
+void TelemetryStore::recordStatus(const QString &printer, qint64 nowMs, int state, bool printing)
+{
+    Series *s = seriesFor(printer);
+    if (!s || state == s->state)
+        return;
+
+    TelemetryRecord record;
+    record.timestampMs = nowMs;
+    record.kind = TelemetryRecord::Status;
+    record.value = state;
+    record.extra = s->state;
+    if (s->state >= 0)
+    {
+        record.count = s->printing ? 1 : 0;
+        record.durationMs = qMax<qint64>(0, nowMs - s->stateSinceMs);
+    }
+    s->state = state;
+    s->printing = printing;
+    s->stateSinceMs = nowMs;
+    if (!printing)
+        s->lastLayer = -1; // A pause would otherwise count as a very long layer
+    append(*s, record);
+}
+
+/**
+ * @brief Records a finished upload.
+ */
+void TelemetryStore::recordTransfer(const QString &printer, qint64 nowMs, qint64 bytes, qint64 durationMs, bool compressed)
+{
+    Series *s = seriesFor(printer);
+    if (!s)
+        return;
+
+    TelemetryRecord record;
+    record.timestampMs = nowMs;
+    record.kind = TelemetryRecord::Transfer;
+    record.count = 1;
+    record.value = compressed ? 1 : 0;
+    record.extra = bytes;
+    record.durationMs = qMax<qint64>(0, durationMs);
+    append(*s, record);
+}
+
+/**
+ * @brief Returns the raw samples in a time range.
+ */
+QList<TelemetryRecord> TelemetryStore::records(const QString &printer, qint64 fromMs, qint64 toMs)
+{
+    QList<TelemetryRecord> result;
+    Series *s = seriesFor(printer);
+    if (!s)
+        return result;
+
+    const TelemetryRecord *begin = reinterpret_cast<const TelemetryRecord *>(s->raw.data());
+    const TelemetryRecord *end = begin + s->raw.count();
+    auto byTime = [](const TelemetryRecord &r, qint64 t)
+    { return r.timestampMs < t; };
+    const TelemetryRecord *first = std::lower_bound(begin, end, fromMs, byTime);
+    const TelemetryRecord *last = std::lower_bound(first, end, toMs, byTime);
+    result.reserve(last - first);
+    for (const TelemetryRecord *r = first; r != last; ++r)
+        result.append(*r);
+    return result;
+}
+
+/**
+ * @brief Returns the hourly rollups whose hour starts in a time range.
+ */
+QList<TelemetryRollup> TelemetryStore::rollups(const QString &printer, qint64 fromMs, qint64 toMs)
+{
+    QList<TelemetryRollup> result;
+    Series *s = seriesFor(printer);
+    if (!s)
+        return result;
+
+    const TelemetryRollup *begin = reinterpret_cast<const TelemetryRollup *>(s->hourly.data());
+    const TelemetryRollup *end = begin + s->hourly.count();
+    auto byTime = [](const TelemetryRollup &r, qint64 t)
+    { return r.hourStartMs < t; };
+    const TelemetryRollup *first = std::lower_bound(begin, end, fromMs, byTime);
+    const TelemetryRollup *last = std::lower_bound(first, end, toMs, byTime);
+    result.reserve(last - first);
+    for (const TelemetryRollup *r = first; r != last; ++r)
+        result.append(*r);
+    return result;
+}
+
+/**
+ * @brief Adds up a time range. Rolled-up samples are gone from the raw log, so the two
+ * sources never count the same sample twice. Only hours wholly inside the range are
+ * taken from the rollups, so a short range is never credited with a whole hour.
+ */
+TelemetrySummary TelemetryStore::summarize(const QString &printer, qint64 fromMs, qint64 toMs)
+{
+    TelemetrySummary summary;
+    summary.spanMs = qMax<qint64>(0, toMs - fromMs);
+
+    for (const TelemetryRollup &hour : rollups(printer, fromMs, toMs - HOUR_MS + 1))
+    {
+        summary.layers += hour.layers;
+        summary.layerMs += hour.layerMs;
+        summary.printingMs += hour.printingMs;
+        summary.transfers += hour.transfers;
+        summary.transferBytes += hour.transferBytes;
+        summary.transferMs += hour.transferMs;
+    }
+
+    for (const TelemetryRecord &record : records(printer, fromMs, toMs))
+    {
+        switch (record.kind)
+        {
+        case TelemetryRecord::Layer:
+            summary.layers += record.count;
+            summary.layerMs += record.durationMs;
+            break;
+        case TelemetryRecord::Status:
+            if (record.count)
+                summary.printingMs += record.durationMs;
+            break;
+        case TelemetryRecord::Transfer:
+            summary.transfers++;
+            summary.transferBytes += record.extra;
+            summary.transferMs += record.durationMs;
+            break;
+        }
+    }
+    return summary;
+}
+
+/**
+ * @brief Returns the series of a printer, opening its files on first use.
+ * @return nullptr if the printer is unknown or its files cannot be mapped.
+ */
+TelemetryStore::Series *TelemetryStore::seriesFor(const QString &printer)
+{
+    if (printer.isEmpty())
+        return nullptr;
+    auto it = series.find(printer);
+    if (it != series.end())
+        return it.value();
+
+    QString dir = (directory.isEmpty() ? QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/telemetry" : directory) + "/";
+    QDir().mkpath(dir);
+    Series *s = new Series;
+    if (!s->raw.open(dir + printer + ".raw") || !s->hourly.open(dir + printer + ".hourly"))
+    {
+        delete s;
+        s = nullptr; // Remembered, so a read-only folder is not retried on every report
+    }
+    series.insert(printer, s);
+    return s;
+}
+
+/**
+ * @brief Appends a sample, keeping the log sorted and within MAX_RECORDS.
+ */
+void TelemetryStore::append(Series &s, TelemetryRecord record)
+{
+    if (s.raw.count() >= MAX_RECORDS)
+        compact(s);
+
+    // The wall clock may step back (NTP); the log must stay sorted for the binary search
+    if (s.raw.count() > 0)
+    {
+        const TelemetryRecord *last = reinterpret_cast<const TelemetryRecord *>(s.raw.data()) + s.raw.count() - 1;
+        record.timestampMs = qMax(record.timestampMs, last->timestampMs);
+    }
+    s.raw.append(&record);
+}
+
+/**
+ * @brief Folds the oldest half of the raw log into the hourly rollups and drops it.
+ */
+void TelemetryStore::compact(Series &s)
+{
+    const qint64 n = s.raw.count() / 2;
+    const TelemetryRecord *records = reinterpret_cast<const TelemetryRecord *>(s.raw.data());
+    for (qint64 i = 0; i < n; ++i)
+        addToRollups(s, records[i]);
+    s.raw.dropFront(n);
+
+    if (s.hourly.count() > MAX_ROLLUP_HOURS)
+        s.hourly.dropFront(s.hourly.count() - MAX_ROLLUP_HOURS);
+}
+
+/**
+ * @brief Adds a sample to the rollup of its hour, which is the last one or a new one.
+ */
+void TelemetryStore::addToRollups(Series &s, const TelemetryRecord &record)
+{
+    const qint64 hourStart = record.timestampMs - record.timestampMs % HOUR_MS;
+    TelemetryRollup *last = nullptr;
+    if (s.hourly.count() > 0)
+    {
+        last = reinterpret_cast<TelemetryRollup *>(s.hourly.data()) + s.hourly.count() - 1;
+        if (last->hourStartMs != hourStart)
+            last = nullptr;
+    }
+    if (!last)
+    {
+        TelemetryRollup hour;
+        hour.hourStartMs = hourStart;
+        if (!s.hourly.append(&hour))
+            return;
+        last = reinterpret_cast<TelemetryRollup *>(s.hourly.data()) + s.hourly.count() - 1;
+    }
+
+    switch (record.kind)
+    {
+    case TelemetryRecord::Layer:
+        last->layers += record.count;
+        last->layerMs += record.durationMs;
+        break;
+    case TelemetryRecord::Status:
+        if (record.count)
+            last->printingMs += record.durationMs;
+        break;
+    case TelemetryRecord::Transfer:
+        last->transfers++;
+        last->transferBytes += record.extra;
+        last->transferMs += record.durationMs;
+        break;
+    }
+}
@@ -0,0 +1,262 @@
+#ifndef TELEMETRYSTORE_H
+#define TELEMETRYSTORE_H
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * @brief One raw telemetry sample. Fixed size, so the log can be mapped as an array.
+ */
+struct TelemetryRecord
+{
+    /**
+     * @brief What the sample describes.
+     */
+    enum Kind : quint16
+    {
+        Layer = 1,    ///< A layer report: value = layer, extra = total layers, count = layers covered.
+        Status = 2,   ///< A state change: value = new state, extra = previous state, count = 1 if it was printing.
+        Transfer = 3  ///< A finished upload: value = 1 if compressed, extra = bytes.
+    };
+
+    qint64 timestampMs = 0; ///< Wall-clock time in milliseconds since the epoch (never decreasing).
+    quint16 kind = 0;       ///< A Kind.
+    quint16 count = 0;      ///< Depends on the kind (see Kind).
+    qint32 value = 0;       ///< Depends on the kind (see Kind).
+    qint64 extra = 0;       ///< Depends on the kind (see Kind).
+    qint64 durationMs = 0;  ///< Time since the previous layer, in the previous state, or spent transferring.
+};
+
+/**
+ * @brief One hour of telemetry, kept after the raw samples are dropped.
+ */
+struct TelemetryRollup
+{
+    qint64 hourStartMs = 0;   ///< Start of the hour, in milliseconds since the epoch.
+    qint32 layers = 0;        ///< Layers printed.
+    qint32 transfers = 0;     ///< Uploads finished.
+    qint64 layerMs = 0;       ///< Time spent on those layers.
+    qint64 printingMs = 0;    ///< Time spent printing (credited to the hour the state ended in).
+    qint64 transferBytes = 0; ///< Bytes uploaded.
+    qint64 transferMs = 0;    ///< Time spent uploading.
+};
+
+/**
+ * @brief Totals over a time range, from the rollups and the raw samples.
+ */
+struct TelemetrySummary
+{
+    qint64 spanMs = 0;        ///< Length of the range.
+    qint64 layers = 0;        ///< Layers printed.
+    qint64 layerMs = 0;       ///< Time spent on those layers.
+    qint64 printingMs = 0;    ///< Time spent printing.
+    qint64 transfers = 0;     ///< Uploads finished.
+    qint64 transferBytes = 0; ///< Bytes uploaded.
+    qint64 transferMs = 0;    ///< Time spent uploading.
+
+    /**
+     * @brief Average layer duration in seconds, or -1 without layers.
+     */
+    double meanLayerSeconds() const { return layers > 0 ? layerMs / 1000.0 / layers : -1; }
+
+    /**
+     * @brief Fraction of the range spent printing, between 0 and 1.
+     */
+    double utilization() const { return spanMs > 0 ? qMin(1.0, double(printingMs) / spanMs) : 0; }
+
+    /**
+     * @brief Average upload rate in bytes per second, or -1 without uploads.
+     */
+    double transferRate() const { return transferMs > 0 ? transferBytes * 1000.0 / transferMs : -1; }
+};
+
+/**
+ * @class MappedTable
+ * @brief An append-only array of fixed-size records in a memory-mapped file.
+ *
+ * The file starts with a small header (magic, version, record size, count) followed by
+ * the records. Appending writes the record into the mapping and then bumps the count,
+ * so a crash never exposes a half-written record. The file grows in steps of
+ * GROW_RECORDS and is never shrunk; dropFront() reuses the space.
+ */
+class MappedTable
+{
+public:
+    /**
+     * @brief Creates a closed table.
+     * @param recordSize Size of one record in bytes.
+     */
+    explicit MappedTable(int recordSize) : recordSize(recordSize) {}
+    ~MappedTable();
+
+    /**
+     * @brief Opens (or creates) the file and maps it. A file written with another
+     * record size or version is started over.
+     * @param path The file.
+     * @return False if the file cannot be opened or mapped.
+     */
+    bool open(const QString &path);
+
+    /**
+     * @brief Returns the number of records.
+     */
+    qint64 count() const { return header ? header->count : 0; }
+
+    /**
+     * @brief Returns the first record; the records are contiguous.
+     */
+    const uchar *data() const { return map ? map + HEADER_SIZE : nullptr; }
+    uchar *data() { return map ? map + HEADER_SIZE : nullptr; }
+
+    /**
+     * @brief Appends a record, growing the file if needed.
+     * @param record recordSize bytes.
+     * @return False if the file could not grow.
+     */
+    bool append(const void *record);
+
+    /**
+     * @brief Removes the oldest records.
+     * @param n Records to remove.
+     */
+    void dropFront(qint64 n);
+
+private:
+    /**
+     * @brief The header at the start of the file.
+     */
+    struct Header
+    {
+        quint32 magic;
+        quint16 version;
+        quint16 recordSize;
+        quint64 count;
+    };
+
+    bool remap(qint64 records);
+    uchar *slot(qint64 index) { return map + HEADER_SIZE + index * recordSize; }
+
+    const int recordSize;     ///< Size of one record.
+    QFile file;               ///< The open file.
+    uchar *map = nullptr;     ///< The whole file, mapped.
+    Header *header = nullptr; ///< The header, at the start of the mapping.
+    qint64 capacity = 0;      ///< Records the file has room for.
+
+    static constexpr quint32 MAGIC = 0x4D4C5453; ///< "STLM".
+    static constexpr quint16 VERSION = 1;
+    static constexpr qint64 HEADER_SIZE = 64;    ///< Keeps the records 8-byte aligned.
+    static constexpr qint64 GROW_RECORDS = 4096;
+};
+
+/**
+ * @class TelemetryStore
+ * @brief Per-printer history of layer timings, state changes and upload rates.
+ *
+ * Each printer (by mainboard ID) has two memory-mapped files in the application data
+ * folder: a raw log of TelemetryRecord and a log of hourly TelemetryRollup. Both are
+ * sorted by time, so a range is found with a binary search. When the raw log reaches
+ * MAX_RECORDS, its oldest half is folded into the rollups and dropped; the rollups keep
+ * MAX_ROLLUP_HOURS. Disk use per printer is thus bounded to a few megabytes.
+ *
+ * Like EtaEstimator, timestamps are passed in explicitly, so a recorded session can be
+ * replayed deterministically. Not thread-safe: the backend uses it from its own thread.
+ */
+class TelemetryStore
+{
+public:
+    ~TelemetryStore();
+
+    /**
+     * @brief Changes the folder of the files, closing the series already open.
+     * @param path The folder; an empty path means "telemetry" in the application data folder.
+     */
+    void setDirectory(const QString &path);
+
+    /**
+     * @brief Records a layer report. The duration is measured from the previous report
+     * of the same print; the first report of a print only marks its start.
+     * @param printer The printer's mainboard ID.
+     * @param nowMs Wall-clock time in milliseconds since the epoch.
+     * @param layer The current layer.
+     * @param totalLayers The layers in the job.
+     */
+    void recordLayer(const QString &printer, qint64 nowMs, int layer, int totalLayers);
+
+    /**
+     * @brief Records a change of state, with the time spent in the previous one.
+     * @param printer The printer's mainboard ID.
+     * @param nowMs Wall-clock time in milliseconds since the epoch.
+     * @param state The new state (a PrinterStatus::State).
+     * @param printing True if the new state is a printing state.
+     */
+    void recordStatus(const QString &printer, qint64 nowMs, int state, bool printing);
+
+    /**
+     * @brief Records a finished upload.
+     * @param printer The printer's mainboard ID.
+     * @param nowMs Wall-clock time in milliseconds since the epoch.
+     * @param bytes Size of the file.
+     * @param durationMs Time from the first request to the printer's confirmation.
+     * @param compressed True if it was sent gzip-encoded.
+     */
+    void recordTransfer(const QString &printer, qint64 nowMs, qint64 bytes, qint64 durationMs, bool compressed);
+
+    /**
+     * @brief Returns the raw samples in a time range.
+     * @param printer The printer's mainboard ID.
+     * @param fromMs Start of the range (inclusive).
+     * @param toMs End of the range (exclusive).
+     */
+    QList<TelemetryRecord> records(const QString &printer, qint64 fromMs, qint64 toMs);
+
+    /**
+     * @brief Returns the hourly rollups whose hour starts in a time range.
+     * @param printer The printer's mainboard ID.
+     * @param fromMs Start of the range (inclusive).
+     * @param toMs End of the range (exclusive).
+     */
+    QList<TelemetryRollup> rollups(const QString &printer, qint64 fromMs, qint64 toMs);
+
+    /**
+     * @brief Adds up a time range, from the rollups for the part already rolled up and
+     * from the raw samples for the rest. Rollups cannot be split, so an hour that is
+     * only partly inside the range is left out: at either end of the range, up to an
+     * hour of rolled-up history may be missed, but never counted beyond spanMs.
+     * @param printer The printer's mainboard ID.
+     * @param fromMs Start of the range (inclusive).
+     * @param toMs End of the range (exclusive).
+     */
+    TelemetrySummary summarize(const QString &printer, qint64 fromMs, qint64 toMs);
+
+private:
+    /**
+     * @brief The files and in-progress state of one printer.
+     */
+    struct Series
+    {
+        MappedTable raw{sizeof(TelemetryRecord)};
+        MappedTable hourly{sizeof(TelemetryRollup)};
+        int lastLayer = -1;      ///< Last layer of the current print (-1 if not printing).
+        qint64 lastLayerMs = 0;  ///< Time of that layer report.
+        int state = -1;          ///< Last recorded state (-1 until the first one).
+        bool printing = false;   ///< That state is a printing state.
+        qint64 stateSinceMs = 0; ///< When the printer entered it.
+    };
+
+    Series *seriesFor(const QString &printer);
+    void append(Series &series, TelemetryRecord record);
+    void compact(Series &series);
+    void addToRollups(Series &series, const TelemetryRecord &record);
+
+    QHash<QString, Series *> series; ///< Open series, by mainboard ID.
+    QString directory;               ///< Folder of the files; empty for the default one.
+
+    const qint64 MAX_RECORDS = 1 << 17;          ///< Raw samples kept per printer (4 MB).
+    const qint64 MAX_ROLLUP_HOURS = 2 * 366 * 24; ///< Hourly rollups kept per printer (two years).
+    const qint64 HOUR_MS = 3600 * 1000;
+};
+
+#endif // TELEMETRYSTORE_H
@@ -0,0 +1,883 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <QUdpSocket>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include "backend.h"
+#include "mqttconnection.h"
+#include "protocol.h"
+
+/**
+ * @file saturnimpair.cpp
+ * @brief Measures SaturnBackend on a degraded network.
+ *
+ * A stand-in printer speaks just enough SDCP over MQTT and HTTP to be invited, receive
+ * an upload and report a print. Its TCP connections to the backend go through a proxy
+ * on the loopback interface that adds latency and jitter, splits the stream into small
+ * segments, caps the bandwidth and resets connections. Invitations are not proxied;
+ * the printer drops the first ones instead, to emulate UDP loss.
+ *
+ * Each scenario reports the time to connect, the upload throughput, the latency of
+ * status reports (printer send to backend signal) and the time to recover from a reset,
+ * so a change to the networking code can be compared before and after.
+ *
+ * The printer uses its own loopback address (127.0.0.2 by default, which Linux routes
+ * without configuration) so it can bind the SDCP port 3000 next to the backend.
+ *
+ * Usage: saturn-impair [--scenario <name>]... [--file-size <MiB>] [--latency <ms>] ...
+ */
+
+namespace
+{
+const int CONNECT_TIMEOUT_MS = 30000; ///< Longest wait for an invitation to be answered.
+const int UPLOAD_TIMEOUT_MS = 180000; ///< Longest wait for an upload, retries included.
+
+/**
+ * @brief What a scenario does to the network.
+ */
+struct Impairment
+{
+    QString name;
+    int latencyMs = 0;          ///< Added one-way delay.
+    int jitterMs = 0;           ///< Random extra delay, up to this much (order is kept, as TCP does).
+    int segmentBytes = 0;       ///< Writes are split into pieces of this size (0 = as read).
+    qint64 rateBytesPerSec = 0; ///< Bandwidth cap per direction (0 = unlimited).
+    int resetEveryMs = 0;       ///< Resets every connection periodically (0 = never).
+    int dropInvites = 0;        ///< Invitations the printer ignores before answering one.
+};
+
+/**
+ * @brief The built-in scenarios.
+ */
+QList<Impairment> presets()
+{
+    QList<Impairment> list;
+    list.append(Impairment{"clean"});
+    list.append(Impairment{"latency", 80, 40});
+    list.append(Impairment{"segmented", 0, 0, 7});
+    list.append(Impairment{"slow", 0, 0, 0, 512 * 1024});
+    list.append(Impairment{"bad-wifi", 40, 60, 536, 1024 * 1024});
+    list.append(Impairment{"flaky", 20, 0, 0, 0, 3000});
+    list.append(Impairment{"lossy-invites", 0, 0, 0, 0, 0, 2});
+    return list;
+}
+
+/**
+ * @class ImpairingProxy
+ * @brief Forwards TCP connections to one backend port through an impairment.
+ *
+ * Every byte read on one side is queued with the time it may leave, and a 1 ms timer
+ * writes what is due. Read buffers are bounded, so a bandwidth cap pushes back on the
+ * sender through TCP instead of piling up here.
+ */
+class ImpairingProxy : public QObject
+{
+public:
+    /**
+     * @brief Starts listening on the loopback interface.
+     * @param impairment The conditions to apply; read on every packet, so they can change.
+     * @param source Address the connections to the backend come from (the printer's).
+     * @param targetPort The backend's port.
+     * @param parent Owner.
+     */
+    ImpairingProxy(const Impairment *impairment, const QHostAddress &source, quint16 targetPort, QObject *parent)
+        : QObject(parent), impairment(impairment), source(source), targetPort(targetPort)
+    {
+        clock.start();
+        timer.setTimerType(Qt::PreciseTimer);
+        timer.setInterval(1);
+        QObject::connect(&timer, &QTimer::timeout, this, [this]()
+                         { pump(); });
+        QObject::connect(&server, &QTcpServer::newConnection, this, [this]()
+                         { onNewConnection(); });
+        server.listen(QHostAddress::LocalHost, 0);
+    }
+
+    ~ImpairingProxy() override { resetAll(); }
+
+    /**
+     * @brief Returns the port the printer connects to instead of the backend's.
+     */
+    quint16 port() const { return server.serverPort(); }
+
+    /**
+     * @brief Aborts every forwarded connection on both sides.
+     */
+    void resetAll()
+    {
+        const QList<Pair *> all = pairs;
+        pairs.clear();
+        for (Pair *pair : all)
+        {
+            pair->printer->abort();
+            pair->backend->abort();
+            pair->printer->deleteLater();
+            pair->backend->deleteLater();
+            delete pair;
+        }
+    }
+
+private:
+    /**
+     * @brief One direction of a connection.
+     */
+    struct Direction
+    {
+        QTcpSocket *from = nullptr;
+        QTcpSocket *to = nullptr;
+        QList<QPair<qint64, QByteArray>> queue; ///< Data and the time it is due.
+        qint64 queuedBytes = 0;
+        qint64 lastDueMs = 0;   ///< Keeps the stream in order.
+        double wireFreeMs = 0;  ///< When the capped link finishes sending what is queued.
+        bool sourceClosed = false;
+    };
+
+    /**
+     * @brief A printer connection and its connection to the backend.
+     */
+    struct Pair
+    {
+        QTcpSocket *printer = nullptr;
+        QTcpSocket *backend = nullptr;
+        Direction up;   ///< Printer to backend.
+        Direction down; ///< Backend to printer.
+    };
+
+    void onNewConnection()
+    {
+        while (QTcpSocket *printer = server.nextPendingConnection())
+        {
+            Pair *pair = new Pair;
+            pair->printer = printer;
+            pair->backend = new QTcpSocket(this);
+            pair->backend->bind(source);
+            pair->up = {printer, pair->backend};
+            pair->down = {pair->backend, printer};
+            for (QTcpSocket *socket : {printer, pair->backend})
+            {
+                socket->setReadBufferSize(READ_BUFFER);
+                socket->setSocketOption(QAbstractSocket::LowDelayOption, 1); // Our segments stay segments
+                QObject::connect(socket, &QTcpSocket::readyRead, this, [this, pair]()
+                                 { readAvailable(pair); });
+                QObject::connect(socket, &QTcpSocket::disconnected, this, [this, pair, socket]()
+                                 { onSideClosed(pair, socket); });
+            }
+            pairs.append(pair);
+            pair->backend->connectToHost(QHostAddress::LocalHost, targetPort);
+        }
+    }
+
+    void readAvailable(Pair *pair)
+    {
+        if (!pairs.contains(pair))
+            return;
+        for (Direction *dir : {&pair->up, &pair->down})
+        {
+            if (dir->queuedBytes >= MAX_QUEUED || dir->from->bytesAvailable() == 0)
+                continue;
+            QByteArray data = dir->from->read(MAX_QUEUED - dir->queuedBytes);
+            qint64 now = clock.elapsed();
+            qint64 due = now + impairment->latencyMs;
+            if (impairment->jitterMs > 0)
+                due += QRandomGenerator::global()->bounded(impairment->jitterMs + 1);
+            due = qMax(due, dir->lastDueMs);
+            if (impairment->rateBytesPerSec > 0)
+            {
+                dir->wireFreeMs = qMax<double>(dir->wireFreeMs, due) + data.size() * 1000.0 / impairment->rateBytesPerSec;
+                due = static_cast<qint64>(dir->wireFreeMs);
+            }
+            dir->lastDueMs = due;
+            dir->queuedBytes += data.size();
+            dir->queue.append({due, data});
+        }
+        if (!timer.isActive())
+            timer.start();
+    }
+
+    void onSideClosed(Pair *pair, QTcpSocket *socket)
+    {
+        if (!pairs.contains(pair))
+            return;
+        // What was already read still gets delivered, then the other side is closed
+        Direction &dir = socket == pair->printer ? pair->up : pair->down;
+        dir.sourceClosed = true;
+        if (!timer.isActive())
+            timer.start();
+    }
+
+    void pump()
+    {
+        const qint64 now = clock.elapsed();
+        bool pending = false;
+        const QList<Pair *> all = pairs;
+        for (Pair *pair : all)
+        {
+            for (Direction *dir : {&pair->up, &pair->down})
+            {
+                // Data for the backend waits while that side is still connecting
+                while (!dir->queue.isEmpty() && dir->queue.first().first <= now && dir->to->state() == QAbstractSocket::ConnectedState)
+                {
+                    QByteArray data = dir->queue.takeFirst().second;
+                    dir->queuedBytes -= data.size();
+                    int piece = impairment->segmentBytes > 0 ? impairment->segmentBytes : data.size();
+                    for (int offset = 0; offset < data.size(); offset += piece)
+                    {
+                        dir->to->write(data.constData() + offset, qMin(piece, int(data.size()) - offset));
+                        dir->to->flush();
+                    }
+                }
+                if (dir->sourceClosed && dir->queue.isEmpty())
+                    dir->to->disconnectFromHost();
+                pending = pending || !dir->queue.isEmpty() || dir->from->bytesAvailable() > 0;
+            }
+            readAvailable(pair); // Room was made: pick up what the bounded buffers held back
+            if (pair->up.sourceClosed && pair->down.sourceClosed)
+            {
+                pairs.removeOne(pair);
+                pair->printer->deleteLater();
+                pair->backend->deleteLater();
+                delete pair;
+            }
+        }
+        if (!pending)
+            timer.stop();
+    }
+
+    const Impairment *impairment;
+    QHostAddress source;
+    quint16 targetPort;
+    QTcpServer server;
+    QList<Pair *> pairs;
+    QTimer timer;
+    QElapsedTimer clock;
+
+    static constexpr qint64 READ_BUFFER = 64 * 1024;
+    static constexpr qint64 MAX_QUEUED = 256 * 1024;
+};
+
+/**
+ * @class StandInPrinter
+ * @brief A minimal SDCP printer: answers invitations and commands, downloads uploads
+ * and publishes status reports.
+ */
+class StandInPrinter : public QObject
+{
+public:
+    /**
+     * @brief Binds the SDCP port on the printer's address.
+     * @param address The printer's address.
+     * @param proxyFor Returns the proxy port for a backend port.
+     * @param parent Owner.
+     */
+    StandInPrinter(const QHostAddress &address, std::function<quint16(quint16)> proxyFor, QObject *parent)
+        : QObject(parent), proxyFor(std::move(proxyFor))
+    {
+        clock.start();
+        udp.bind(address, 3000);
+        QObject::connect(&udp, &QUdpSocket::readyRead, this, [this]()
+                         { onDatagram(); });
+        QObject::connect(&mqtt, &QTcpSocket::connected, this, [this]()
+                         { onMqttConnected(); });
+        QObject::connect(&mqtt, &QTcpSocket::readyRead, this, [this]()
+                         { onMqttData(); });
+        QObject::connect(&http, &QTcpSocket::connected, this, [this]()
+                         { onHttpConnected(); });
+        QObject::connect(&http, &QTcpSocket::readyRead, this, [this]()
+                         { onHttpData(); });
+        QObject::connect(&http, &QTcpSocket::disconnected, this, [this]()
+                         { onHttpClosed(); });
+        statusTimer.setInterval(STATUS_PERIOD_MS);
+        QObject::connect(&statusTimer, &QTimer::timeout, this, [this]()
+                         { publishStatus(); });
+    }
+
+    bool isBound() const { return udp.state() == QAbstractSocket::BoundState; }
+    void setDroppedInvites(int n) { invitesToDrop = n; }
+
+    /**
+     * @brief Reports a print, one layer per status report.
+     */
+    void startPrinting(int totalLayers)
+    {
+        printLayer = 0;
+        printTotal = totalLayers;
+        layerSentMs.clear();
+    }
+
+    /**
+     * @brief Goes back to idle.
+     */
+    void stopPrinting() { printTotal = 0; }
+
+    /**
+     * @brief Returns when a layer was first reported (-1 if never).
+     */
+    qint64 layerSent(int layer) const { return layerSentMs.value(layer, -1); }
+    int layersSent() const { return layerSentMs.size(); }
+
+    qint64 downloadDoneMs = -1;  ///< When the last download completed.
+    qint64 downloadedBytes = 0;  ///< Its size.
+    bool downloadOk = false;     ///< It matched the announced size and MD5.
+    int downloadAttempts = 0;    ///< GET requests made for it.
+    QElapsedTimer clock;         ///< Shared time base for the measurements.
+
+private:
+    void onDatagram()
+    {
+        while (udp.hasPendingDatagrams())
+        {
+            QByteArray datagram(udp.pendingDatagramSize(), '\0');
+            udp.readDatagram(datagram.data(), datagram.size());
+            if (!datagram.startsWith("M66666 "))
+                continue;
+            if (invitesToDrop > 0)
+            {
+                invitesToDrop--;
+                continue;
+            }
+            if (mqtt.state() != QAbstractSocket::UnconnectedState)
+                continue;
+            quint16 port = static_cast<quint16>(datagram.mid(7).trimmed().toUInt());
+            mqttBuffer.clear();
+            mqtt.connectToHost(QHostAddress::LocalHost, proxyFor(port));
+        }
+    }
+
+    void onMqttConnected()
+    {
+        QByteArray clientId = "impair-" + QByteArray(MAINBOARD);
+        QByteArray hello = QByteArray::fromHex("00044d5154540402003c"); // "MQTT", level 4, clean session, 60 s keep-alive
+        hello.append(char(clientId.size() >> 8)).append(char(clientId.size() & 0xFF)).append(clientId);
+        sendPacket(MQTT_CONNECT << 4, hello);
+
+        QByteArray topic = "/sdcp/request/" + QByteArray(MAINBOARD);
+        QByteArray subscribe = QByteArray::fromHex("0001");
+        subscribe.append(char(topic.size() >> 8)).append(char(topic.size() & 0xFF)).append(topic).append(char(0));
+        sendPacket(MQTT_SUBSCRIBE << 4 | 0x02, subscribe);
+        statusTimer.start();
+    }
+
+    void onMqttData()
+    {
+        mqttBuffer.append(mqtt.readAll());
+        while (mqttBuffer.size() >= 2)
+        {
+            int headerSize = 0;
+            int length = MqttConnection::frameLength(mqttBuffer, 0, headerSize);
+            if (length == -2)
+            {
+                mqtt.abort();
+                return;
+            }
+            if (length < 0 || mqttBuffer.size() < headerSize + length)
+                return;
+
+            int type = (uint8_t)mqttBuffer[0] >> 4;
+            int flags = (uint8_t)mqttBuffer[0] & 0x0F;
+            QByteArray payload = mqttBuffer.mid(headerSize, length);
+            mqttBuffer.remove(0, headerSize + length);
+
+            QString topic;
+            int packetId = 0;
+            QByteArray json;
+            if (type != MQTT_PUBLISH || !MqttConnection::splitPublish(flags, payload, topic, packetId, json))
+                continue;
+            if (packetId > 0)
+                sendPacket(MQTT_PUBACK << 4, QByteArray().append(char(packetId >> 8)).append(char(packetId & 0xFF)));
+            onRequest(QJsonDocument::fromJson(json).object().value("Data").toObject());
+        }
+    }
+
+    void onRequest(const QJsonObject &request)
+    {
+        const int cmd = request["Cmd"].toInt();
+        QJsonObject ack{{"Ack", 0}};
+        QJsonObject data{{"Cmd", cmd}, {"Data", ack}, {"MainboardID", MAINBOARD}, {"RequestID", request["RequestID"]}};
+        publish("/sdcp/response/" + QByteArray(MAINBOARD), QJsonObject{{"Data", data}, {"Id", MAINBOARD}});
+
+        if (cmd == Sdcp::UploadFile::Id)
+        {
+            const QJsonObject upload = request["Data"].toObject();
+            QRegularExpressionMatch match = QRegularExpression(":(\\d+)(/.*)$").match(upload["URL"].toString());
+            if (!match.hasMatch())
+                return;
+            downloadPort = proxyFor(static_cast<quint16>(match.captured(1).toUInt()));
+            downloadPath = match.captured(2).toUtf8();
+            downloadFilename = upload["Filename"].toString();
+            expectedSize = static_cast<qint64>(upload["FileSize"].toDouble());
+            expectedMd5 = upload["MD5"].toString().toLower().toUtf8();
+            downloadAttempts = 0;
+            downloadDoneMs = -1;
+            downloadOk = false;
+            startDownload();
+        }
+    }
+
+    void startDownload()
+    {
+        downloading = false; // The previous attempt's close must not schedule a retry
+        http.abort();
+        downloadAttempts++;
+        downloading = true;
+        headerDone = false;
+        bodyReceived = 0;
+        bodyLength = -1;
+        httpBuffer.clear();
+        md5.reset();
+        http.connectToHost(QHostAddress::LocalHost, downloadPort);
+    }
+
+    void onHttpConnected()
+    {
+        http.write("GET " + downloadPath + " HTTP/1.1\r\nHost: printer\r\nConnection: close\r\n\r\n");
+    }
+
+    void onHttpData()
+    {
+        QByteArray data = http.readAll();
+        if (!headerDone)
+        {
+            httpBuffer.append(data);
+            int end = httpBuffer.indexOf("\r\n\r\n");
+            if (end < 0)
+                return;
+            QByteArray header = httpBuffer.left(end);
+            data = httpBuffer.mid(end + 4);
+            httpBuffer.clear();
+            headerDone = true;
+            if (!header.startsWith("HTTP/1.1 200"))
+            {
+                headerDone = false; // Retried like a cut-off download
+                http.abort();
+                return;
+            }
+            QRegularExpressionMatch length = QRegularExpression("(?i)content-length:\\s*(\\d+)").match(QString::fromLatin1(header));
+            bodyLength = length.hasMatch() ? length.captured(1).toLongLong() : -1;
+        }
+        bodyReceived += data.size();
+        md5.addData(data);
+        if (bodyLength >= 0 && bodyReceived >= bodyLength)
+            finishDownload();
+    }
+
+    void onHttpClosed()
+    {
+        if (!downloading)
+            return;
+        if (headerDone && bodyLength < 0)
+        {
+            finishDownload(); // Body delimited by the end of the connection
+            return;
+        }
+        // Cut off (reset, timeout): start over, as the printer firmware does
+        if (downloadAttempts < MAX_DOWNLOAD_ATTEMPTS)
+            QTimer::singleShot(RETRY_DELAY_MS, this, [this]()
+                               { startDownload(); });
+        else
+        {
+            downloading = false;
+            downloadDoneMs = clock.elapsed();
+            downloadOk = false;
+        }
+    }
+
+    void finishDownload()
+    {
+        downloading = false;
+        downloadDoneMs = clock.elapsed();
+        downloadedBytes = bodyReceived;
+        downloadOk = bodyReceived == expectedSize && md5.result().toHex() == expectedMd5;
+        http.disconnectFromHost();
+        publishStatus(); // Report the end of the transfer at once
+    }
+
+    void publishStatus()
+    {
+        if (mqtt.state() != QAbstractSocket::ConnectedState)
+        {
+            statusTimer.stop();
+            return;
+        }
+
+        QJsonObject transfer{{"Status", 0}, {"DownloadOffset", 0}, {"FileTotalSize", expectedSize}, {"Filename", downloadFilename}};
+        QJsonObject print{{"Status", 0}, {"CurrentLayer", 0}, {"TotalLayer", 0}, {"Filename", downloadFilename}};
+        int current = 0;
+        if (downloading)
+        {
+            current = 1;
+            transfer["Status"] = 1;
+            transfer["DownloadOffset"] = double(bodyReceived);
+        }
+        else if (printTotal > 0 && printLayer < printTotal)
+        {
+            current = 1;
+            printLayer++;
+            print["Status"] = static_cast<int>(PrintStatus::EXPOSURE);
+            print["CurrentLayer"] = printLayer;
+            print["TotalLayer"] = printTotal;
+            if (!layerSentMs.contains(printLayer))
+                layerSentMs.insert(printLayer, clock.elapsed());
+        }
+        else if (downloadDoneMs >= 0)
+        {
+            transfer["Status"] = downloadOk ? 2 : 3;
+        }
+
+        QJsonObject status{{"CurrentStatus", current}, {"PrintInfo", print}, {"FileTransferInfo", transfer}};
+        QJsonObject data{{"Status", status}, {"MainboardID", MAINBOARD}, {"TimeStamp", QDateTime::currentSecsSinceEpoch()}};
+        publish("/sdcp/status/" + QByteArray(MAINBOARD), QJsonObject{{"Data", data}, {"Id", MAINBOARD}});
+    }
+
+    void publish(const QByteArray &topic, const QJsonObject &message)
+    {
+        QByteArray packet;
+        packet.append(char(topic.size() >> 8)).append(char(topic.size() & 0xFF)).append(topic);
+        packet.append(QJsonDocument(message).toJson(QJsonDocument::Compact));
+        sendPacket(MQTT_PUBLISH << 4, packet); // QoS 0
+    }
+
+    void sendPacket(int firstByte, const QByteArray &body)
+    {
+        QByteArray packet(1, char(firstByte));
+        int length = body.size();
+        do
+        {
+            char digit = char(length % 128);
+            length /= 128;
+            if (length > 0)
+                digit |= char(0x80);
+            packet.append(digit);
+        } while (length > 0);
+        packet.append(body);
+        mqtt.write(packet);
+    }
+
+    std::function<quint16(quint16)> proxyFor;
+    QUdpSocket udp;
+    QTcpSocket mqtt;
+    QTcpSocket http;
+    QTimer statusTimer;
+    QByteArray mqttBuffer;
+    int invitesToDrop = 0;
+
+    // Download
+    quint16 downloadPort = 0;
+    QByteArray downloadPath;
+    QString downloadFilename;
+    qint64 expectedSize = 0;
+    QByteArray expectedMd5;
+    QCryptographicHash md5{QCryptographicHash::Md5};
+    QByteArray httpBuffer;
+    bool downloading = false;
+    bool headerDone = false;
+    qint64 bodyLength = -1;
+    qint64 bodyReceived = 0;
+
+    // Print
+    int printLayer = 0;
+    int printTotal = 0;
+    QHash<int, qint64> layerSentMs;
+
+    static constexpr const char *MAINBOARD = "IMPAIR0000000001";
+    static constexpr int STATUS_PERIOD_MS = 250;
+    static constexpr int MAX_DOWNLOAD_ATTEMPTS = 5;
+    static constexpr int RETRY_DELAY_MS = 500;
+};
+
+/**
+ * @brief What one scenario measured.
+ */
+struct Result
+{
+    qint64 connectMs = -1;
+    double uploadMBps = -1;
+    int uploadAttempts = 0;
+    bool uploadOk = false;
+    QList<qint64> statusLatencyMs;
+    int layersSent = 0;
+    qint64 recoveryMs = -1;
+    int resets = 0;
+};
+
+/**
+ * @brief Runs the event loop until a condition holds or a timeout expires.
+ * @return True if the condition held.
+ */
+bool waitFor(const std::function<bool()> &done, int timeoutMs)
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+    QEventLoop loop;
+    QTimer poll;
+    QObject::connect(&poll, &QTimer::timeout, &loop, [&]()
+                     {
+        if (done() || elapsed.elapsed() >= timeoutMs)
+            loop.quit(); });
+    poll.start(5);
+    if (!done())
+        loop.exec();
+    return done();
+}
+
+/**
+ * @brief Formats a latency percentile, or "-" without samples.
+ */
+QString percentile(QList<qint64> samples, double p)
+{
+    if (samples.isEmpty())
+        return "-";
+    std::sort(samples.begin(), samples.end());
+    return QString::number(samples[qMin<int>(samples.size() - 1, int(p * samples.size()))]);
+}
+}
+
+/**
+ * @brief Entry point of the impairment harness.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("saturn-impair");
+    QStandardPaths::setTestModeEnabled(true); // Keep the printer cache and telemetry out of the user's data
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the backend through a proxy that degrades the network.");
+    parser.addHelpOption();
+    parser.addOption({"scenario", "Run this built-in scenario (repeatable; default: all).", "name"});
+    parser.addOption({"list", "List the built-in scenarios."});
+    parser.addOption({"latency", "Custom scenario: one-way delay.", "ms"});
+    parser.addOption({"jitter", "Custom scenario: random extra delay.", "ms"});
+    parser.addOption({"segment", "Custom scenario: split writes into pieces of this size.", "bytes"});
+    parser.addOption({"rate", "Custom scenario: bandwidth cap per direction.", "KB/s"});
+    parser.addOption({"reset-every", "Custom scenario: reset every connection periodically.", "ms"});
+    parser.addOption({"drop-invites", "Custom scenario: invitations to ignore.", "count"});
+    parser.addOption({"file-size", "Size of the uploaded file (default 4).", "MiB", "4"});
+    parser.addOption({"status-seconds", "How long to measure status latency (default 5).", "s", "5"});
+    parser.addOption({"printer-address", "Loopback address of the stand-in printer.", "address", "127.0.0.2"});
+    parser.addOption({"verbose", "Print the backend's log messages."});
+    parser.process(app);
+
+    QList<Impairment> scenarios;
+    if (parser.isSet("list"))
+    {
+        for (const Impairment &i : presets())
+            out << QString("%1 latency %2 ms, jitter %3 ms, segment %4 B, rate %5 KB/s, reset every %6 ms, drop %7 invites")
+                       .arg(i.name, -14).arg(i.latencyMs).arg(i.jitterMs).arg(i.segmentBytes).arg(i.rateBytesPerSec / 1024).arg(i.resetEveryMs).arg(i.dropInvites)
+                << Qt::endl;
+        return 0;
+    }
+    for (const QString &name : parser.values("scenario"))
+    {
+        auto all = presets();
+        auto it = std::find_if(all.begin(), all.end(), [&](const Impairment &i)
+                               { return i.name == name; });
+        if (it == all.end())
+        {
+            QTextStream(stderr) << "Unknown scenario: " << name << Qt::endl;
+            return 1;
+        }
+        scenarios.append(*it);
+    }
+    const QStringList customOptions = {"latency", "jitter", "segment", "rate", "reset-every", "drop-invites"};
+    if (std::any_of(customOptions.begin(), customOptions.end(), [&](const QString &o)
+                    { return parser.isSet(o); }))
+    {
+        Impairment custom{"custom"};
+        custom.latencyMs = parser.value("latency").toInt();
+        custom.jitterMs = parser.value("jitter").toInt();
+        custom.segmentBytes = parser.value("segment").toInt();
+        custom.rateBytesPerSec = parser.value("rate").toLongLong() * 1024;
+        custom.resetEveryMs = parser.value("reset-every").toInt();
+        custom.dropInvites = parser.value("drop-invites").toInt();
+        scenarios.append(custom);
+    }
+    if (scenarios.isEmpty())
+        scenarios = presets();
+
+    const QString printerIp = parser.value("printer-address");
+    const qint64 fileBytes = parser.value("file-size").toLongLong() * 1024 * 1024;
+    const int statusLayers = parser.value("status-seconds").toInt() * 4; // One layer per 250 ms report
+    QTemporaryDir tempDir;
+
+    // The backend runs on its own thread, as in the application
+    QThread ioThread;
+    SaturnBackend *backend = new SaturnBackend;
+    backend->moveToThread(&ioThread);
+    QObject::connect(&ioThread, &QThread::finished, backend, &QObject::deleteLater);
+    ioThread.start();
+    if (parser.isSet("verbose"))
+        QObject::connect(backend, &SaturnBackend::logMessage, &app, [&out](QString msg)
+                         { out << "LOG: " << msg << Qt::endl; });
+
+    Impairment current;
+    QHash<quint16, ImpairingProxy *> proxies;
+    auto proxyFor = [&](quint16 backendPort) -> quint16
+    {
+        ImpairingProxy *&proxy = proxies[backendPort];
+        if (!proxy)
+            proxy = new ImpairingProxy(&current, QHostAddress(printerIp), backendPort, &app);
+        return proxy->port();
+    };
+    StandInPrinter printer(QHostAddress(printerIp), proxyFor, &app);
+    if (!printer.isBound())
+    {
+        QTextStream(stderr) << "Cannot bind " << printerIp << ":3000 for the stand-in printer." << Qt::endl;
+        ioThread.quit();
+        ioThread.wait();
+        return 1;
+    }
+    auto resetAll = [&]()
+    {
+        for (ImpairingProxy *proxy : std::as_const(proxies))
+            proxy->resetAll();
+    };
+
+    qint64 connectedAtMs = -1;
+    QObject::connect(backend, &SaturnBackend::printerConnected, &app, [&](QString ip, qint64)
+                     {
+        if (ip == printerIp)
+            connectedAtMs = printer.clock.elapsed(); });
+    QHash<int, qint64> layerSeenMs;
+    QObject::connect(backend, &SaturnBackend::printerProgress, &app, [&](QString ip, int layer, int, int)
+                     {
+        if (ip == printerIp && !layerSeenMs.contains(layer))
+            layerSeenMs.insert(layer, printer.clock.elapsed()); });
+
+    out << QString("%1 %2 %3 %4 %5 %6 %7")
+               .arg(QString("scenario"), -14)
+               .arg(QString("connect ms"), 11)
+               .arg(QString("upload MB/s"), 12)
+               .arg(QString("status avg/p95/max ms"), 22)
+               .arg(QString("lost"), 5)
+               .arg(QString("recovery ms"), 12)
+               .arg(QString("resets"), 7)
+        << Qt::endl;
+
+    bool allOk = true;
+    for (const Impairment &scenario : scenarios)
+    {
+        current = scenario;
+        printer.setDroppedInvites(scenario.dropInvites);
+        Result result;
+
+        // Periodic resets run for the whole scenario, except the final recovery measurement
+        QTimer resetTimer;
+        QObject::connect(&resetTimer, &QTimer::timeout, &app, [&]()
+                         {
+            resetAll();
+            result.resets++; });
+
+        // 1. Connect from scratch under the new conditions
+        resetAll();
+        connectedAtMs = -1;
+        qint64 start = printer.clock.elapsed();
+        QMetaObject::invokeMethod(backend, [backend, printerIp]()
+                                  { backend->connectToPrinter(printerIp); });
+        if (waitFor([&]()
+                    { return connectedAtMs >= 0; },
+                    CONNECT_TIMEOUT_MS))
+            result.connectMs = connectedAtMs - start;
+        if (scenario.resetEveryMs > 0)
+            resetTimer.start(scenario.resetEveryMs);
+
+        // 2. Upload a fresh file (new content, so the inventory cannot skip it)
+        QString path = tempDir.filePath(QString("impair-%1.goo").arg(scenario.name));
+        QFile file(path);
+        if (file.open(QIODevice::WriteOnly))
+        {
+            QByteArray block(1024 * 1024, 0);
+            for (qint64 written = 0; written < fileBytes; written += block.size())
+            {
+                QRandomGenerator::global()->fillRange(reinterpret_cast<quint32 *>(block.data()), block.size() / 4);
+                file.write(block.constData(), qMin<qint64>(block.size(), fileBytes - written));
+            }
+            file.close();
+        }
+        printer.downloadDoneMs = -1;
+        start = printer.clock.elapsed();
+        QMetaObject::invokeMethod(backend, [backend, printerIp, path]()
+                                  { backend->uploadAndPrint(printerIp, path, false); });
+        if (waitFor([&]()
+                    { return printer.downloadDoneMs >= 0; },
+                    UPLOAD_TIMEOUT_MS))
+        {
+            result.uploadOk = printer.downloadOk;
+            if (printer.downloadOk)
+                result.uploadMBps = printer.downloadedBytes / 1048576.0 / qMax<qint64>(1, printer.downloadDoneMs - start) * 1000.0;
+        }
+        result.uploadAttempts = printer.downloadAttempts;
+
+        // 3. Status latency: one layer per report, from send to the backend's signal
+        layerSeenMs.clear();
+        printer.startPrinting(statusLayers);
+        waitFor([&]()
+                { return printer.layersSent() >= statusLayers; },
+                statusLayers * 250 + 10000);
+        waitFor([&]()
+                { return layerSeenMs.contains(statusLayers); },
+                2000); // Let the last reports arrive
+        printer.stopPrinting();
+        result.layersSent = printer.layersSent();
+        for (auto it = layerSeenMs.cbegin(); it != layerSeenMs.cend(); ++it)
+        {
+            qint64 sent = printer.layerSent(it.key());
+            if (sent >= 0)
+                result.statusLatencyMs.append(it.value() - sent);
+        }
+
+        // 4. Recovery: drop every connection and wait for the printer to be back
+        resetTimer.stop();
+        connectedAtMs = -1;
+        start = printer.clock.elapsed();
+        resetAll();
+        result.resets++;
+        if (waitFor([&]()
+                    { return connectedAtMs >= 0; },
+                    CONNECT_TIMEOUT_MS))
+            result.recoveryMs = connectedAtMs - start;
+
+        qint64 total = 0;
+        for (qint64 l : result.statusLatencyMs)
+            total += l;
+        QString latency = result.statusLatencyMs.isEmpty()
+                              ? QString("-")
+                              : QString("%1/%2/%3").arg(total / result.statusLatencyMs.size()).arg(percentile(result.statusLatencyMs, 0.95)).arg(percentile(result.statusLatencyMs, 1.0));
+        QString upload = result.uploadOk ? QString::number(result.uploadMBps, 'f', 2) : QString("FAILED");
+        if (result.uploadAttempts > 1)
+            upload += QString(" (%1x)").arg(result.uploadAttempts);
+        out << QString("%1 %2 %3 %4 %5 %6 %7")
+                   .arg(scenario.name, -14)
+                   .arg(result.connectMs < 0 ? QString("TIMEOUT") : QString::number(result.connectMs), 11)
+                   .arg(upload, 12)
+                   .arg(latency, 22)
+                   .arg(result.layersSent - result.statusLatencyMs.size(), 5)
+                   .arg(result.recoveryMs < 0 ? QString("TIMEOUT") : QString::number(result.recoveryMs), 12)
+                   .arg(result.resets, 7)
+            << Qt::endl;
+        allOk = allOk && result.connectMs >= 0 && result.uploadOk && result.recoveryMs >= 0;
+    }
+
+    resetAll();
+    ioThread.quit();
+    ioThread.wait();
+    return allOk ? 0 : 2;
+}
@@ -0,0 +1,206 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+#include <functional>
+#include "backend.h"
+#include "mqttconnection.h"
+#include "protocol.h"
+#include "trafficrecorder.h"
+
+/**
+ * @file saturnreplay.cpp
+ * @brief Replays a traffic capture through SaturnBackend.
+ *
+ * Every MQTT PUBLISH a printer sent is decoded and applied with replayPublish(), at the
+ * pace it was recorded or as fast as possible. The backend sees the captured times and
+ * an empty telemetry history, so the status changes it derives (printed below, followed
+ * by decode and processing times) are the same on every run. A capture from the farm
+ * thus doubles as a reproducible profiling run and a regression trace.
+ *
+ * Usage: saturn-replay [--max-speed] [--ip <address>] [--verbose] <capture>
+ */
+
+namespace
+{
+/**
+ * @brief A recorded PUBLISH, ready to be applied.
+ */
+struct Message
+{
+    quint64 timestampNs = 0;
+    QString ip;
+    QString topic;
+    QByteArray json;
+};
+
+/**
+ * @brief Accumulated timings of one processing step.
+ */
+struct Timing
+{
+    qint64 count = 0;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+
+    void add(qint64 ns)
+    {
+        count++;
+        totalNs += ns;
+        maxNs = qMax(maxNs, ns);
+    }
+};
+
+/**
+ * @brief Extracts the PUBLISH packets printers sent from a capture.
+ */
+QList<Message> publishedMessages(const QList<TrafficRecord> &records, const QString &onlyIp)
+{
+    QList<Message> messages;
+    for (const TrafficRecord &record : records)
+    {
+        if (record.kind != TrafficRecord::MqttIn || (!onlyIp.isEmpty() && record.ip != onlyIp))
+            continue;
+
+        int headerSize = 0;
+        int length = MqttConnection::frameLength(record.data, 0, headerSize);
+        if (length < 0 || headerSize + length > record.data.size())
+            continue;
+
+        int type = (uint8_t)record.data[0] >> 4;
+        int flags = (uint8_t)record.data[0] & 0x0F;
+        if (type != MQTT_PUBLISH)
+            continue;
+
+        Message message;
+        int packetId = 0;
+        if (!MqttConnection::splitPublish(flags, record.data.mid(headerSize, length), message.topic, packetId, message.json))
+            continue;
+        message.timestampNs = record.timestampNs;
+        message.ip = record.ip;
+        messages.append(message);
+    }
+    return messages;
+}
+
+/**
+ * @brief Formats a timing line for the summary.
+ */
+QString timingLine(const QString &name, const Timing &timing)
+{
+    double avgUs = timing.count ? timing.totalNs / 1000.0 / timing.count : 0;
+    return QString("%1 total %2 ms, avg %3 us, max %4 us")
+        .arg(name, -10)
+        .arg(timing.totalNs / 1e6, 0, 'f', 1)
+        .arg(avgUs, 0, 'f', 1)
+        .arg(timing.maxNs / 1000.0, 0, 'f', 1);
+}
+}
+
+/**
+ * @brief Entry point of the replay tool.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a printer traffic capture through the backend.");
+    parser.addHelpOption();
+    parser.addOption({"max-speed", "Replay as fast as possible instead of at the recorded pace."});
+    parser.addOption({"ip", "Only replay the printer with this address.", "address"});
+    parser.addOption({"verbose", "Print the backend's log messages."});
+    parser.addPositionalArgument("capture", "Capture file written with SATURN_CAPTURE.");
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    QList<TrafficRecord> records;
+    QString error;
+    if (!TrafficRecorder::load(parser.positionalArguments().first(), records, error))
+    {
+        QTextStream(stderr) << "Cannot read capture: " << error << Qt::endl;
+        return 1;
+    }
+
+    const QList<Message> messages = publishedMessages(records, parser.value("ip"));
+    out << records.size() << " records, " << messages.size() << " printer messages to replay" << Qt::endl;
+    if (messages.isEmpty())
+        return 0;
+
+    // History from earlier runs (or from the real application) would change the estimates
+    QTemporaryDir telemetryDir;
+    SaturnBackend backend;
+    backend.setTelemetryDirectory(telemetryDir.path());
+    const quint64 firstNs = messages.first().timestampNs;
+    quint64 currentNs = firstNs;
+
+    QObject::connect(&backend, &SaturnBackend::printerStatusChanged, &app, [&out, &currentNs, firstNs](QString ip, PrinterStatus status, PrinterStatus::Fields)
+                     {
+        out << QString("%1 s  %2  state %3  layer %4/%5  eta %6 s")
+                   .arg((currentNs - firstNs) / 1e9, 9, 'f', 3)
+                   .arg(ip, -15)
+                   .arg(static_cast<int>(status.state), 2)
+                   .arg(status.layer)
+                   .arg(status.totalLayers)
+                   .arg(status.remainingSeconds)
+            << Qt::endl; });
+    if (parser.isSet("verbose"))
+        QObject::connect(&backend, &SaturnBackend::logMessage, &app, [&out](QString msg)
+                         { out << "LOG: " << msg << Qt::endl; });
+
+    Timing decode;
+    Timing process;
+    QElapsedTimer wall;
+    QElapsedTimer step;
+    wall.start();
+
+    auto apply = [&](const Message &message)
+    {
+        currentNs = message.timestampNs;
+        step.start();
+        QJsonObject root = QJsonDocument::fromJson(message.json).object();
+        decode.add(step.nsecsElapsed());
+        step.start();
+        backend.replayPublish(message.ip, message.topic, root, message.timestampNs);
+        process.add(step.nsecsElapsed());
+    };
+
+    if (parser.isSet("max-speed"))
+    {
+        for (const Message &message : messages)
+            apply(message);
+    }
+    else
+    {
+        // Each message is scheduled relative to the first, at the recorded pace
+        int next = 0;
+        std::function<void()> scheduleNext = [&]()
+        {
+            if (next >= messages.size())
+            {
+                app.quit();
+                return;
+            }
+            qint64 dueMs = static_cast<qint64>((messages[next].timestampNs - firstNs) / 1000000);
+            QTimer::singleShot(static_cast<int>(qMax<qint64>(0, dueMs - wall.elapsed())), &app, [&]()
+                               {
+                apply(messages[next++]);
+                scheduleNext(); });
+        };
+        scheduleNext();
+        app.exec();
+    }
+
+    double seconds = wall.nsecsElapsed() / 1e9;
+    out << Qt::endl
+        << QString("Replayed %1 messages in %2 s (%3 msg/s)").arg(messages.size()).arg(seconds, 0, 'f', 3).arg(messages.size() / qMax(seconds, 1e-9), 0, 'f', 0) << Qt::endl
+        << timingLine("decode", decode) << Qt::endl
+        << timingLine("process", process) << Qt::endl;
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "trafficrecorder.h"
+#include <QtEndian>
+
+namespace
+{
+const QByteArray CAPTURE_MAGIC("SATCAP\x01\x00", 8);
+}
+
+TrafficRecorder::~TrafficRecorder()
+{
+    close();
+}
+
+/**
+ * @brief Starts a new capture, replacing the file.
+ */
+bool TrafficRecorder::open(const QString &path)
+{
+    QMutexLocker locker(&mutex);
+    file.close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        enabled.store(false);
+        return false;
+    }
+
+    file.write(CAPTURE_MAGIC);
+    file.flush();
+    clock.start();
+    enabled.store(true);
+    return true;
+}
+
+/**
+ * @brief Ends the capture.
+ */
+void TrafficRecorder::close()
+{
+    QMutexLocker locker(&mutex);
+    enabled.store(false);
+    file.close();
+}
+
+/**
+ * @brief Appends a record if a capture is open.
+ */
+void TrafficRecorder::record(TrafficRecord::Kind kind, const QString &ip, const QByteArray &data)
+{
+    if (!enabled.load(std::memory_order_relaxed))
+        return;
+
+    QByteArray address = ip.toLatin1().left(255);
+    QByteArray header(8 + 1 + 1, Qt::Uninitialized);
+
+    QMutexLocker locker(&mutex);
+    if (!file.isOpen())
+        return;
+
+    qToLittleEndian<quint64>(static_cast<quint64>(clock.nsecsElapsed()), header.data());
+    header[8] = static_cast<char>(kind);
+    header[9] = static_cast<char>(address.size());
+
+    char length[4];
+    qToLittleEndian<quint32>(static_cast<quint32>(data.size()), length);
+
+    file.write(header);
+    file.write(address);
+    file.write(length, 4);
+    file.write(data);
+    file.flush();
+}
+
+/**
+ * @brief Reads a whole capture file.
+ */
+bool TrafficRecorder::load(const QString &path, QList<TrafficRecord> &records, QString &error)
+{
+    QFile in(path);
+    if (!in.open(QIODevice::ReadOnly))
+    {
+        error = in.errorString();
+        return false;
+    }
+
+    const QByteArray bytes = in.readAll();
+    if (!bytes.startsWith(CAPTURE_MAGIC))
+    {
+        error = "Not a capture file";
+        return false;
+    }
+
+    const char *p = bytes.constData();
+    qsizetype pos = CAPTURE_MAGIC.size();
+    while (bytes.size() - pos >= 10)
+    {
+        TrafficRecord record;
+        record.timestampNs = qFromLittleEndian<quint64>(p + pos);
+        record.kind = static_cast<TrafficRecord::Kind>(static_cast<quint8>(p[pos + 8]));
+        int ipLength = static_cast<quint8>(p[pos + 9]);
+        pos += 10;
+
+        if (bytes.size() - pos < ipLength + 4)
+            break; // Truncated record
+        record.ip = QString::fromLatin1(p + pos, ipLength);
+        pos += ipLength;
+        quint32 dataLength = qFromLittleEndian<quint32>(p + pos);
+        pos += 4;
+
+        if (static_cast<quint64>(bytes.size() - pos) < dataLength)
+            break; // Truncated record
+        record.data = bytes.mid(pos, dataLength);
+        pos += dataLength;
+        records.append(record);
+    }
+    return true;
+}
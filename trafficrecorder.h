@@ -0,0 +1,93 @@
+#ifndef TRAFFICRECORDER_H
+#define TRAFFICRECORDER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+
+/**
+ * @brief One captured datagram, MQTT frame or HTTP request.
+ */
+struct TrafficRecord
+{
+    /**
+     * @brief What was captured, and in which direction.
+     */
+    enum Kind : quint8
+    {
+        UdpIn = 1,       ///< Datagram received (discovery replies).
+        UdpOut = 2,      ///< Datagram sent (discovery broadcast, invitations).
+        MqttIn = 3,      ///< Complete MQTT frame received from a printer.
+        MqttOut = 4,     ///< Complete MQTT frame sent to a printer.
+        HttpRequest = 5  ///< HTTP request header received from a printer.
+    };
+
+    quint64 timestampNs = 0; ///< Monotonic time since the capture started.
+    Kind kind = UdpIn;
+    QString ip;              ///< The printer's address (the destination for broadcasts).
+    QByteArray data;         ///< The bytes as they went over the wire.
+};
+
+/**
+ * @class TrafficRecorder
+ * @brief Appends printer traffic to a compact binary capture file.
+ *
+ * The file starts with the 8-byte magic "SATCAP\1\0", followed by records of
+ * [u64 timestamp ns][u8 kind][u8 ip length][ip][u32 data length][data], all little
+ * endian. Each record is flushed as it is written, so a capture survives a crash.
+ *
+ * record() may be called from any thread. While no capture is open it returns after a
+ * single atomic load, so the hooks cost nothing in normal operation.
+ */
+class TrafficRecorder
+{
+public:
+    ~TrafficRecorder();
+
+    /**
+     * @brief Starts a new capture, replacing the file.
+     * @param path The capture file.
+     * @return False if the file could not be created.
+     */
+    bool open(const QString &path);
+
+    /**
+     * @brief Ends the capture.
+     */
+    void close();
+
+    /**
+     * @brief True while a capture is open.
+     */
+    bool isOpen() const { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Appends a record if a capture is open.
+     * @param kind What is being captured.
+     * @param ip The printer's address.
+     * @param data The bytes as they went over the wire.
+     */
+    void record(TrafficRecord::Kind kind, const QString &ip, const QByteArray &data);
+
+    /**
+     * @brief Reads a whole capture file.
+     * @param path The capture file.
+     * @param records Receives the records, in file order.
+     * @param error Receives a description of the problem if reading fails.
+     * @return False if the file is missing or not a capture. A truncated last record
+     * (e.g. after a crash) is ignored rather than reported.
+     */
+    static bool load(const QString &path, QList<TrafficRecord> &records, QString &error);
+
+private:
+    std::atomic<bool> enabled{false}; ///< Fast check for the hooks.
+    QMutex mutex;                     ///< Serializes writers on different threads.
+    QFile file;                       ///< The open capture.
+    QElapsedTimer clock;              ///< Started when the capture opens.
+};
+
+#endif // TRAFFICRECORDER_H
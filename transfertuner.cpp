@@ -0,0 +1,139 @@
+#include "transfertuner.h"
+#include <QTcpSocket>
+
+#ifdef Q_OS_LINUX
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#endif
+
+/**
+ * @brief Applies the initial parameters to the socket. SO_SNDBUF is left to the kernel
+ * until a throughput sample exists.
+ */
+void TransferTuner::start(QTcpSocket *socket)
+{
+    this->socket = socket;
+    rttUs = DEFAULT_RTT_US;
+    applyBuffers();
+}
+
+/**
+ * @brief Resets the byte count and the clock for a new body.
+ */
+void TransferTuner::beginBody()
+{
+    writtenBytes = 0;
+    sampleUs = 0;
+    sampleDelivered = 0;
+    inBody = true;
+    clock.start();
+}
+
+/**
+ * @brief Re-tunes the parameters once per sampling period.
+ */
+void TransferTuner::sample()
+{
+    if (!socket || !inBody)
+        return;
+    qint64 now = clock.nsecsElapsed() / 1000;
+    qint64 elapsed = now - sampleUs;
+    if (elapsed < SAMPLE_US)
+        return;
+
+    qint64 delivered = qMax<qint64>(0, writtenBytes - socket->bytesToWrite() - queuedInKernel());
+    qint64 rate = (delivered - sampleDelivered) * 1000000 / elapsed;
+    sampleUs = now;
+    sampleDelivered = delivered;
+    if (rate <= 0)
+        return; // Nothing delivered (e.g. paced by the shaper): keep the parameters
+
+    throughput = throughput ? (throughput * 3 + rate) / 4 : rate;
+    qint64 rtt = measuredRttUs();
+    if (rtt > 0)
+        rttUs = rtt;
+
+    // About WRITE_TIME_US of data per write, rounded down to a power of two
+    qint64 target = qBound(MIN_CHUNK, throughput * WRITE_TIME_US / 1000000, MAX_CHUNK);
+    chunk = MIN_CHUNK;
+    while (chunk * 2 <= target)
+        chunk *= 2;
+    backlog = qMax<qint64>(4 * chunk, 256 * 1024);
+
+    applyBuffers();
+}
+
+/**
+ * @brief Raises SO_SNDBUF to twice the bandwidth-delay product when the kernel's buffer
+ * is smaller, and sets the not-sent low-water mark (Linux) to two writes. The buffer is
+ * never lowered: a fixed value turns off the kernel's own autotuning, so it is only
+ * worth setting when it gives more than the kernel does.
+ */
+void TransferTuner::applyBuffers()
+{
+    if (throughput > 0)
+    {
+        qint64 buffer = qMin(2 * throughput * rttUs / 1000000, MAX_SEND_BUFFER);
+        qint64 current = socket->socketOption(QAbstractSocket::SendBufferSizeSocketOption).toLongLong();
+        if (buffer > current && (sendBuffer == 0 || (buffer - sendBuffer) * 4 > sendBuffer))
+        {
+            socket->setSocketOption(QAbstractSocket::SendBufferSizeSocketOption, static_cast<int>(buffer));
+            sendBuffer = buffer;
+        }
+    }
+
+#ifdef Q_OS_LINUX
+    qint64 lowat = qMax<qint64>(2 * chunk, 64 * 1024);
+    if (lowat != notSentLowat)
+    {
+        int value = static_cast<int>(lowat);
+        if (setsockopt(static_cast<int>(socket->socketDescriptor()), IPPROTO_TCP, TCP_NOTSENT_LOWAT, &value, sizeof(value)) == 0)
+            notSentLowat = lowat;
+    }
+#endif
+}
+
+/**
+ * @brief Bytes written to the kernel that the peer has not acknowledged yet.
+ */
+qint64 TransferTuner::queuedInKernel() const
+{
+#ifdef Q_OS_LINUX
+    int queued = 0;
+    if (ioctl(static_cast<int>(socket->socketDescriptor()), TIOCOUTQ, &queued) == 0)
+        return queued;
+#endif
+    return 0;
+}
+
+/**
+ * @brief The kernel's smoothed RTT, or 0 where it is unavailable.
+ */
+qint64 TransferTuner::measuredRttUs() const
+{
+#ifdef Q_OS_LINUX
+    struct tcp_info info = {};
+    socklen_t length = sizeof(info);
+    if (getsockopt(static_cast<int>(socket->socketDescriptor()), IPPROTO_TCP, TCP_INFO, &info, &length) == 0)
+        return info.tcpi_rtt;
+#endif
+    return 0;
+}
+
+/**
+ * @brief Summarizes the transfer and the parameters in use.
+ */
+QString TransferTuner::report() const
+{
+    double seconds = clock.nsecsElapsed() / 1e9;
+    return QString(tr("Transfer: %1 MB in %2 s (%3 MB/s). RTT %4 ms, write %5 KB, send buffer %6 KB, not-sent low-water %7 KB."))
+        .arg(writtenBytes / 1048576.0, 0, 'f', 1)
+        .arg(seconds, 0, 'f', 1)
+        .arg(writtenBytes / 1048576.0 / qMax(seconds, 1e-3), 0, 'f', 2)
+        .arg(rttUs / 1000.0, 0, 'f', 1)
+        .arg(chunk / 1024)
+        .arg(sendBuffer / 1024)
+        .arg(notSentLowat / 1024);
+}
@@ -0,0 +1,112 @@
+#ifndef TRANSFERTUNER_H
+#define TRANSFERTUNER_H
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QString>
+
+class QTcpSocket;
+
+/**
+ * @class TransferTuner
+ * @brief Sizes the writes and socket buffers of one file download to its link.
+ *
+ * A fixed 64 KB write makes a fast wired printer syscall-bound, while on weak Wi-Fi
+ * the default buffers queue seconds of data. Every sampling period the tuner measures
+ * the delivered throughput and, on Linux, the RTT from TCP_INFO, and derives from them:
+ * - the write size: about 5 ms of data per write, so fast links use few syscalls;
+ * - SO_SNDBUF: twice the bandwidth-delay product, but only once it exceeds what the
+ *   kernel already gives the socket, since a fixed value disables autotuning on Linux;
+ * - TCP_NOTSENT_LOWAT (Linux): the socket only becomes writable once little unsent
+ *   data is left in the kernel, so the queue stays short on slow links;
+ * - the backlog kept in the QTcpSocket before streaming pauses.
+ *
+ * Delivered bytes are those written minus what is still queued: in the QTcpSocket, and
+ * on Linux also in the kernel (TIOCOUTQ). Elsewhere the RTT is assumed to be 20 ms.
+ */
+class TransferTuner
+{
+    Q_DECLARE_TR_FUNCTIONS(TransferTuner)
+
+public:
+    /**
+     * @brief Applies the initial parameters to the socket. Call once per connection.
+     * @param socket The connected socket the bodies are sent on.
+     */
+    void start(QTcpSocket *socket);
+
+    /**
+     * @brief Starts measuring a new response body. What was learned about the link
+     * on earlier responses of the connection is kept.
+     */
+    void beginBody();
+
+    /**
+     * @brief Stops measuring the current body.
+     */
+    void endBody() { inBody = false; }
+
+    /**
+     * @brief True between beginBody() and endBody().
+     */
+    bool isInBody() const { return inBody; }
+
+    /**
+     * @brief Counts bytes handed to the socket.
+     * @param bytes The bytes written.
+     */
+    void written(qint64 bytes) { writtenBytes += bytes; }
+
+    /**
+     * @brief Re-tunes the parameters if a sampling period has passed. Cheap to call often.
+     */
+    void sample();
+
+    /**
+     * @brief Current size of each write.
+     */
+    qint64 chunkSize() const { return chunk; }
+
+    /**
+     * @brief Backlog in the QTcpSocket above which streaming pauses.
+     */
+    qint64 highWater() const { return backlog; }
+
+    /**
+     * @brief True once start() has been called.
+     */
+    bool isStarted() const { return socket != nullptr; }
+
+    /**
+     * @brief Summarizes the current body: size, time, throughput and the parameters in use.
+     */
+    QString report() const;
+
+private:
+    qint64 queuedInKernel() const;
+    qint64 measuredRttUs() const;
+    void applyBuffers();
+
+    QTcpSocket *socket = nullptr;  ///< The download's socket.
+    QElapsedTimer clock;           ///< Started with the current body.
+    bool inBody = false;           ///< A body is being measured.
+    qint64 writtenBytes = 0;       ///< Bytes of the current body handed to the socket so far.
+    qint64 sampleUs = 0;           ///< Time of the last sample.
+    qint64 sampleDelivered = 0;    ///< Delivered bytes at the last sample.
+    qint64 throughput = 0;         ///< Smoothed delivered bytes per second.
+    qint64 rttUs = 0;              ///< Last RTT estimate.
+
+    qint64 chunk = 64 * 1024;          ///< Bytes per write.
+    qint64 backlog = 1024 * 1024;      ///< Socket backlog high-water mark.
+    qint64 sendBuffer = 0;             ///< SO_SNDBUF we set; 0 while the kernel autotunes it.
+    qint64 notSentLowat = 0;           ///< TCP_NOTSENT_LOWAT in use; 0 while unset.
+
+    const qint64 SAMPLE_US = 500000;   ///< Sampling period.
+    const qint64 WRITE_TIME_US = 5000; ///< Data per write, in link time.
+    const qint64 DEFAULT_RTT_US = 20000; ///< Assumed RTT where TCP_INFO is unavailable.
+    const qint64 MIN_CHUNK = 16 * 1024;
+    const qint64 MAX_CHUNK = 1024 * 1024;
+    const qint64 MAX_SEND_BUFFER = 8 * 1024 * 1024;
+};
+
+#endif // TRANSFERTUNER_H
@@ -1,6 +1,77 @@
 <?xml version="1.0" encoding="utf-8"?>
 <!DOCTYPE TS>
 <TS version="2.1" language="es_ES">
+<context>
+    <name>FarmModel</name>
+    <message>
+        <source>Ready</source>
+        <translation>Listo</translation>
+    </message>
+    <message>
+        <source>Exposing Layer</source>
+        <translation>Exponiendo Capa</translation>
+    </message>
+    <message>
+        <source>Retracting</source>
+        <translation>Retrayendo</translation>
+    </message>
+    <message>
+        <source>Lowering</source>
+        <translation>Bajando</translation>
+    </message>
+    <message>
+        <source>Complete / Paused</source>
+        <translation>Completado / Pausado</translation>
+    </message>
+    <message>
+        <source>Printing (Code %1)</source>
+        <translation>Imprimiendo (Código %1)</translation>
+    </message>
+    <message>
+        <source>RECEIVING FILE (%1%)...</source>
+        <translation>RECIBIENDO ARCHIVO (%1%)...</translation>
+    </message>
+    <message>
+        <source>Processing file...</source>
+        <translation>Procesando archivo...</translation>
+    </message>
+    <message>
+        <source>Error in last transfer</source>
+        <translation>Error en la última transferencia</translation>
+    </message>
+    <message>
+        <source>Unknown</source>
+        <translation>Desconocido</translation>
+    </message>
+    <message>
+        <source>Connection lost. Reconnecting...</source>
+        <translation>Conexión perdida. Reconectando...</translation>
+    </message>
+    <message>
+        <source>%1 (Layer %2/%3)</source>
+        <translation>%1 (Capa %2/%3)</translation>
+    </message>
+    <message>
+        <source>Calculating...</source>
+        <translation>Calculando...</translation>
+    </message>
+    <message>
+        <source>Printer</source>
+        <translation>Impresora</translation>
+    </message>
+    <message>
+        <source>Status</source>
+        <translation>Estado</translation>
+    </message>
+    <message>
+        <source>Progress</source>
+        <translation>Progreso</translation>
+    </message>
+    <message>
+        <source>Remaining</source>
+        <translation>Restante</translation>
+    </message>
+</context>
 <context>
     <name>MainWindow</name>
     <message>
@@ -23,6 +94,22 @@
         <source>Connect</source>
         <translation>Conectar</translation>
     </message>
+    <message>
+        <source>Connect All Discovered</source>
+        <translation>Conectar Todas las Encontradas</translation>
+    </message>
+    <message>
+        <source>Queue Files for Farm...</source>
+        <translation>Añadir Archivos a la Cola de la Granja...</translation>
+    </message>
+    <message>
+        <source>Watch Folder...</source>
+        <translation>Vigilar Carpeta...</translation>
+    </message>
+    <message>
+        <source>Select Hot Folder</source>
+        <translation>Seleccionar Carpeta Vigilada</translation>
+    </message>
     <message>
         <source>[Image not found]</source>
         <translation>[Imagen no encontrada]</translation>
@@ -55,6 +142,14 @@
         <source>Print</source>
         <translation>Imprimir</translation>
     </message>
+    <message>
+        <source>Layers: %1
+Estimated print time: %2h %3m
+Resin: %4 ml</source>
+        <translation>Capas: %1
+Tiempo de impresión estimado: %2h %3m
+Resina: %4 ml</translation>
+    </message>
     <message>
         <source>Start printing immediately after upload?</source>
         <translation>¿Empezar a imprimir inmediatamente después de subir?</translation>
@@ -67,14 +162,6 @@
         <source>Calculating MD5...</source>
         <translation>Calculando MD5...</translation>
     </message>
-    <message>
-        <source>RECEIVING</source>
-        <translation>RECIBIENDO</translation>
-    </message>
-    <message>
-        <source>Uploading</source>
-        <translation>Subiendo</translation>
-    </message>
     <message>
         <source>Status: </source>
         <translation>Estado: </translation>
@@ -91,10 +178,6 @@
         <source>%p% (Printing)</source>
         <translation>%p% (Imprimiendo)</translation>
     </message>
-    <message>
-        <source>Ready</source>
-        <translation>Listo</translation>
-    </message>
     <message>
         <source>Print: </source>
         <translation>Imprimir: </translation>
@@ -119,52 +202,53 @@ Archivo: </translation>
         <source>Remaining time: </source>
         <translation>Tiempo restante: </translation>
     </message>
-</context>
-<context>
-    <name>SaturnBackend</name>
     <message>
-        <source>Exposing Layer</source>
-        <translation>Exponiendo Capa</translation>
+        <source>~%1 remaining (finishes at %2)</source>
+        <translation>~%1 restante (finaliza a las %2)</translation>
     </message>
     <message>
-        <source>Retracting</source>
-        <translation>Retrayendo</translation>
+        <source>Farm Dashboard</source>
+        <translation>Panel de la Granja</translation>
     </message>
     <message>
-        <source>Lowering</source>
-        <translation>Bajando</translation>
+        <source>Back</source>
+        <translation>Volver</translation>
     </message>
     <message>
-        <source>Complete / Paused</source>
-        <translation>Completado / Pausado</translation>
+        <source>Pause All</source>
+        <translation>Pausar Todas</translation>
     </message>
     <message>
-        <source>Printing (Code %1)</source>
-        <translation>Imprimiendo (Código %1)</translation>
+        <source>Resume All</source>
+        <translation>Reanudar Todas</translation>
     </message>
     <message>
-        <source>RECEIVING FILE (%1%)...</source>
-        <translation>RECIBIENDO ARCHIVO (%1%)...</translation>
+        <source>Stop All</source>
+        <translation>Detener Todas</translation>
     </message>
     <message>
-        <source>Processing file...</source>
-        <translation>Procesando archivo...</translation>
+        <source>Stop the print on every connected printer?</source>
+        <translation>¿Detener la impresión en todas las impresoras conectadas?</translation>
     </message>
     <message>
-        <source>Error in last transfer</source>
-        <translation>Error en la última transferencia</translation>
+        <source>Waiting for the printers...</source>
+        <translation>Esperando a las impresoras...</translation>
     </message>
     <message>
-        <source>Unknown</source>
-        <translation>Desconocido</translation>
+        <source>%1 of %2 printers acknowledged</source>
+        <translation>%1 de %2 impresoras confirmaron</translation>
     </message>
     <message>
-        <source>Calculating...</source>
-        <translation>Calculando...</translation>
+        <source>%1 of %2 printers acknowledged in %3 ms</source>
+        <translation>%1 de %2 impresoras confirmaron en %3 ms</translation>
     </message>
     <message>
-        <source>~%1 remaining (finishes at %2)</source>
-        <translation>~%1 restante (finaliza a las %2)</translation>
+        <source>Job queue: %1 waiting, %2 being sent</source>
+        <translation>Cola de trabajos: %1 en espera, %2 enviándose</translation>
+    </message>
+    <message>
+        <source>Failed jobs:</source>
+        <translation>Trabajos fallidos:</translation>
     </message>
 </context>
 </TS>
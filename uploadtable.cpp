@@ -0,0 +1,32 @@
+#include "uploadtable.h"
+
+/**
+ * @brief Registers an upload, replacing any ticket with the same ID.
+ */
+void UploadTable::insert(const QString &fileId, const UploadTicket &ticket)
+{
+    QMutexLocker locker(&mutex);
+    tickets.insert(fileId, ticket);
+}
+
+/**
+ * @brief Forgets an upload.
+ */
+void UploadTable::remove(const QString &fileId)
+{
+    QMutexLocker locker(&mutex);
+    tickets.remove(fileId);
+}
+
+/**
+ * @brief Looks up an upload.
+ */
+bool UploadTable::find(const QString &fileId, UploadTicket &ticket) const
+{
+    QMutexLocker locker(&mutex);
+    auto it = tickets.constFind(fileId);
+    if (it == tickets.cend())
+        return false;
+    ticket = it.value();
+    return true;
+}
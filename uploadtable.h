@@ -0,0 +1,53 @@
+#ifndef UPLOADTABLE_H
+#define UPLOADTABLE_H
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+
+/**
+ * @brief What the HTTP server needs to serve one upload.
+ */
+struct UploadTicket
+{
+    QString ip;               ///< Printer the upload is meant for.
+    QString filePath;         ///< Local file to send.
+    QString md5;              ///< MD5 of the file, sent as the ETag.
+    bool gzipAllowed = false; ///< The file may be sent gzip-encoded if the printer asks for it.
+};
+
+/**
+ * @class UploadTable
+ * @brief Thread-safe map from the random file IDs in our upload URLs to their tickets.
+ * The backend registers uploads; HTTP connections on the broker workers look them up.
+ */
+class UploadTable
+{
+public:
+    /**
+     * @brief Registers an upload.
+     * @param fileId The file ID used in the URL.
+     * @param ticket What to serve for it.
+     */
+    void insert(const QString &fileId, const UploadTicket &ticket);
+
+    /**
+     * @brief Forgets an upload; later requests for its ID get a 404.
+     * @param fileId The file ID used in the URL.
+     */
+    void remove(const QString &fileId);
+
+    /**
+     * @brief Looks up an upload.
+     * @param fileId The file ID used in the URL.
+     * @param ticket Receives the ticket if found.
+     * @return True if the ID is registered.
+     */
+    bool find(const QString &fileId, UploadTicket &ticket) const;
+
+private:
+    mutable QMutex mutex;                  ///< Guards tickets.
+    QHash<QString, UploadTicket> tickets;  ///< Registered uploads, keyed by file ID.
+};
+
+#endif // UPLOADTABLE_H